@@ -0,0 +1,198 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <format>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "iteration_histogram.hpp"
+#include "mandelbrot_sender.hpp"
+#include "perf_counters.hpp"
+#include "simd_kernel.hpp"
+
+// Микробенчмарки вычислительных ядер: итерации одной точки, матрица области и раскраска
+
+namespace {
+
+void BM_CalculateIterationsForPoint(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto size = benchutil::KERNEL_SIZE;
+
+    std::vector<mandelbrot::Complex> points;
+    points.reserve(static_cast<std::size_t>(size) * size);
+    for (std::uint32_t y = 0; y < size; ++y) {
+        for (std::uint32_t x = 0; x < size; ++x) {
+            points.push_back(mandelbrot::Pixel2DToComplex(x, y, canonical.viewport, size, size));
+        }
+    }
+
+    std::uint64_t iterations_per_run = 0;
+    for (const auto &c : points) {
+        iterations_per_run += mandelbrot::CalculateIterationsForPoint(c, canonical.max_iterations, 2.0);
+    }
+
+    perf::Enable();
+    const perf::Scope counters;
+    for (auto _ : state) {
+        for (const auto &c : points) {
+            benchmark::DoNotOptimize(mandelbrot::CalculateIterationsForPoint(c, canonical.max_iterations, 2.0));
+        }
+    }
+    state.SetLabel(std::string{canonical.name});
+    benchutil::ReportThroughput(state, points.size(), iterations_per_run);
+    benchutil::ReportHwCounters(state, counters.Stop(), points.size());
+}
+BENCHMARK(BM_CalculateIterationsForPoint)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond);
+
+void BM_ComputePixelMatrixForRegion(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto settings = benchutil::MakeSettings(canonical, benchutil::KERNEL_SIZE, benchutil::KERNEL_SIZE);
+    const PixelRegion region{0, settings.height, 0, settings.width};
+
+    const auto iterations_per_run =
+        benchutil::TotalIterations(ComputePixelMatrixForRegion(canonical.viewport, settings, region));
+
+    perf::Enable();
+    const perf::Scope counters;
+    for (auto _ : state) {
+        auto matrix = ComputePixelMatrixForRegion(canonical.viewport, settings, region);
+        benchmark::DoNotOptimize(matrix.data());
+    }
+    const auto pixels = static_cast<std::uint64_t>(settings.width) * settings.height;
+    state.SetLabel(std::string{canonical.name});
+    benchutil::ReportThroughput(state, pixels, iterations_per_run);
+    benchutil::ReportHwCounters(state, counters.Stop(), pixels);
+}
+BENCHMARK(BM_ComputePixelMatrixForRegion)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond);
+
+// Векторные ядра строк против скалярного на одной и той же области: args — эталонная область и вариант ядра.
+// lane_util — доля шагов итерации, пришедшихся на дорожки с точкой (у скалярного ядра не считается).
+void BM_RowKernels(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto kernel = static_cast<mandelbrot::Kernel>(state.range(1));
+    const auto size = benchutil::KERNEL_SIZE;
+    std::vector<std::uint32_t> row(size);
+
+    auto run = [&](mandelbrot::simd::LaneStats *stats) {
+        for (std::uint32_t y = 0; y < size; ++y) {
+            switch (kernel) {
+            case mandelbrot::Kernel::SCALAR:
+                for (std::uint32_t x = 0; x < size; ++x) {
+                    row[x] = mandelbrot::CalculateIterationsForPoint(
+                        mandelbrot::Pixel2DToComplex(x, y, canonical.viewport, size, size), canonical.max_iterations,
+                        2.0);
+                }
+                break;
+            case mandelbrot::Kernel::SIMD:
+                mandelbrot::simd::ComputeRowFixed(canonical.viewport, size, size, y, 0, size, canonical.max_iterations,
+                                                  2.0, row.data(), stats);
+                break;
+            case mandelbrot::Kernel::SIMD_STREAMING:
+                mandelbrot::simd::ComputeRowStreaming(canonical.viewport, size, size, y, 0, size,
+                                                      canonical.max_iterations, 2.0, row.data(), stats);
+                break;
+            }
+            benchmark::DoNotOptimize(row.data());
+        }
+    };
+
+    mandelbrot::simd::LaneStats lanes;
+    run(&lanes);
+    const auto settings = benchutil::MakeSettings(canonical, size, size);
+    const auto iterations_per_run =
+        benchutil::TotalIterations(ComputePixelMatrixForRegion(canonical.viewport, settings, {0, size, 0, size}));
+
+    for (auto _ : state) {
+        run(nullptr);
+    }
+    state.SetLabel(std::format("{} / {}", canonical.name, mandelbrot::KernelName(kernel)));
+    benchutil::ReportThroughput(state, static_cast<std::uint64_t>(size) * size, iterations_per_run);
+    if (kernel != mandelbrot::Kernel::SCALAR) {
+        state.counters["lane_util"] = lanes.Utilization();
+    }
+}
+BENCHMARK(BM_RowKernels)
+    ->Apply([](benchmark::internal::Benchmark *bench) {
+        for (std::size_t i = 0; i < CANONICAL_VIEWPORTS.size(); ++i) {
+            for (std::size_t kernel = 0; kernel < mandelbrot::KERNEL_NAMES.size(); ++kernel) {
+                bench->Args({static_cast<std::int64_t>(i), static_cast<std::int64_t>(kernel)});
+            }
+        }
+    })
+    ->Unit(benchmark::kMillisecond);
+
+// Ядро с набором каналов: args — эталонная область и маска каналов. Маска из одних итераций должна идти вровень
+// с BM_ComputePixelMatrixForRegion, каждый дополнительный канал добавляет свою работу во внутренний цикл.
+void BM_ChannelKernels(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    auto settings = benchutil::MakeSettings(canonical, benchutil::KERNEL_SIZE, benchutil::KERNEL_SIZE);
+    settings.channels = static_cast<mandelbrot::ChannelMask>(state.range(1));
+    const PixelRegion region{0, settings.height, 0, settings.width};
+
+    const auto iterations_per_run =
+        benchutil::TotalIterations(ComputePixelMatrixForRegion(canonical.viewport, settings, region));
+
+    for (auto _ : state) {
+        ChannelBuffers channels;
+        auto matrix = ComputePixelMatrixForRegion(canonical.viewport, settings, region, &channels);
+        benchmark::DoNotOptimize(matrix.data());
+        benchmark::DoNotOptimize(channels);
+    }
+    state.SetLabel(std::format("{} / channels {:#x}", canonical.name, settings.channels));
+    benchutil::ReportThroughput(state, static_cast<std::uint64_t>(settings.width) * settings.height,
+                                iterations_per_run);
+}
+BENCHMARK(BM_ChannelKernels)
+    ->Apply([](benchmark::internal::Benchmark *bench) {
+        using mandelbrot::Channels;
+        for (std::size_t i = 0; i < CANONICAL_VIEWPORTS.size(); ++i) {
+            for (const auto mask : {Channels::ITERATIONS, Channels::ITERATIONS | Channels::SMOOTH,
+                                    Channels::ITERATIONS | Channels::DISTANCE,
+                                    Channels::ITERATIONS | Channels::ORBIT_TRAP, Channels::ALL}) {
+                bench->Args({static_cast<std::int64_t>(i), static_cast<std::int64_t>(mask)});
+            }
+        }
+    })
+    ->Unit(benchmark::kMillisecond);
+
+// Заполнение гистограммы итераций, которое RenderAsync делает для каждой полосы: сравнивается
+// с BM_ComputePixelMatrixForRegion той же области
+void BM_IterationHistogram(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto settings = benchutil::MakeSettings(canonical, benchutil::KERNEL_SIZE, benchutil::KERNEL_SIZE);
+    const auto matrix =
+        ComputePixelMatrixForRegion(canonical.viewport, settings, {0, settings.height, 0, settings.width});
+
+    for (auto _ : state) {
+        IterationHistogram histogram{settings.max_iterations};
+        for (const auto &row : matrix) {
+            histogram.AddRow(row);
+        }
+        benchmark::DoNotOptimize(histogram);
+    }
+    state.SetLabel(std::string{canonical.name});
+    state.SetItemsProcessed(state.iterations() * settings.width * settings.height);
+}
+BENCHMARK(BM_IterationHistogram)->Apply(benchutil::ForEachViewport);
+
+void BM_IterationsToColor(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto settings = benchutil::MakeSettings(canonical, benchutil::KERNEL_SIZE, benchutil::KERNEL_SIZE);
+    // Раскрашиваем реальное распределение итераций области, а не равномерный ряд
+    const auto matrix =
+        ComputePixelMatrixForRegion(canonical.viewport, settings, {0, settings.height, 0, settings.width});
+
+    for (auto _ : state) {
+        for (const auto &row : matrix) {
+            for (const auto it : row) {
+                benchmark::DoNotOptimize(mandelbrot::IterationsToColor(it, settings.max_iterations));
+            }
+        }
+    }
+    state.SetLabel(std::string{canonical.name});
+    state.SetItemsProcessed(state.iterations() * settings.width * settings.height);
+}
+BENCHMARK(BM_IterationsToColor)->Apply(benchutil::ForEachViewport);
+
+}  // namespace
@@ -0,0 +1,182 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <exec/async_scope.hpp>
+#include <exec/inline_scheduler.hpp>
+#include <exec/static_thread_pool.hpp>
+#include <numeric>
+#include <stdexec/execution.hpp>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "work_stealing_pool.hpp"
+
+// Бенчмарки этапов конвейера кадра: весь RenderAsync на разных планировщиках, мелкие тайлы, слияние полос
+// в RenderResult и упаковка в RGBA
+
+namespace {
+
+constexpr std::uint32_t FRAME_WIDTH = 800;
+constexpr std::uint32_t FRAME_HEIGHT = 600;
+
+// Весь кадр на заданном рендерере: бенчмарки ниже отличаются только планировщиком
+template <typename Renderer>
+void RunRenderAsync(benchmark::State &state, Renderer &renderer) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto settings = benchutil::MakeSettings(canonical, FRAME_WIDTH, FRAME_HEIGHT);
+
+    auto [first] =
+        *stdexec::sync_wait(renderer.template RenderAsync<THREAD_POOL_SIZE>(canonical.viewport, settings));
+    const auto iterations_per_run = benchutil::TotalIterations(first.pixel_data);
+
+    // Этапы считаются на потоках пула, поэтому счётчики собираются из статистики каждого кадра
+    perf::Enable();
+    perf::CounterSet counters;
+    for (auto _ : state) {
+        auto [result] =
+            *stdexec::sync_wait(renderer.template RenderAsync<THREAD_POOL_SIZE>(canonical.viewport, settings));
+        benchmark::DoNotOptimize(result.rgba_data.data());
+        counters += result.stats.hw_compute;
+        counters += result.stats.hw_merge;
+        counters += result.stats.hw_antialias;
+    }
+    const auto pixels = static_cast<std::uint64_t>(settings.width) * settings.height;
+    state.SetLabel(std::string{canonical.name});
+    benchutil::ReportThroughput(state, pixels, iterations_per_run);
+    benchutil::ReportHwCounters(state, counters, pixels);
+}
+
+void BM_RenderAsync(benchmark::State &state) {
+    MandelbrotRenderer renderer{THREAD_POOL_SIZE};
+    RunRenderAsync(state, renderer);
+}
+BENCHMARK(BM_RenderAsync)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Общий пул процесса вместо собственного пула рендерера
+void BM_RenderAsyncSharedPool(benchmark::State &state) {
+    MandelbrotRenderer renderer{SharedThreadPool().get_scheduler()};
+    RunRenderAsync(state, renderer);
+}
+BENCHMARK(BM_RenderAsyncSharedPool)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Всё на вызывающем потоке: однопоточная точка отсчёта для ускорения пула
+void BM_RenderAsyncInline(benchmark::State &state) {
+    BasicMandelbrotRenderer renderer{exec::inline_scheduler{}};
+    RunRenderAsync(state, renderer);
+}
+BENCHMARK(BM_RenderAsyncInline)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Собственный пул с перехватом работы вместо exec::static_thread_pool
+void BM_RenderAsyncWorkStealing(benchmark::State &state) {
+    ws::WorkStealingPool pool{THREAD_POOL_SIZE};
+    BasicMandelbrotRenderer renderer{pool.GetScheduler()};
+    RunRenderAsync(state, renderer);
+}
+BENCHMARK(BM_RenderAsyncWorkStealing)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+constexpr std::uint32_t TINY_FRAME = 512;
+constexpr std::uint32_t TINY_TILE = 16;
+
+// Кадр из тайлов 16x16, каждый — отдельная задача планировщика: на таких тайлах заметна цена постановки задач,
+// пробуждений и перехвата работы. make_batch открывает пачку отправок на время запуска задач кадра.
+template <typename Scheduler, typename MakeBatch>
+void RunTinyTiles(benchmark::State &state, Scheduler scheduler, MakeBatch make_batch) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto settings = benchutil::MakeSettings(canonical, TINY_FRAME, TINY_FRAME);
+    constexpr std::uint32_t TILES_PER_ROW = TINY_FRAME / TINY_TILE;
+    std::vector<std::uint32_t> iterations(static_cast<std::size_t>(TINY_FRAME) * TINY_FRAME);
+
+    auto tile_task = [&](std::uint32_t tile) {
+        return stdexec::schedule(scheduler) | stdexec::then([&settings, &canonical, &iterations, tile] {
+                   const auto x0 = tile % TILES_PER_ROW * TINY_TILE;
+                   const auto y0 = tile / TILES_PER_ROW * TINY_TILE;
+                   for (auto y = y0; y < y0 + TINY_TILE; ++y) {
+                       for (auto x = x0; x < x0 + TINY_TILE; ++x) {
+                           iterations[static_cast<std::size_t>(y) * TINY_FRAME + x] =
+                               mandelbrot::CalculateIterationsForPoint(
+                                   mandelbrot::Pixel2DToComplex(x, y, canonical.viewport, TINY_FRAME, TINY_FRAME),
+                                   settings.max_iterations, settings.escape_radius);
+                       }
+                   }
+               });
+    };
+
+    for (auto _ : state) {
+        exec::async_scope scope;
+        {
+            [[maybe_unused]] const auto batch = make_batch();
+            for (std::uint32_t tile = 0; tile < TILES_PER_ROW * TILES_PER_ROW; ++tile) {
+                scope.spawn(tile_task(tile));
+            }
+        }
+        stdexec::sync_wait(scope.on_empty());
+        benchmark::DoNotOptimize(iterations.data());
+    }
+    const auto iterations_per_run = std::accumulate(iterations.begin(), iterations.end(), std::uint64_t{0});
+    state.SetLabel(std::string{canonical.name});
+    benchutil::ReportThroughput(state, iterations.size(), iterations_per_run);
+    state.counters["tiles/s"] = benchmark::Counter(static_cast<double>(TILES_PER_ROW * TILES_PER_ROW),
+                                                   benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_TinyTilesStaticPool(benchmark::State &state) {
+    exec::static_thread_pool pool{THREAD_POOL_SIZE};
+    RunTinyTiles(state, pool.get_scheduler(), [] { return 0; });
+}
+BENCHMARK(BM_TinyTilesStaticPool)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+void BM_TinyTilesWorkStealing(benchmark::State &state) {
+    ws::WorkStealingPool pool{THREAD_POOL_SIZE};
+    RunTinyTiles(state, pool.GetScheduler(), [&pool] { return ws::WorkStealingPool::BatchScope{pool}; });
+    const auto stats = pool.Stats();
+    state.counters["steals/frame"] =
+        benchmark::Counter(static_cast<double>(stats.steals), benchmark::Counter::kAvgIterations);
+    const auto wakeups = static_cast<double>(stats.submit_wakeups + stats.chain_wakeups);
+    state.counters["wakeups/frame"] = benchmark::Counter(wakeups, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_TinyTilesWorkStealing)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Слияние посчитанных полос в кадр: то, что RenderAsync делает после when_all
+void BM_MergeStrips(benchmark::State &state) {
+    const auto &canonical = benchutil::ViewportArg(state);
+    const auto settings = benchutil::MakeSettings(canonical, FRAME_WIDTH, FRAME_HEIGHT);
+
+    std::array<PixelRegion, THREAD_POOL_SIZE> regions;
+    std::vector<PixelMatrix> matrices;
+    for (std::uint32_t i = 0; i < THREAD_POOL_SIZE; ++i) {
+        regions[i] = {settings.height * i / THREAD_POOL_SIZE, settings.height * (i + 1) / THREAD_POOL_SIZE, 0,
+                      settings.width};
+        matrices.push_back(ComputePixelMatrixForRegion(canonical.viewport, settings, regions[i]));
+    }
+
+    for (auto _ : state) {
+        auto result = MakeFrameResult(canonical.viewport, settings);
+        for (std::size_t i = 0; i < regions.size(); ++i) {
+            MergeStrip(result, regions[i], matrices[i]);
+        }
+        benchmark::DoNotOptimize(result.rgba_data.data());
+    }
+    state.SetLabel(std::string{canonical.name});
+    state.SetItemsProcessed(state.iterations() * settings.width * settings.height);
+}
+BENCHMARK(BM_MergeStrips)->Apply(benchutil::ForEachViewport)->Unit(benchmark::kMillisecond);
+
+// Упаковка матрицы цветов в RGBA — для результатов, собранных вручную из цветов
+void BM_PackColorsToRgba(benchmark::State &state) {
+    const ColorMatrix colors(FRAME_HEIGHT, std::vector<mandelbrot::RgbColor>(FRAME_WIDTH, {12, 34, 56}));
+    RgbaBuffer rgba;
+
+    for (auto _ : state) {
+        PackColorsToRgba(colors, FRAME_WIDTH, FRAME_HEIGHT, rgba);
+        benchmark::DoNotOptimize(rgba.data());
+    }
+    state.SetItemsProcessed(state.iterations() * FRAME_WIDTH * FRAME_HEIGHT);
+    state.SetBytesProcessed(state.iterations() * FRAME_WIDTH * FRAME_HEIGHT * RGBA_CHANNELS);
+}
+BENCHMARK(BM_PackColorsToRgba);
+
+}  // namespace
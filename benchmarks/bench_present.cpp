@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+
+#include "types.hpp"
+
+// Выгрузка кадра в текстуру — то, что SFMLRender делает с RGBA буфером на каждом кадре. Нужен дисплей:
+// без графического контекста бенчмарк пропускается.
+
+namespace {
+
+constexpr std::uint32_t FRAME_WIDTH = 800;
+constexpr std::uint32_t FRAME_HEIGHT = 600;
+
+void BM_TextureUpdate(benchmark::State &state) {
+    sf::Texture texture;
+    if (!texture.create(FRAME_WIDTH, FRAME_HEIGHT)) {
+        state.SkipWithError("Failed to create texture: no graphics context");
+        return;
+    }
+    const RgbaBuffer rgba(static_cast<std::size_t>(FRAME_WIDTH) * FRAME_HEIGHT * RGBA_CHANNELS, 128);
+    const auto rows = static_cast<std::uint32_t>(state.range(0));
+
+    for (auto _ : state) {
+        for (std::uint32_t row = 0; row < FRAME_HEIGHT; row += rows) {
+            const auto height = std::min(rows, FRAME_HEIGHT - row);
+            texture.update(rgba.data() + static_cast<std::size_t>(row) * FRAME_WIDTH * RGBA_CHANNELS, FRAME_WIDTH,
+                           height, 0, row);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * FRAME_WIDTH * FRAME_HEIGHT);
+    state.SetBytesProcessed(state.iterations() * FRAME_WIDTH * FRAME_HEIGHT * RGBA_CHANNELS);
+}
+// Весь кадр одним вызовом и полосами, как при выгрузке грязных областей
+BENCHMARK(BM_TextureUpdate)->Arg(FRAME_HEIGHT)->Arg(64)->Arg(16);
+
+}  // namespace
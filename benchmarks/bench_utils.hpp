@@ -0,0 +1,68 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+#include "canonical_viewports.hpp"
+#include "mandelbrot_sender.hpp"
+#include "perf_counters.hpp"
+#include "types.hpp"
+
+// Общие помощники бенчмарков: настройки кадра по эталонной области и счётчики пикселей и итераций
+
+namespace benchutil {
+
+inline constexpr std::uint32_t KERNEL_SIZE = 256;
+
+[[nodiscard]] inline const CanonicalViewport &ViewportArg(const benchmark::State &state) {
+    return CANONICAL_VIEWPORTS[static_cast<std::size_t>(state.range(0))];
+}
+
+[[nodiscard]] inline RenderSettings MakeSettings(const CanonicalViewport &canonical, std::uint32_t width,
+                                                 std::uint32_t height) {
+    return RenderSettings{.width = width, .height = height, .max_iterations = canonical.max_iterations};
+}
+
+[[nodiscard]] inline std::uint64_t TotalIterations(const PixelMatrix &matrix) {
+    std::uint64_t total = 0;
+    for (const auto &row : matrix) {
+        total = std::accumulate(row.begin(), row.end(), total);
+    }
+    return total;
+}
+
+// Пиксели в секунду — через items_processed, итерации в секунду — отдельным счётчиком
+inline void ReportThroughput(benchmark::State &state, std::uint64_t pixels_per_run, std::uint64_t iterations_per_run) {
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * pixels_per_run));
+    state.counters["iterations/s"] =
+        benchmark::Counter(static_cast<double>(iterations_per_run), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Аппаратные счётчики за все прогоны в пересчёте на пиксель и IPC. Если счётчики недоступны,
+// колонки не добавляются.
+inline void ReportHwCounters(benchmark::State &state, const perf::CounterSet &counters, std::uint64_t pixels_per_run) {
+    if (!counters.Any() || state.iterations() == 0) {
+        return;
+    }
+    const auto pixels = static_cast<double>(state.iterations()) * static_cast<double>(pixels_per_run);
+    for (std::size_t i = 0; i < perf::EVENT_COUNT; ++i) {
+        if (counters.valid[i]) {
+            state.counters[std::string{perf::EVENT_NAMES[i]} + "/px"] = static_cast<double>(counters.values[i]) / pixels;
+        }
+    }
+    if (counters.Has(perf::Event::CYCLES) && counters.Has(perf::Event::INSTRUCTIONS)) {
+        state.counters["IPC"] = counters.Ipc();
+    }
+}
+
+// Регистрирует бенчмарк для каждой эталонной области
+inline void ForEachViewport(benchmark::internal::Benchmark *bench) {
+    for (std::size_t i = 0; i < CANONICAL_VIEWPORTS.size(); ++i) {
+        bench->Arg(static_cast<std::int64_t>(i));
+    }
+}
+
+}  // namespace benchutil
@@ -0,0 +1,28 @@
+# Завершение обучающего прогона PGO: Clang пишет сырые профили *.profraw, которые нужно слить
+# в default.profdata; GCC сразу пишет *.gcda, готовые для -fprofile-use.
+#
+# cmake -DPGO_DIR=<dir> -DCOMPILER_ID=<id> -P pgo_merge.cmake
+
+if(NOT COMPILER_ID MATCHES "Clang")
+    file(GLOB_RECURSE PROFILES "${PGO_DIR}/*.gcda")
+    list(LENGTH PROFILES COUNT)
+    message(STATUS "PGO: ${COUNT} profile files in ${PGO_DIR}")
+    return()
+endif()
+
+find_program(LLVM_PROFDATA NAMES llvm-profdata)
+if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "llvm-profdata not found: cannot merge Clang profiles")
+endif()
+
+file(GLOB RAW_PROFILES "${PGO_DIR}/*.profraw")
+if(NOT RAW_PROFILES)
+    message(FATAL_ERROR "No *.profraw files in ${PGO_DIR}: the training run produced no profile")
+endif()
+
+execute_process(COMMAND "${LLVM_PROFDATA}" merge "-output=${PGO_DIR}/default.profdata" ${RAW_PROFILES}
+                RESULT_VARIABLE RESULT)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed")
+endif()
+message(STATUS "PGO: merged profile written to ${PGO_DIR}/default.profdata")
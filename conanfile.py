@@ -10,6 +10,8 @@ class GeometryAppConan(ConanFile):
     
     def requirements(self):
         self.requires("gtest/1.13.0")
+        self.requires("zlib/1.3.1")
+        self.requires("benchmark/1.8.3")
         self.tool_requires("cmake/3.30.0")
     
     def layout(self):
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "mandelbrot_fractal_utils.hpp"
+#include "types.hpp"
+
+// Адаптивное сглаживание: кадр сначала считается по одному сэмплу на пиксель, затем дополнительные
+// сэмплы получают только пиксели на границах — там, где итерации соседей заметно отличаются.
+
+namespace aa {
+
+// Индексы (y * width + x) пикселей, у которых хотя бы один из 4 соседей отличается больше чем на порог
+[[nodiscard]] inline std::vector<std::uint32_t> FindEdgePixels(const PixelMatrix &iterations, std::uint32_t threshold) {
+    std::vector<std::uint32_t> edges;
+    const auto height = static_cast<std::uint32_t>(iterations.size());
+    if (height == 0) {
+        return edges;
+    }
+    const auto width = static_cast<std::uint32_t>(iterations.front().size());
+
+    auto differs = [threshold](std::uint32_t a, std::uint32_t b) { return (a > b ? a - b : b - a) > threshold; };
+
+    for (std::uint32_t y = 0; y < height; ++y) {
+        const auto &row = iterations[y];
+        for (std::uint32_t x = 0; x < width; ++x) {
+            const auto it = row[x];
+            if ((x > 0 && differs(it, row[x - 1])) || (x + 1 < width && differs(it, row[x + 1])) ||
+                (y > 0 && differs(it, iterations[y - 1][x])) || (y + 1 < height && differs(it, iterations[y + 1][x]))) {
+                edges.push_back(y * width + x);
+            }
+        }
+    }
+    return edges;
+}
+
+// Детерминированный хеш для дрожания сэмплов: одинаковый кадр всегда сглаживается одинаково
+[[nodiscard]] constexpr double HashToUnit(std::uint32_t x, std::uint32_t y, std::uint32_t sample) noexcept {
+    std::uint64_t h = (static_cast<std::uint64_t>(x) << 32) ^ (static_cast<std::uint64_t>(y) << 12) ^ sample;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<double>(h >> 11) * 0x1.0p-53;
+}
+
+// Смещение сэмпла от левого верхнего угла пикселя, в долях пикселя
+struct SampleOffset {
+    double dx;
+    double dy;
+};
+
+// Стратифицированная сетка сэмплов: samples ячеек раскладываются по сетке cols x rows, которая
+// покрывает весь пиксель и при неквадратном числе сэмплов; внутри ячейки сэмпл дрожит
+struct SampleGrid {
+    std::uint32_t cols;
+    std::uint32_t rows;
+
+    explicit SampleGrid(std::uint32_t samples)
+        : cols{std::max(static_cast<std::uint32_t>(std::ceil(std::sqrt(static_cast<double>(samples)))), 1u)},
+          rows{std::max((samples + cols - 1) / cols, 1u)} {}
+
+    [[nodiscard]] SampleOffset Offset(std::uint32_t x, std::uint32_t y, std::uint32_t s) const noexcept {
+        return {((s % cols) + HashToUnit(x, y, 2 * s)) / cols, ((s / cols) + HashToUnit(x, y, 2 * s + 1)) / rows};
+    }
+};
+
+// Усреднённый цвет пикселя: исходный сэмпл плюс samples стратифицированных сэмплов
+[[nodiscard]] inline mandelbrot::RgbColor SupersamplePixel(const mandelbrot::ViewPort &viewport,
+                                                          const RenderSettings &settings, std::uint32_t x,
+                                                          std::uint32_t y, mandelbrot::RgbColor base_color) {
+    const auto samples = settings.aa_samples;
+    const SampleGrid grid{samples};
+
+    std::uint32_t r = base_color.r;
+    std::uint32_t g = base_color.g;
+    std::uint32_t b = base_color.b;
+
+    for (std::uint32_t s = 0; s < samples; ++s) {
+        const auto [dx, dy] = grid.Offset(x, y, s);
+        const mandelbrot::Complex c{
+            viewport.x_min + ((static_cast<double>(x) + dx) / settings.width) * viewport.width(),
+            viewport.y_min + ((static_cast<double>(y) + dy) / settings.height) * viewport.height()};
+
+        const auto it = mandelbrot::CalculateIterationsForPoint(c, settings.max_iterations, settings.escape_radius);
+        const auto color = mandelbrot::IterationsToColor(it, settings.max_iterations);
+        r += color.r;
+        g += color.g;
+        b += color.b;
+    }
+
+    const auto total = samples + 1;
+    return mandelbrot::RgbColor{static_cast<std::uint8_t>((r + total / 2) / total),
+                                static_cast<std::uint8_t>((g + total / 2) / total),
+                                static_cast<std::uint8_t>((b + total / 2) / total)};
+}
+
+// Досэмплирует часть [begin, end) списка граничных пикселей и обновляет цвета кадра
+inline void SupersampleEdges(RenderResult &result, const std::vector<std::uint32_t> &edges, std::size_t begin,
+                             std::size_t end) {
+    const auto &settings = result.settings;
+    for (std::size_t i = begin; i < end; ++i) {
+        const auto x = edges[i] % settings.width;
+        const auto y = edges[i] / settings.width;
+        auto *rgba = result.rgba_data.data() + static_cast<std::size_t>(edges[i]) * RGBA_CHANNELS;
+        StoreRgba(rgba, SupersamplePixel(result.viewport, settings, x, y, LoadRgba(rgba)));
+    }
+}
+
+}  // namespace aa
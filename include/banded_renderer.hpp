@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <thread>
+
+#include <stdexec/execution.hpp>
+
+#include "image_writer.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "mandelbrot_sender.hpp"
+#include "types.hpp"
+
+// Рендер изображений, которые не помещаются в память: кадр считается полосами, каждая полоса сжимается
+// на пуле и уходит в асинхронный писатель, который пишет полосы в файл строго по порядку.
+// Одновременно в памяти живёт не больше bands_in_flight полос.
+
+struct BandedRenderOptions {
+    std::uint32_t band_rows{64};
+    std::uint32_t bands_in_flight{2 * THREAD_POOL_SIZE};
+    int compression_level{image::DEFAULT_COMPRESSION_LEVEL};
+};
+
+struct BandedRenderStats {
+    std::uint32_t bands{};
+    std::uint64_t compressed_bytes{};
+    // Наибольшее число полос, одновременно находившихся в памяти
+    std::uint32_t peak_bands_in_flight{};
+    std::chrono::nanoseconds total_time{};
+    // Суммарное время потоков пула на расчёт и сжатие полос
+    std::chrono::nanoseconds compute_time{};
+    // Время потока-писателя, занятое записью (без ожидания полос)
+    std::chrono::nanoseconds write_time{};
+};
+
+namespace banded {
+
+// Считает полосу построчно, переводит итерации в цвет и сжимает. Вместо матрицы итераций всей полосы
+// в памяти держится одна строка.
+[[nodiscard]] inline image::DeflatedBand RenderBand(const mandelbrot::ViewPort &viewport,
+                                                    const RenderSettings &settings, std::uint32_t start_row,
+                                                    std::uint32_t rows, bool final, int level) {
+    RgbaBuffer rgba(static_cast<std::size_t>(settings.width) * rows * RGBA_CHANNELS);
+    auto *dst = rgba.data();
+    for (std::uint32_t r = start_row; r < start_row + rows; ++r) {
+        const auto row = ComputePixelMatrixForRegion(viewport, settings, {r, r + 1, 0, settings.width});
+        for (const auto it : row.front()) {
+            StoreRgba(dst, mandelbrot::IterationsToColor(it, settings.max_iterations));
+            dst += RGBA_CHANNELS;
+        }
+    }
+    return image::MakeDeflatedBand(rgba.data(), settings.width, rows, final, level);
+}
+
+// Собирает полосы, пришедшие в произвольном порядке, и отдаёт их писателю по возрастанию номера
+class BandReorderBuffer {
+public:
+    void Put(std::uint32_t index, image::DeflatedBand band) {
+        {
+            std::lock_guard lock{mutex_};
+            ready_.emplace(index, std::move(band));
+        }
+        cv_.notify_one();
+    }
+
+    void Fail(std::exception_ptr error) {
+        {
+            std::lock_guard lock{mutex_};
+            if (!error_) {
+                error_ = std::move(error);
+            }
+        }
+        cv_.notify_all();
+    }
+
+    // Ждёт полосу с номером index; пустой результат означает, что один из исполнителей упал
+    [[nodiscard]] std::optional<image::DeflatedBand> Take(std::uint32_t index) {
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [&] { return error_ || ready_.contains(index); });
+        if (error_) {
+            return std::nullopt;
+        }
+        auto node = ready_.extract(index);
+        return std::move(node.mapped());
+    }
+
+    [[nodiscard]] std::exception_ptr Error() const {
+        std::lock_guard lock{mutex_};
+        return error_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::uint32_t, image::DeflatedBand> ready_;
+    std::exception_ptr error_;
+};
+
+}  // namespace banded
+
+template <typename Renderer>
+BandedRenderStats RenderBandedToPng(Renderer &renderer, const mandelbrot::ViewPort &viewport,
+                                    const RenderSettings &settings, const std::filesystem::path &path,
+                                    BandedRenderOptions options = {}) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    options.band_rows = std::max(options.band_rows, 1u);
+    options.bands_in_flight = std::max(options.bands_in_flight, 1u);
+    const auto band_count = (settings.height + options.band_rows - 1) / options.band_rows;
+
+    image::PngWriter writer{path, settings.width, settings.height};
+    banded::BandReorderBuffer reorder;
+    std::counting_semaphore<> slots{options.bands_in_flight};
+    std::atomic<std::int64_t> compute_ns{0};
+    std::atomic<std::uint32_t> outstanding{0};
+
+    BandedRenderStats stats;
+    stats.bands = band_count;
+
+    // Писатель освобождает слот только после записи полосы на диск — так память ограничена сверху
+    std::atomic<std::uint32_t> live_bands{0};
+    std::thread writer_thread{[&] {
+        for (std::uint32_t i = 0; i < band_count; ++i) {
+            auto band = reorder.Take(i);
+            if (band) {
+                const auto write_start = Clock::now();
+                try {
+                    writer.WriteBand(*band);
+                } catch (...) {
+                    reorder.Fail(std::current_exception());
+                    band.reset();
+                }
+                stats.write_time += Clock::now() - write_start;
+            }
+            if (!band) {
+                // Разблокируем производителя, если он ждёт свободный слот
+                slots.release(options.bands_in_flight);
+                return;
+            }
+            live_bands.fetch_sub(1, std::memory_order_relaxed);
+            slots.release();
+        }
+    }};
+
+    auto sched = renderer.GetScheduler();
+    for (std::uint32_t i = 0; i < band_count && !reorder.Error(); ++i) {
+        slots.acquire();
+        stats.peak_bands_in_flight =
+            std::max(stats.peak_bands_in_flight, live_bands.fetch_add(1, std::memory_order_relaxed) + 1);
+
+        const auto start_row = i * options.band_rows;
+        const auto rows = std::min(options.band_rows, settings.height - start_row);
+        const bool final = i + 1 == band_count;
+
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        stdexec::start_detached(stdexec::schedule(sched) | stdexec::then([&, i, start_row, rows, final]() noexcept {
+                                    const auto band_start = Clock::now();
+                                    try {
+                                        reorder.Put(i, banded::RenderBand(viewport, settings, start_row, rows, final,
+                                                                          options.compression_level));
+                                    } catch (...) {
+                                        reorder.Fail(std::current_exception());
+                                    }
+                                    compute_ns.fetch_add((Clock::now() - band_start).count(),
+                                                         std::memory_order_relaxed);
+                                    if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                                        outstanding.notify_all();
+                                    }
+                                }));
+    }
+
+    writer_thread.join();
+    // Дожидаемся исполнителей: они обращаются к локальным объектам этой функции
+    auto n = outstanding.load(std::memory_order_acquire);
+    while (n != 0) {
+        outstanding.wait(n, std::memory_order_acquire);
+        n = outstanding.load(std::memory_order_acquire);
+    }
+    if (auto error = reorder.Error()) {
+        std::rethrow_exception(error);
+    }
+
+    writer.Finish();
+    stats.compressed_bytes = writer.CompressedBytes();
+    stats.compute_time = std::chrono::nanoseconds{compute_ns.load()};
+    stats.total_time = Clock::now() - start;
+    return stats;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "mandelbrot_fractal_utils.hpp"
+
+// Набор эталонных областей для измерений производительности, тренировки PGO и сравнения ядер.
+// Области сильно отличаются по нагрузке: от почти пустого фона до границы, где большинство точек
+// доходит до предела итераций.
+
+struct CanonicalViewport {
+    std::string_view name;
+    mandelbrot::ViewPort viewport;
+    std::uint32_t max_iterations;
+};
+
+inline constexpr std::array<CanonicalViewport, 4> CANONICAL_VIEWPORTS{{
+    // Всё множество: много быстро убегающих точек и большая внутренняя область
+    {"full_set", {-2.5, 1.5, -2.0, 2.0}, 256},
+    // Долина морских коньков между главной кардиоидой и кругом периода 2
+    {"seahorse_valley", {-0.7625, -0.7375, 0.0875, 0.1125}, 1024},
+    // Долина слонов справа от главной кардиоиды
+    {"elephant_valley", {0.27, 0.29, 0.0, 0.02}, 1024},
+    // Мини-множество периода 3 на вещественной оси
+    {"minibrot", {-1.7748776662, -1.7348776662, -0.02, 0.02}, 2048},
+}};
+
+[[nodiscard]] constexpr const CanonicalViewport *FindCanonicalViewport(std::string_view name) noexcept {
+    for (const auto &canonical : CANONICAL_VIEWPORTS) {
+        if (canonical.name == name) {
+            return &canonical;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Разбор аргументов командной строки, общий для консольных программ
+
+namespace cli {
+
+// Число целиком из text; option попадает в сообщение об ошибке
+template <typename T>
+[[nodiscard]] T ParseNumber(std::string_view text, std::string_view option) {
+    T value{};
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || ptr != text.data() + text.size()) {
+        throw std::invalid_argument("Invalid value '" + std::string{text} + "' for " + std::string{option});
+    }
+    return value;
+}
+
+// Части text между разделителями, включая пустые: "1,,2" -> {"1", "", "2"}
+[[nodiscard]] inline std::vector<std::string_view> Split(std::string_view text, char separator) {
+    std::vector<std::string_view> parts;
+    for (auto pos = text.find(separator); pos != std::string_view::npos; pos = text.find(separator)) {
+        parts.push_back(text.substr(0, pos));
+        text.remove_prefix(pos + 1);
+    }
+    parts.push_back(text);
+    return parts;
+}
+
+}  // namespace cli
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string_view>
+
+// Уровни микроархитектуры x86-64 (psABI), под которые собираются варианты исполняемых файлов,
+// и определение наибольшего уровня, который поддерживают процессор и ОС.
+
+namespace cpu {
+
+enum class IsaLevel {
+    BASELINE = 0,
+    X86_64_V2 = 1,
+    X86_64_V3 = 2,
+    X86_64_V4 = 3,
+};
+
+inline constexpr std::array<std::string_view, 4> ISA_NAMES{"baseline", "x86-64-v2", "x86-64-v3", "x86-64-v4"};
+
+[[nodiscard]] constexpr std::string_view IsaName(IsaLevel level) noexcept {
+    return ISA_NAMES[static_cast<std::size_t>(level)];
+}
+
+[[nodiscard]] constexpr std::optional<IsaLevel> ParseIsaLevel(std::string_view name) noexcept {
+    for (std::size_t i = 0; i < ISA_NAMES.size(); ++i) {
+        if (ISA_NAMES[i] == name) {
+            return static_cast<IsaLevel>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+// __builtin_cpu_supports учитывает и поддержку ОС: AVX и AVX-512 считаются доступными,
+// только если ядро сохраняет их регистры при переключении контекста
+[[nodiscard]] inline IsaLevel DetectIsaLevel() noexcept {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(_M_X64))
+    __builtin_cpu_init();
+    const bool v2 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("ssse3") &&
+                    __builtin_cpu_supports("popcnt");
+    const bool v3 = v2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+                    __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+    const bool v4 = v3 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                    __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+                    __builtin_cpu_supports("avx512vl");
+    if (v4) {
+        return IsaLevel::X86_64_V4;
+    }
+    if (v3) {
+        return IsaLevel::X86_64_V3;
+    }
+    if (v2) {
+        return IsaLevel::X86_64_V2;
+    }
+#endif
+    return IsaLevel::BASELINE;
+}
+
+}  // namespace cpu
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "types.hpp"
+
+[[nodiscard]] constexpr bool IsEmptyRegion(const PixelRegion &region) noexcept {
+    return region.start_row >= region.end_row || region.start_col >= region.end_col;
+}
+
+[[nodiscard]] constexpr PixelRegion FullFrameRegion(const RenderSettings &settings) noexcept {
+    return PixelRegion{.start_row = 0, .end_row = settings.height, .start_col = 0, .end_col = settings.width};
+}
+
+// Объединяет соседние прямоугольники, чтобы сократить число вызовов выгрузки в текстуру.
+// Сначала склеиваются тайлы одной полосы строк, стоящие вплотную по горизонтали, затем
+// получившиеся полосы одинаковой ширины, стоящие друг под другом.
+[[nodiscard]] inline std::vector<PixelRegion> MergeDirtyRegions(std::vector<PixelRegion> regions) {
+    std::erase_if(regions, [](const PixelRegion &r) { return IsEmptyRegion(r); });
+    if (regions.size() < 2) {
+        return regions;
+    }
+
+    auto merge_pass = [&regions](auto key, auto can_merge, auto merge) {
+        std::sort(regions.begin(), regions.end(), [&key](const auto &a, const auto &b) { return key(a) < key(b); });
+
+        std::vector<PixelRegion> merged;
+        merged.reserve(regions.size());
+        for (const auto &region : regions) {
+            if (!merged.empty() && can_merge(merged.back(), region)) {
+                merge(merged.back(), region);
+            } else {
+                merged.push_back(region);
+            }
+        }
+        regions = std::move(merged);
+    };
+
+    merge_pass([](const PixelRegion &r) { return std::tuple{r.start_row, r.end_row, r.start_col}; },
+               [](const PixelRegion &prev, const PixelRegion &cur) {
+                   return prev.start_row == cur.start_row && prev.end_row == cur.end_row &&
+                          cur.start_col <= prev.end_col;
+               },
+               [](PixelRegion &prev, const PixelRegion &cur) { prev.end_col = std::max(prev.end_col, cur.end_col); });
+
+    merge_pass([](const PixelRegion &r) { return std::tuple{r.start_col, r.end_col, r.start_row}; },
+               [](const PixelRegion &prev, const PixelRegion &cur) {
+                   return prev.start_col == cur.start_col && prev.end_col == cur.end_col &&
+                          cur.start_row <= prev.end_row;
+               },
+               [](PixelRegion &prev, const PixelRegion &cur) { prev.end_row = std::max(prev.end_row, cur.end_row); });
+
+    // Выгружаем сверху вниз, в порядке расположения в буфере
+    std::sort(regions.begin(), regions.end(), [](const PixelRegion &a, const PixelRegion &b) {
+        return std::tie(a.start_row, a.start_col) < std::tie(b.start_row, b.start_col);
+    });
+    return regions;
+}
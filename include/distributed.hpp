@@ -0,0 +1,473 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+#include "mandelbrot_renderer.hpp"
+#include "net_utils.hpp"
+#include "types.hpp"
+
+// Распределённый рендер: координатор делит кадр на полосы и раздаёт их по TCP рабочим процессам с теми же
+// вычислительными ядрами. Полосы упавшего или зависшего рабочего возвращаются в очередь и достаются другим;
+// если живых рабочих не осталось, рендер завершается ошибкой.
+//
+// Протокол — кадры [тип u32][длина u32][данные], числа в little-endian:
+//   JOB      координатор -> рабочий: id, область, viewport, параметры рендера
+//   RESULT   рабочий -> координатор: id, область, RGBA строки области
+//   SHUTDOWN координатор -> рабочий: работы больше нет
+
+namespace dist {
+
+enum class MessageType : std::uint32_t { JOB = 1, RESULT = 2, SHUTDOWN = 3 };
+
+// Защита от мусора в заголовке кадра
+inline constexpr std::uint32_t MAX_PAYLOAD = 1u << 30;
+
+struct Message {
+    MessageType type;
+    std::string payload;
+};
+
+struct Job {
+    std::uint32_t id{};
+    PixelRegion region;
+    mandelbrot::ViewPort viewport;
+    RenderSettings settings;
+};
+
+inline void AppendU32(std::string &out, std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>(value >> shift));
+    }
+}
+
+inline void AppendF64(std::string &out, double value) {
+    const auto bits = std::bit_cast<std::uint64_t>(value);
+    AppendU32(out, static_cast<std::uint32_t>(bits));
+    AppendU32(out, static_cast<std::uint32_t>(bits >> 32));
+}
+
+// Последовательное чтение полей; выход за конец данных — исключение
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view data) : data_{data} {}
+
+    std::uint32_t U32() {
+        const auto bytes = Take(4);
+        std::uint32_t value = 0;
+        for (int i = 3; i >= 0; --i) {
+            value = (value << 8) | static_cast<std::uint8_t>(bytes[i]);
+        }
+        return value;
+    }
+
+    double F64() {
+        const std::uint64_t low = U32();
+        const std::uint64_t high = U32();
+        return std::bit_cast<double>(low | (high << 32));
+    }
+
+    std::string_view Take(std::size_t size) {
+        if (size > data_.size()) {
+            throw std::runtime_error("Truncated message");
+        }
+        const auto result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+
+    [[nodiscard]] std::size_t Remaining() const noexcept { return data_.size(); }
+
+private:
+    std::string_view data_;
+};
+
+inline void AppendRegion(std::string &out, const PixelRegion &region) {
+    AppendU32(out, region.start_row);
+    AppendU32(out, region.end_row);
+    AppendU32(out, region.start_col);
+    AppendU32(out, region.end_col);
+}
+
+inline PixelRegion ReadRegion(PayloadReader &reader) {
+    PixelRegion region;
+    region.start_row = reader.U32();
+    region.end_row = reader.U32();
+    region.start_col = reader.U32();
+    region.end_col = reader.U32();
+    return region;
+}
+
+[[nodiscard]] inline std::string EncodeJob(const Job &job) {
+    std::string out;
+    AppendU32(out, job.id);
+    AppendRegion(out, job.region);
+    AppendF64(out, job.viewport.x_min);
+    AppendF64(out, job.viewport.x_max);
+    AppendF64(out, job.viewport.y_min);
+    AppendF64(out, job.viewport.y_max);
+    AppendU32(out, job.settings.width);
+    AppendU32(out, job.settings.height);
+    AppendU32(out, job.settings.max_iterations);
+    AppendF64(out, job.settings.escape_radius);
+    AppendU32(out, static_cast<std::uint32_t>(job.settings.kernel));
+    return out;
+}
+
+[[nodiscard]] inline Job DecodeJob(std::string_view payload) {
+    PayloadReader reader{payload};
+    Job job;
+    job.id = reader.U32();
+    job.region = ReadRegion(reader);
+    job.viewport.x_min = reader.F64();
+    job.viewport.x_max = reader.F64();
+    job.viewport.y_min = reader.F64();
+    job.viewport.y_max = reader.F64();
+    job.settings.width = reader.U32();
+    job.settings.height = reader.U32();
+    job.settings.max_iterations = reader.U32();
+    job.settings.escape_radius = reader.F64();
+    const auto kernel = reader.U32();
+    if (kernel >= mandelbrot::KERNEL_NAMES.size()) {
+        throw std::runtime_error("Unknown kernel in job");
+    }
+    job.settings.kernel = static_cast<mandelbrot::Kernel>(kernel);
+    return job;
+}
+
+[[nodiscard]] inline std::string EncodeResult(std::uint32_t id, const RenderedTile &tile) {
+    std::string out;
+    out.reserve(20 + tile.rgba.size());
+    AppendU32(out, id);
+    AppendRegion(out, tile.region);
+    out.append(reinterpret_cast<const char *>(tile.rgba.data()), tile.rgba.size());
+    return out;
+}
+
+[[nodiscard]] inline bool SendMessage(const net::Socket &socket, MessageType type, std::string_view payload) {
+    std::string header;
+    AppendU32(header, static_cast<std::uint32_t>(type));
+    AppendU32(header, static_cast<std::uint32_t>(payload.size()));
+    return net::SendAll(socket, header) && net::SendAll(socket, payload);
+}
+
+// Пустой результат — соединение закрыто, истёк таймаут или пришёл повреждённый заголовок
+[[nodiscard]] inline std::optional<Message> ReceiveMessage(const net::Socket &socket) {
+    char header[8];
+    if (!net::RecvExact(socket, header, sizeof(header))) {
+        return std::nullopt;
+    }
+    PayloadReader reader{{header, sizeof(header)}};
+    const auto type = reader.U32();
+    const auto size = reader.U32();
+    if (size > MAX_PAYLOAD || type < 1 || type > 3) {
+        return std::nullopt;
+    }
+    Message message{static_cast<MessageType>(type), std::string(size, '\0')};
+    if (!net::RecvExact(socket, message.payload.data(), size)) {
+        return std::nullopt;
+    }
+    return message;
+}
+
+// Рабочий процесс: подключается к координатору и считает присланные полосы на своём пуле, пока координатор
+// не пришлёт SHUTDOWN или не закроет соединение. Возвращает число посчитанных полос; ошибка разбора задания
+// пробрасывается после того, как все запущенные полосы завершились.
+template <typename Renderer>
+std::uint32_t RunWorker(Renderer &renderer, const std::string &host, std::uint16_t port) {
+    const auto socket = net::ConnectTcp(host, port);
+    auto sched = renderer.GetScheduler();
+
+    std::mutex send_mutex;
+    std::atomic<std::uint32_t> outstanding{0};
+    std::atomic<std::uint32_t> rendered{0};
+
+    std::exception_ptr error;
+    while (const auto message = ReceiveMessage(socket)) {
+        if (message->type != MessageType::JOB) {
+            break;
+        }
+        std::optional<Job> decoded;
+        try {
+            decoded = DecodeJob(message->payload);
+        } catch (...) {
+            // Испорченное задание: больше не принимаем, но сначала ждём уже запущенные полосы ниже
+            error = std::current_exception();
+            break;
+        }
+        const auto &job = *decoded;
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        stdexec::start_detached(stdexec::schedule(sched) | stdexec::then([&, job]() noexcept {
+                                    try {
+                                        const auto payload =
+                                            EncodeResult(job.id, RenderTile(job.viewport, job.settings, job.region));
+                                        std::lock_guard lock{send_mutex};
+                                        if (SendMessage(socket, MessageType::RESULT, payload)) {
+                                            rendered.fetch_add(1, std::memory_order_relaxed);
+                                        }
+                                    } catch (...) {
+                                        // Полоса не отправлена: координатор отдаст её другому рабочему
+                                    }
+                                    if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                                        outstanding.notify_all();
+                                    }
+                                }));
+    }
+
+    // Исполнители обращаются к сокету и локальным переменным — дожидаемся их
+    auto n = outstanding.load(std::memory_order_acquire);
+    while (n != 0) {
+        outstanding.wait(n, std::memory_order_acquire);
+        n = outstanding.load(std::memory_order_acquire);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return rendered.load();
+}
+
+struct DistributedOptions {
+    std::uint32_t tile_rows{16};
+    // Сколько полос держит в работе один рабочий: должно хватать на все его потоки с запасом на сеть
+    std::uint32_t jobs_per_worker{2 * THREAD_POOL_SIZE};
+    // Рабочий, молчащий дольше, считается зависшим, и его полосы возвращаются в очередь
+    std::chrono::milliseconds worker_timeout{30000};
+    // Сколько кадр может стоять без единого подключённого рабочего, прежде чем Render сдастся
+    std::chrono::milliseconds idle_timeout{60000};
+    // Необязательная проверка, что рабочих больше не будет (например, все запущенные процессы завершились):
+    // тогда Render сдаётся, как только не осталось подключённых рабочих, не дожидаясь idle_timeout
+    std::function<bool()> workers_gone;
+};
+
+struct DistributedStats {
+    std::uint32_t tiles{};
+    std::uint32_t workers{};
+    std::uint32_t worker_failures{};
+    std::uint32_t requeued_tiles{};
+    // Полосы, посчитанные дважды после возврата в очередь
+    std::uint32_t duplicate_results{};
+    std::chrono::nanoseconds total_time{};
+};
+
+struct DistributedResult {
+    RgbaBuffer rgba;
+    DistributedStats stats;
+};
+
+class Coordinator {
+public:
+    Coordinator(const std::string &host, std::uint16_t port) : listener_{net::ListenTcp(host, port)} {
+        net::SetNonBlocking(listener_);
+    }
+
+    [[nodiscard]] std::uint16_t Port() const { return net::LocalPort(listener_); }
+
+    // Блокирует до сборки всего кадра. Рабочие могут подключаться в любой момент рендера. Если кадр не собран,
+    // а подключённых рабочих нет дольше idle_timeout или workers_gone вернула true, бросает runtime_error.
+    [[nodiscard]] DistributedResult Render(const mandelbrot::ViewPort &viewport, const RenderSettings &settings,
+                                           const DistributedOptions &options = {}) {
+        const auto start = std::chrono::steady_clock::now();
+        RenderState state;
+        state.viewport = viewport;
+        state.settings = settings;
+        state.options = options;
+        state.tiles = MakeStreamTiles(settings, options.tile_rows);
+        state.done.assign(state.tiles.size(), false);
+        state.remaining = state.tiles.size();
+        state.rgba.resize(static_cast<std::size_t>(settings.width) * settings.height * RGBA_CHANNELS);
+        for (std::uint32_t i = 0; i < state.tiles.size(); ++i) {
+            state.queue.push_back(i);
+        }
+        state.stats.tiles = static_cast<std::uint32_t>(state.tiles.size());
+
+        // Слушающий сокет остаётся открытым для следующего рендера, поэтому accept прерывается через pipe
+        const net::WakePipe wake;
+        std::vector<std::thread> handlers;
+        std::thread acceptor{[&] {
+            for (;;) {
+                auto socket = net::Accept(listener_, wake);
+                std::lock_guard lock{state.mutex};
+                if (!socket.Valid() || state.finished) {
+                    return;
+                }
+                ++state.stats.workers;
+                ++state.live_workers;
+                handlers.emplace_back([this, &state, socket = std::move(socket)]() mutable {
+                    ServeWorker(state, socket);
+                    std::lock_guard handler_lock{state.mutex};
+                    --state.live_workers;
+                    state.cv.notify_all();
+                });
+            }
+        }};
+
+        bool abandoned = false;
+        {
+            std::unique_lock lock{state.mutex};
+            auto idle_since = start;
+            while (!state.cv.wait_for(lock, IDLE_POLL_INTERVAL, [&] { return state.remaining == 0; })) {
+                const auto now = std::chrono::steady_clock::now();
+                if (state.live_workers > 0) {
+                    idle_since = now;
+                } else if (now - idle_since >= options.idle_timeout ||
+                           (options.workers_gone && options.workers_gone())) {
+                    abandoned = true;
+                    break;
+                }
+            }
+            state.finished = true;
+        }
+        state.cv.notify_all();
+
+        wake.Notify();
+        acceptor.join();
+        for (auto &handler : handlers) {
+            handler.join();
+        }
+        if (abandoned) {
+            throw std::runtime_error("Distributed render abandoned: " + std::to_string(state.remaining) + " of " +
+                                     std::to_string(state.tiles.size()) + " tiles left and no live workers");
+        }
+
+        state.stats.total_time = std::chrono::steady_clock::now() - start;
+        return DistributedResult{std::move(state.rgba), state.stats};
+    }
+
+private:
+    // Как часто Render проверяет, остались ли рабочие
+    static constexpr std::chrono::milliseconds IDLE_POLL_INTERVAL{50};
+
+    struct RenderState {
+        mandelbrot::ViewPort viewport;
+        RenderSettings settings;
+        DistributedOptions options;
+        std::vector<PixelRegion> tiles;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::uint32_t> queue;
+        std::vector<bool> done;
+        std::size_t remaining{};
+        std::uint32_t live_workers{};
+        bool finished{false};
+        RgbaBuffer rgba;
+        DistributedStats stats;
+    };
+
+    // Обслуживает одного рабочего: держит у него до jobs_per_worker полос и собирает результаты
+    static void ServeWorker(RenderState &state, net::Socket &socket) {
+        const auto timeout_us = std::chrono::duration_cast<std::chrono::microseconds>(state.options.worker_timeout);
+        timeval timeout{.tv_sec = static_cast<time_t>(timeout_us.count() / 1000000),
+                        .tv_usec = static_cast<suseconds_t>(timeout_us.count() % 1000000)};
+        ::setsockopt(socket.Fd(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::set<std::uint32_t> outstanding;
+        auto fail = [&] {
+            std::lock_guard lock{state.mutex};
+            ++state.stats.worker_failures;
+            for (const auto id : outstanding) {
+                if (!state.done[id]) {
+                    state.queue.push_front(id);
+                    ++state.stats.requeued_tiles;
+                }
+            }
+            state.cv.notify_all();
+        };
+
+        for (;;) {
+            std::vector<std::uint32_t> to_send;
+            {
+                std::unique_lock lock{state.mutex};
+                state.cv.wait(lock, [&] { return state.finished || !outstanding.empty() || !state.queue.empty(); });
+                if (state.finished) {
+                    lock.unlock();
+                    (void)SendMessage(socket, MessageType::SHUTDOWN, {});
+                    return;
+                }
+                while (outstanding.size() + to_send.size() < state.options.jobs_per_worker && !state.queue.empty()) {
+                    to_send.push_back(state.queue.front());
+                    state.queue.pop_front();
+                }
+            }
+
+            for (std::size_t i = 0; i < to_send.size(); ++i) {
+                const auto id = to_send[i];
+                outstanding.insert(id);
+                const Job job{id, state.tiles[id], state.viewport, state.settings};
+                if (!SendMessage(socket, MessageType::JOB, EncodeJob(job))) {
+                    outstanding.insert(to_send.begin() + static_cast<std::ptrdiff_t>(i), to_send.end());
+                    fail();
+                    return;
+                }
+            }
+
+            const auto message = ReceiveMessage(socket);
+            if (!message || message->type != MessageType::RESULT ||
+                !StoreResult(state, message->payload, outstanding)) {
+                fail();
+                return;
+            }
+        }
+    }
+
+    // Копирует строки полосы в кадр; false — рабочий прислал не то, что у него просили
+    static bool StoreResult(RenderState &state, std::string_view payload, std::set<std::uint32_t> &outstanding) {
+        try {
+            PayloadReader reader{payload};
+            const auto id = reader.U32();
+            const auto region = ReadRegion(reader);
+            if (!outstanding.contains(id)) {
+                return false;
+            }
+            const auto &expected = state.tiles[id];
+            const auto row_bytes = static_cast<std::size_t>(state.settings.width) * RGBA_CHANNELS;
+            const auto rows = expected.end_row - expected.start_row;
+            if (region.start_row != expected.start_row || region.end_row != expected.end_row ||
+                region.start_col != 0 || region.end_col != state.settings.width ||
+                reader.Remaining() != rows * row_bytes) {
+                return false;
+            }
+            const auto pixels = reader.Take(rows * row_bytes);
+            outstanding.erase(id);
+
+            std::lock_guard lock{state.mutex};
+            if (state.done[id]) {
+                ++state.stats.duplicate_results;
+                return true;
+            }
+            std::memcpy(state.rgba.data() + expected.start_row * row_bytes, pixels.data(), pixels.size());
+            state.done[id] = true;
+            if (--state.remaining == 0) {
+                state.cv.notify_all();
+            }
+            return true;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+    net::Socket listener_;
+};
+
+}  // namespace dist
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+struct DurationSummary {
+    std::uint64_t count{};
+    std::chrono::microseconds p50{};
+    std::chrono::microseconds p99{};
+    std::chrono::microseconds max{};
+};
+
+// Гистограмма длительностей с BIN_COUNT корзинами шириной BIN_WIDTH_US микросекунд.
+// Всё, что дольше, попадает в последнюю корзину (максимум хранится точно).
+// Запись и чтение потокобезопасны, поэтому статистику можно запрашивать во время работы конвейера.
+template <std::int64_t BIN_WIDTH_US, std::size_t BIN_COUNT_>
+class DurationHistogram {
+public:
+    static constexpr std::chrono::microseconds BIN_WIDTH{BIN_WIDTH_US};
+    static constexpr std::size_t BIN_COUNT = BIN_COUNT_;
+
+    using Summary = DurationSummary;
+
+    void Record(std::chrono::nanoseconds duration) noexcept {
+        const auto us =
+            std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0);
+        const auto bin = std::min<std::size_t>(static_cast<std::size_t>(us / BIN_WIDTH.count()), BIN_COUNT - 1);
+
+        bins_[bin].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+
+        auto prev_max = max_us_.load(std::memory_order_relaxed);
+        while (prev_max < us && !max_us_.compare_exchange_weak(prev_max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Верхняя граница корзины, в которую попадает перцентиль p (0..1)
+    [[nodiscard]] std::chrono::microseconds Percentile(double p) const noexcept {
+        const auto total = count_.load(std::memory_order_relaxed);
+        if (total == 0) {
+            return std::chrono::microseconds{0};
+        }
+
+        const auto rank = std::max<std::uint64_t>(static_cast<std::uint64_t>(p * static_cast<double>(total)), 1);
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BIN_COUNT; ++i) {
+            seen += bins_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return std::min(BIN_WIDTH * static_cast<std::int64_t>(i + 1), Max());
+            }
+        }
+        return Max();
+    }
+
+    [[nodiscard]] std::chrono::microseconds Max() const noexcept {
+        return std::chrono::microseconds{max_us_.load(std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] std::uint64_t Count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] Summary GetSummary() const noexcept {
+        return Summary{.count = Count(), .p50 = Percentile(0.50), .p99 = Percentile(0.99), .max = Max()};
+    }
+
+    void Reset() noexcept {
+        for (auto &bin : bins_) {
+            bin.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        max_us_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<std::uint32_t>, BIN_COUNT> bins_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::int64_t> max_us_{0};
+};
+
+// Кадры: 0 .. 250 мс с шагом 100 мкс
+using FrameTimeHistogram = DurationHistogram<100, 2500>;
+
+// Задержки запросов (тайлы, сеть): 0 .. 10 с с тем же шагом — промах кэша на глубоком приближении
+// легко длится дольше кадра
+using LatencyHistogram = DurationHistogram<100, 100000>;
+
+struct FrameStats {
+    // Интервал между соседними показами кадра
+    FrameTimeHistogram frame_time;
+    // Выгрузка кадра в текстуру, отрисовка и показ окна
+    FrameTimeHistogram present_time;
+};
+
+// Планировщик показа кадров по абсолютным дедлайнам.
+// Каждый следующий дедлайн отсчитывается от предыдущего, а не от момента пробуждения, поэтому
+// ошибка одного кадра не накапливается. Поток спит до дедлайна без активного ожидания: опоздание
+// пробуждения (обычно десятки микросекунд) остаётся дрожанием одного кадра и не сдвигает расписание.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacer(FrameStats &stats, double target_fps)
+        : stats_{stats},
+          period_{std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{1.0 / target_fps})},
+          last_present_{Clock::now()}, next_deadline_{last_present_ + period_} {}
+
+    void WaitForNextFrame() {
+        std::this_thread::sleep_until(next_deadline_);
+
+        const auto now = Clock::now();
+        stats_.frame_time.Record(now - last_present_);
+        last_present_ = now;
+
+        next_deadline_ += period_;
+        // Кадр отстал больше чем на период — не пытаемся догонять пачкой кадров, начинаем отсчёт заново
+        if (next_deadline_ <= now) {
+            next_deadline_ = now + period_;
+        }
+    }
+
+    void operator()() { WaitForNextFrame(); }
+
+    [[nodiscard]] Clock::duration Period() const noexcept { return period_; }
+    [[nodiscard]] Clock::time_point NextDeadline() const noexcept { return next_deadline_; }
+
+private:
+    FrameStats &stats_;
+    Clock::duration period_;
+    Clock::time_point last_present_;
+    Clock::time_point next_deadline_;
+};
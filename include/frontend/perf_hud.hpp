@@ -0,0 +1,123 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "hud_stats.hpp"
+#include "types.hpp"
+
+// Экранная панель производительности поверх кадра. Текст пересобирается раз в период HudCounters,
+// а между обновлениями панель рисуется готовыми sf::Text и прямоугольником подложки.
+class PerfHud {
+public:
+    using Clock = HudCounters::Clock;
+
+    static constexpr unsigned FONT_SIZE = 14;
+
+    explicit PerfHud(std::string kernel, std::uint32_t max_iterations = 0)
+        : kernel_{std::move(kernel)}, max_iterations_{max_iterations} {
+        background_.setFillColor(sf::Color{0, 0, 0, 160});
+        background_.setPosition(4.0f, 4.0f);
+        text_.setCharacterSize(FONT_SIZE);
+        text_.setFillColor(sf::Color::White);
+        text_.setPosition(10.0f, 8.0f);
+    }
+
+    PerfHud(const PerfHud &) = delete;
+    PerfHud &operator=(const PerfHud &) = delete;
+
+    // Шрифт из MANDELBROT_HUD_FONT или один из системных моноширинных. Без шрифта панель не рисуется.
+    bool LoadFont() {
+        if (const char *path = std::getenv("MANDELBROT_HUD_FONT"); path != nullptr && font_.loadFromFile(path)) {
+            return SetFontLoaded();
+        }
+        constexpr std::array FONT_PATHS{
+            "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+            "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+            "/usr/share/fonts/dejavu-sans-mono-fonts/DejaVuSansMono.ttf",
+            "/System/Library/Fonts/Menlo.ttc",
+            "C:/Windows/Fonts/consola.ttf",
+        };
+        for (const auto *path : FONT_PATHS) {
+            if (font_.loadFromFile(path)) {
+                return SetFontLoaded();
+            }
+        }
+        return false;
+    }
+
+    void SetVisible(bool visible) noexcept {
+        if (visible != visible_) {
+            visible_ = visible;
+            // Панель нужно нарисовать или стереть, даже если кадр не менялся
+            redraw_ = true;
+        }
+    }
+
+    [[nodiscard]] bool Visible() const noexcept { return visible_; }
+
+    void SetMaxIterations(std::uint32_t max_iterations) noexcept { max_iterations_ = max_iterations; }
+    void SetCacheHitRate(std::optional<double> rate) noexcept { cache_hit_rate_ = rate; }
+
+    // Учитывает проход конвейера и посчитанную в нём работу. Потоковый результат несёт статистику всего кадра
+    // только в проходе, где кадр дособран, а работа считается по полосам каждого прохода.
+    void OnFrame(const RenderResult &result) {
+        counters_.OnFrame();
+        if (result.stats.pixels_computed > 0) {
+            counters_.SetLastRender(result.stats);
+            if (result.tiles.empty()) {
+                counters_.AddWork(result.stats.pixels_computed, result.stats.total_iterations);
+            }
+        }
+        for (const auto &tile : result.tiles) {
+            const auto &region = tile.region;
+            counters_.AddWork(static_cast<std::uint64_t>(region.end_row - region.start_row) *
+                                  (region.end_col - region.start_col),
+                              tile.iterations);
+        }
+    }
+
+    void OnPresent(RenderStats::Duration present) noexcept { counters_.SetLastPresent(present); }
+
+    // true — панель изменилась и окно нужно перерисовать
+    [[nodiscard]] bool Update(Clock::time_point now) {
+        if (auto snapshot = counters_.Poll(now); snapshot && visible_ && font_loaded_) {
+            text_.setString(FormatHud(*snapshot, kernel_, max_iterations_, cache_hit_rate_));
+            const auto bounds = text_.getLocalBounds();
+            background_.setSize({bounds.left + bounds.width + 12.0f, bounds.top + bounds.height + 12.0f});
+            redraw_ = true;
+        }
+        return std::exchange(redraw_, false);
+    }
+
+    void Draw(sf::RenderTarget &target) const {
+        if (visible_ && font_loaded_) {
+            target.draw(background_);
+            target.draw(text_);
+        }
+    }
+
+private:
+    bool SetFontLoaded() {
+        font_loaded_ = true;
+        text_.setFont(font_);
+        return true;
+    }
+
+    std::string kernel_;
+    std::uint32_t max_iterations_;
+    std::optional<double> cache_hit_rate_;
+    HudCounters counters_;
+    sf::Font font_;
+    sf::Text text_;
+    sf::RectangleShape background_;
+    bool font_loaded_{false};
+    bool visible_{false};
+    bool redraw_{false};
+};
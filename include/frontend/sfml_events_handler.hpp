@@ -0,0 +1,159 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <optional>
+#include <stdexec/execution.hpp>
+
+#include "input_session.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+
+class SfmlEventHandler {
+public:
+    using sender_concept = stdexec::sender_t;
+
+    template <typename Receiver>
+    struct OperationState {
+        Receiver receiver_;
+        sf::RenderWindow &window_;
+        RenderSettings render_settings_;
+        AppState &state_;
+        sf::Clock &zoom_clock_;
+        session::SessionRecorder *recorder_;
+        session::SessionPlayer *player_;
+
+        static constexpr float ZOOM_INTERVAL_MS = 100.0f;
+
+        template <typename R>
+        explicit OperationState(R &&r, sf::RenderWindow &window, RenderSettings render_settings, AppState &state,
+                                sf::Clock &zoom_clock, session::SessionRecorder *recorder,
+                                session::SessionPlayer *player)
+            : receiver_{std::forward<R>(r)}, window_{window}, render_settings_{render_settings}, state_{state},
+              zoom_clock_{zoom_clock}, recorder_{recorder}, player_{player} {}
+
+        void start() noexcept {
+            try {
+                trace::Span span{"SfmlEventHandler", "pipeline"};
+                if (player_ != nullptr) {
+                    HandleReplay();
+                } else {
+                    session::FrameInput input;
+                    HandleEvents(input);
+                    HandleContinuousZoom(input);
+                    if (recorder_ != nullptr) {
+                        input.viewport = state_.viewport;
+                        recorder_->Record(std::move(input));
+                    }
+                }
+                span.End();
+                if (state_.should_exit)
+                    stdexec::set_stopped(std::move(receiver_));
+                else
+                    stdexec::set_value(std::move(receiver_));
+            } catch (...) {
+                stdexec::set_error(std::move(receiver_), std::current_exception());
+            }
+        }
+
+    private:
+        [[nodiscard]] static std::optional<session::InputType> ToInput(const sf::Event &event) {
+            using session::InputType;
+            switch (event.type) {
+            case sf::Event::Closed:
+                return InputType::CLOSE;
+            case sf::Event::MouseButtonPressed:
+                if (event.mouseButton.button == sf::Mouse::Left) {
+                    return InputType::LEFT_PRESS;
+                }
+                if (event.mouseButton.button == sf::Mouse::Right) {
+                    return InputType::RIGHT_PRESS;
+                }
+                break;
+            case sf::Event::MouseButtonReleased:
+                if (event.mouseButton.button == sf::Mouse::Left) {
+                    return InputType::LEFT_RELEASE;
+                }
+                if (event.mouseButton.button == sf::Mouse::Right) {
+                    return InputType::RIGHT_RELEASE;
+                }
+                break;
+            case sf::Event::KeyPressed:
+                if (event.key.code == sf::Keyboard::F1) {
+                    return InputType::TOGGLE_HUD;
+                }
+                break;
+            default:
+                break;
+            }
+            return std::nullopt;
+        }
+
+        void HandleEvents(session::FrameInput &input) {
+            sf::Event event;
+            while (window_.pollEvent(event)) {
+                if (const auto type = ToInput(event)) {
+                    session::ApplyInput(state_, *type);
+                    input.events.push_back(*type);
+                }
+            }
+        }
+
+        void HandleContinuousZoom(session::FrameInput &input) {
+            if ((state_.left_mouse_pressed || state_.right_mouse_pressed) &&
+                zoom_clock_.getElapsedTime().asMilliseconds() >= ZOOM_INTERVAL_MS) {
+
+                auto mouse_pos = sf::Mouse::getPosition(window_);
+
+                if (mouse_pos.x >= 0 && mouse_pos.x < static_cast<int>(render_settings_.width) && mouse_pos.y >= 0 &&
+                    mouse_pos.y < static_cast<int>(render_settings_.height)) {
+
+                    session::ZoomToPoint(state_, render_settings_, mouse_pos.x, mouse_pos.y,
+                                         state_.left_mouse_pressed);
+                    input.zoom = session::ZoomInput{mouse_pos.x, mouse_pos.y};
+                    zoom_clock_.restart();
+                }
+            }
+        }
+
+        // При воспроизведении ввод берётся из записи; от окна принимается только закрытие
+        void HandleReplay() {
+            sf::Event event;
+            while (window_.pollEvent(event)) {
+                if (event.type == sf::Event::Closed) {
+                    state_.should_exit = true;
+                }
+            }
+            player_->ApplyNextFrame(state_);
+            if (player_->Finished()) {
+                state_.should_exit = true;
+            }
+        }
+    };
+
+    SfmlEventHandler(sf::RenderWindow &window, RenderSettings render_settings, AppState &state, sf::Clock &zoom_clock,
+                     session::SessionRecorder *recorder = nullptr, session::SessionPlayer *player = nullptr)
+        : window_{window}, render_settings_{render_settings}, state_{state}, zoom_clock_{zoom_clock},
+          recorder_{recorder}, player_{player} {}
+
+    template <typename Receiver>
+    auto connect(Receiver &&receiver) {
+        return OperationState<std::decay_t<Receiver>>{std::forward<Receiver>(receiver), window_, render_settings_,
+                                                      state_, zoom_clock_, recorder_, player_};
+    }
+
+    template <typename Env>
+    auto get_completion_signatures(Env &&) const {
+        return stdexec::completion_signatures<stdexec::set_value_t(), stdexec::set_error_t(std::exception_ptr),
+                                              stdexec::set_stopped_t()
+                                              >{};
+    }
+
+private:
+    sf::RenderWindow &window_;
+    RenderSettings render_settings_;
+    AppState &state_;
+    sf::Clock &zoom_clock_;
+    // Запись ввода в сессию и воспроизведение записанной сессии; оба необязательны
+    session::SessionRecorder *recorder_;
+    session::SessionPlayer *player_;
+};
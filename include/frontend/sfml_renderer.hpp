@@ -0,0 +1,184 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <print>
+#include <stdexec/execution.hpp>
+
+#include "dirty_regions.hpp"
+#include "frame_pacer.hpp"
+#include "perf_hud.hpp"
+#include "render_stats.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+
+class SFMLRender {
+public:
+    template <typename Receiver>
+    struct OperationState {
+        Receiver receiver_;
+        RenderResult render_result_;
+        sf::Texture &texture_;
+        sf::Sprite &sprite_;
+        sf::RenderWindow &window_;
+        RenderSettings render_settings_;
+        FrameStats *frame_stats_;
+        PerfHud *hud_;
+        std::FILE *stats_log_;
+
+        OperationState(Receiver &&r, RenderResult rr, sf::Texture &texture, sf::Sprite &sprite,
+                       sf::RenderWindow &window, RenderSettings render_settings, FrameStats *frame_stats,
+                       PerfHud *hud, std::FILE *stats_log)
+            : receiver_{std::forward<Receiver>(r)}, render_result_{std::move(rr)}, texture_{texture}, sprite_{sprite},
+              window_{window}, render_settings_{render_settings}, frame_stats_{frame_stats}, hud_{hud},
+              stats_log_{stats_log} {}
+
+        void start() noexcept {
+            try {
+                const bool has_data = !render_result_.rgba_data.empty() || !render_result_.tiles.empty();
+                bool hud_changed = false;
+                if (hud_ != nullptr) {
+                    hud_->OnFrame(render_result_);
+                    hud_changed = hud_->Update(std::chrono::steady_clock::now());
+                }
+                if (!has_data && !hud_changed) {
+                    // ничего не рисуем, просто сигнализируем, что работа завершена
+                    stdexec::set_value(std::move(receiver_));
+                    return;
+                }
+
+                trace::Span span{"SFMLRender", "pipeline"};
+                const auto present_start = std::chrono::steady_clock::now();
+
+                const std::uint32_t height = render_settings_.height;
+                const std::uint32_t width = render_settings_.width;
+
+                if (!render_result_.rgba_data.empty()) {
+                    if (render_result_.dirty_regions.empty()) {
+                        texture_.update(render_result_.rgba_data.data(), width, height, 0, 0);
+                    } else {
+                        for (const auto &region : MergeDirtyRegions(std::move(render_result_.dirty_regions))) {
+                            UploadRegion(region, width, height);
+                        }
+                    }
+                }
+
+                // Полосы потокового рендера лежат в собственных буферах и выгружаются по мере поступления
+                for (const auto &tile : render_result_.tiles) {
+                    UploadTile(tile, width, height);
+                }
+                sprite_.setTexture(texture_, true);
+
+                window_.clear();
+                window_.draw(sprite_);
+                if (hud_ != nullptr) {
+                    hud_->Draw(window_);
+                }
+                window_.display();
+
+                const auto present_end = std::chrono::steady_clock::now();
+                const auto present_time = present_end - present_start;
+                trace::Record("present", "pipeline", present_start, present_end);
+                render_result_.stats.present = present_time;
+                if (frame_stats_ != nullptr) {
+                    frame_stats_->present_time.Record(present_time);
+                }
+                if (hud_ != nullptr) {
+                    hud_->OnPresent(present_time);
+                }
+                // Та же строка этапов, что печатает headless, — только для проходов, в которых что-то считалось
+                if (stats_log_ != nullptr && render_result_.stats.pixels_computed > 0) {
+                    std::println(stats_log_, "{}", FormatRenderStats(render_result_.stats));
+                }
+                span.End();
+
+                stdexec::set_value(std::move(receiver_));
+            } catch (...) {
+                stdexec::set_error(std::move(receiver_), std::current_exception());
+            }
+        }
+
+    private:
+        void UploadRegion(PixelRegion region, std::uint32_t width, std::uint32_t height) {
+            region.end_row = std::min(region.end_row, height);
+            region.end_col = std::min(region.end_col, width);
+            if (IsEmptyRegion(region)) {
+                return;
+            }
+
+            const auto rows = region.end_row - region.start_row;
+            const auto cols = region.end_col - region.start_col;
+            const auto row_stride = static_cast<std::size_t>(width) * RGBA_CHANNELS;
+            const auto *src = render_result_.rgba_data.data() + region.start_row * row_stride +
+                              static_cast<std::size_t>(region.start_col) * RGBA_CHANNELS;
+
+            // Полосы во всю ширину лежат в буфере непрерывно и выгружаются без копирования
+            if (cols == width) {
+                texture_.update(src, cols, rows, region.start_col, region.start_row);
+                return;
+            }
+
+            const auto region_stride = static_cast<std::size_t>(cols) * RGBA_CHANNELS;
+            region_pixels_.resize(region_stride * rows);
+            for (std::uint32_t r = 0; r < rows; ++r) {
+                std::copy_n(src + r * row_stride, region_stride, region_pixels_.data() + r * region_stride);
+            }
+            texture_.update(region_pixels_.data(), cols, rows, region.start_col, region.start_row);
+        }
+
+        void UploadTile(const RenderedTile &tile, std::uint32_t width, std::uint32_t height) {
+            const auto &region = tile.region;
+            if (IsEmptyRegion(region) || region.end_row > height || region.end_col > width ||
+                tile.rgba.size() < static_cast<std::size_t>(region.end_row - region.start_row) *
+                                       (region.end_col - region.start_col) * RGBA_CHANNELS) {
+                return;
+            }
+            texture_.update(tile.rgba.data(), region.end_col - region.start_col, region.end_row - region.start_row,
+                            region.start_col, region.start_row);
+        }
+
+        RgbaBuffer region_pixels_;
+    };
+
+    using sender_concept = stdexec::sender_t;
+
+    RenderResult render_result_;
+    sf::Texture &texture_;
+    sf::Sprite &sprite_;
+    sf::RenderWindow &window_;
+    RenderSettings render_settings_;
+    FrameStats *frame_stats_;
+    // Панель производительности; nullptr — не рисуется
+    PerfHud *hud_;
+    // Лог этапов кадра (FormatRenderStats, как в headless); nullptr — не пишется
+    std::FILE *stats_log_;
+
+    SFMLRender(RenderResult render_result, sf::Texture &texture, sf::Sprite &sprite, sf::RenderWindow &window,
+               RenderSettings render_settings, FrameStats *frame_stats = nullptr, PerfHud *hud = nullptr,
+               std::FILE *stats_log = nullptr)
+        : render_result_(std::move(render_result)), texture_{texture}, sprite_{sprite}, window_{window},
+          render_settings_{render_settings}, frame_stats_{frame_stats}, hud_{hud}, stats_log_{stats_log} {}
+
+    template <typename Receiver>
+    auto connect(Receiver &&receiver) const & {
+        return OperationState<std::decay_t<Receiver>>{std::forward<Receiver>(receiver), render_result_, texture_,
+                                                      sprite_, window_, render_settings_, frame_stats_, hud_,
+                                                      stats_log_};
+    }
+
+    // Кадр может весить десятки мегабайт, поэтому из временного сендера результат перемещаем
+    template <typename Receiver>
+    auto connect(Receiver &&receiver) && {
+        return OperationState<std::decay_t<Receiver>>{std::forward<Receiver>(receiver), std::move(render_result_),
+                                                      texture_, sprite_, window_, render_settings_, frame_stats_,
+                                                      hud_, stats_log_};
+    }
+
+    template <typename Env>
+    auto get_completion_signatures(Env &&) const {
+        return stdexec::completion_signatures<stdexec::set_value_t(), stdexec::set_error_t(std::exception_ptr),
+                                              stdexec::set_stopped_t()>{};
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "render_stats.hpp"
+
+// Счётчики для экранной панели производительности. Копят показанные кадры и посчитанную работу
+// и раз в период сворачивают их в снимок, так что строка текста пересобирается несколько раз в секунду,
+// а не на каждом кадре.
+class HudCounters {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Snapshot {
+        double fps{};
+        double frame_ms{};
+        double mpix_per_s{};
+        double giter_per_s{};
+        // Этапы последнего полностью посчитанного кадра
+        RenderStats last_render;
+        RenderStats::Duration last_present{};
+    };
+
+    explicit HudCounters(Clock::duration period = std::chrono::milliseconds{250}, Clock::time_point now = Clock::now())
+        : period_{period}, window_start_{now} {}
+
+    // Один проход конвейера, даже если новых данных для показа не было
+    void OnFrame() noexcept { ++frames_; }
+
+    void SetLastPresent(RenderStats::Duration present) noexcept { last_present_ = present; }
+
+    void AddWork(std::uint64_t pixels, std::uint64_t iterations) noexcept {
+        pixels_ += pixels;
+        iterations_ += iterations;
+    }
+
+    void SetLastRender(const RenderStats &stats) { last_render_ = stats; }
+
+    // Снимок за прошедший период или nullopt, если период ещё не истёк
+    [[nodiscard]] std::optional<Snapshot> Poll(Clock::time_point now) {
+        const auto elapsed = now - window_start_;
+        if (elapsed < period_) {
+            return std::nullopt;
+        }
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        Snapshot snapshot{.fps = frames_ / seconds,
+                          .frame_ms = frames_ > 0 ? seconds * 1e3 / frames_ : 0.0,
+                          .mpix_per_s = static_cast<double>(pixels_) / seconds / 1e6,
+                          .giter_per_s = static_cast<double>(iterations_) / seconds / 1e9,
+                          .last_render = last_render_,
+                          .last_present = last_present_};
+        window_start_ = now;
+        frames_ = 0;
+        pixels_ = 0;
+        iterations_ = 0;
+        return snapshot;
+    }
+
+private:
+    Clock::duration period_;
+    Clock::time_point window_start_;
+    std::uint64_t frames_{};
+    std::uint64_t pixels_{};
+    std::uint64_t iterations_{};
+    RenderStats last_render_;
+    RenderStats::Duration last_present_{};
+};
+
+// Текст панели: по строке на fps, этапы кадра, пропускную способность и параметры рендера
+[[nodiscard]] inline std::string FormatHud(const HudCounters::Snapshot &snapshot, std::string_view kernel,
+                                           std::uint32_t max_iterations, std::optional<double> cache_hit_rate) {
+    const auto ms = [](RenderStats::Duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    const auto &stages = snapshot.last_render;
+    const auto cache = cache_hit_rate ? std::format("{:.1f}%", *cache_hit_rate * 100.0) : std::string{"n/a"};
+    return std::format("{:.1f} fps  {:.2f} ms/frame\n"
+                       "compute {:.2f}  merge {:.2f}  aa {:.2f}  present {:.2f} ms\n"
+                       "{:.1f} Mpix/s  {:.3f} Giter/s\n"
+                       "kernel {}  iterations {}  cache {}",
+                       snapshot.fps, snapshot.frame_ms, ms(stages.compute), ms(stages.merge), ms(stages.antialias),
+                       ms(snapshot.last_present), snapshot.mpix_per_s, snapshot.giter_per_s, kernel, max_iterations,
+                       cache);
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef MANDELBROT_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include "types.hpp"
+
+// Запись кадров в PPM и PNG. PNG пишется потоково: строки добавляются порциями (полосами), каждая полоса
+// сжимается независимо и становится отдельным IDAT чанком. Со сборкой с zlib полосы сжимаются deflate,
+// без неё — пишутся несжатыми stored-блоками.
+
+namespace image {
+
+[[nodiscard]] inline std::uint32_t Crc32Update(std::uint32_t crc, std::span<const std::uint8_t> data) noexcept {
+    static const auto TABLE = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (const auto byte : data) {
+        crc = TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+class Adler32 {
+public:
+    void Update(std::span<const std::uint8_t> data) noexcept {
+        // 5552 — максимальная длина блока, при которой суммы не переполняют uint32 до взятия остатка
+        constexpr std::size_t NMAX = 5552;
+        while (!data.empty()) {
+            const auto n = std::min(data.size(), NMAX);
+            for (std::size_t i = 0; i < n; ++i) {
+                a_ += data[i];
+                b_ += a_;
+            }
+            a_ %= MOD;
+            b_ %= MOD;
+            data = data.subspan(n);
+        }
+    }
+
+    [[nodiscard]] std::uint32_t Value() const noexcept { return (b_ << 16) | a_; }
+
+    // Контрольная сумма склейки двух последовательностей по их суммам и длине второй (как adler32_combine в zlib)
+    [[nodiscard]] static constexpr std::uint32_t Combine(std::uint32_t first, std::uint32_t second,
+                                                         std::uint64_t second_length) noexcept {
+        const auto rem = static_cast<std::uint32_t>(second_length % MOD);
+        std::uint32_t sum1 = first & 0xFFFF;
+        std::uint32_t sum2 = static_cast<std::uint32_t>((static_cast<std::uint64_t>(rem) * sum1) % MOD);
+        sum1 += (second & 0xFFFF) + MOD - 1;
+        sum2 += ((first >> 16) & 0xFFFF) + ((second >> 16) & 0xFFFF) + MOD - rem;
+        if (sum1 >= MOD) {
+            sum1 -= MOD;
+        }
+        if (sum1 >= MOD) {
+            sum1 -= MOD;
+        }
+        if (sum2 >= (MOD << 1)) {
+            sum2 -= (MOD << 1);
+        }
+        if (sum2 >= MOD) {
+            sum2 -= MOD;
+        }
+        return sum1 | (sum2 << 16);
+    }
+
+private:
+    static constexpr std::uint32_t MOD = 65521;
+    std::uint32_t a_{1};
+    std::uint32_t b_{0};
+};
+
+inline void AppendBigEndian(std::vector<std::uint8_t> &out, std::uint32_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Несжатые (stored) блоки deflate. Поток из таких блоков можно склеивать по частям,
+// последний блок помечается флагом BFINAL.
+inline void AppendStoredBlocks(std::vector<std::uint8_t> &out, std::span<const std::uint8_t> data, bool final) {
+    constexpr std::size_t MAX_STORED = 65535;
+    do {
+        const auto n = std::min(data.size(), MAX_STORED);
+        const bool last = final && n == data.size();
+        out.push_back(last ? 1 : 0);
+        out.push_back(static_cast<std::uint8_t>(n));
+        out.push_back(static_cast<std::uint8_t>(n >> 8));
+        out.push_back(static_cast<std::uint8_t>(~n));
+        out.push_back(static_cast<std::uint8_t>(~n >> 8));
+        out.insert(out.end(), data.begin(), data.begin() + static_cast<std::ptrdiff_t>(n));
+        data = data.subspan(n);
+    } while (!data.empty());
+}
+
+// Превращает RGBA строки в "сырые" строки PNG: байт фильтра (0 — без фильтра) и RGB без альфы
+inline void AppendPngScanlines(std::vector<std::uint8_t> &out, const std::uint8_t *rgba, std::uint32_t width,
+                               std::uint32_t rows) {
+    out.reserve(out.size() + static_cast<std::size_t>(rows) * (1 + static_cast<std::size_t>(width) * 3));
+    for (std::uint32_t r = 0; r < rows; ++r) {
+        out.push_back(0);
+        for (std::uint32_t c = 0; c < width; ++c, rgba += RGBA_CHANNELS) {
+            out.insert(out.end(), rgba, rgba + 3);
+        }
+    }
+}
+
+// Независимо сжатый фрагмент потока deflate. Фрагменты склеиваются подряд: все, кроме последнего,
+// заканчиваются на границе байта без флага BFINAL, поэтому их можно готовить параллельно.
+struct DeflatedBand {
+    std::vector<std::uint8_t> data;
+    std::uint32_t adler{1};
+    std::uint64_t raw_size{};
+    std::uint32_t rows{};
+    bool final{};
+};
+
+inline constexpr int DEFAULT_COMPRESSION_LEVEL = 6;
+
+[[nodiscard]] constexpr bool HasDeflateCompression() noexcept {
+#ifdef MANDELBROT_HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+[[nodiscard]] inline std::vector<std::uint8_t> DeflateSegment(std::span<const std::uint8_t> raw, bool final,
+                                                             [[maybe_unused]] int level) {
+    std::vector<std::uint8_t> out;
+#ifdef MANDELBROT_HAS_ZLIB
+    if (level > 0) {
+        z_stream zs{};
+        // Отрицательное окно — "сырой" deflate без заголовка zlib, заголовок пишет PngWriter
+        if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        out.resize(deflateBound(&zs, raw.size()) + 16);
+        zs.next_in = const_cast<Bytef *>(raw.data());
+        zs.avail_in = static_cast<uInt>(raw.size());
+        zs.next_out = out.data();
+        zs.avail_out = static_cast<uInt>(out.size());
+        // Z_FULL_FLUSH выравнивает конец фрагмента по байту и не ставит BFINAL
+        const auto rc = deflate(&zs, final ? Z_FINISH : Z_FULL_FLUSH);
+        const auto produced = out.size() - zs.avail_out;
+        deflateEnd(&zs);
+        if (rc != (final ? Z_STREAM_END : Z_OK) || zs.avail_in != 0) {
+            throw std::runtime_error("deflate failed");
+        }
+        out.resize(produced);
+        return out;
+    }
+#endif
+    AppendStoredBlocks(out, raw, final);
+    return out;
+}
+
+// Готовит полосу PNG из rows строк RGBA: фильтрация, контрольная сумма и сжатие
+[[nodiscard]] inline DeflatedBand MakeDeflatedBand(const std::uint8_t *rgba, std::uint32_t width, std::uint32_t rows,
+                                                   bool final, int level = DEFAULT_COMPRESSION_LEVEL) {
+    std::vector<std::uint8_t> scanlines;
+    AppendPngScanlines(scanlines, rgba, width, rows);
+
+    DeflatedBand band;
+    Adler32 adler;
+    adler.Update(scanlines);
+    band.adler = adler.Value();
+    band.raw_size = scanlines.size();
+    band.rows = rows;
+    band.final = final;
+    band.data = DeflateSegment(scanlines, final, level);
+    return band;
+}
+
+class PngWriter {
+public:
+    PngWriter(const std::filesystem::path &path, std::uint32_t width, std::uint32_t height)
+        : file_{path, std::ios::binary}, out_{file_}, width_{width}, height_{height} {
+        if (!file_) {
+            throw std::runtime_error("Cannot open " + path.string() + " for writing");
+        }
+        WriteHeader();
+    }
+
+    // Запись в произвольный поток, например в память для ответа по сети
+    PngWriter(std::ostream &out, std::uint32_t width, std::uint32_t height)
+        : out_{out}, width_{width}, height_{height} {
+        WriteHeader();
+    }
+
+    PngWriter(const PngWriter &) = delete;
+    PngWriter &operator=(const PngWriter &) = delete;
+
+    // Добавляет rows строк RGBA, строки идут подряд сверху вниз
+    void WriteRows(const std::uint8_t *rgba, std::uint32_t rows, int level = DEFAULT_COMPRESSION_LEVEL) {
+        WriteBand(MakeDeflatedBand(rgba, width_, rows, rows_written_ + rows == height_, level));
+    }
+
+    // Дописывает заранее подготовленную полосу; полосы должны идти строго по порядку
+    void WriteBand(const DeflatedBand &band) {
+        if (finished_stream_ || rows_written_ + band.rows > height_) {
+            throw std::logic_error("PngWriter: more rows than declared in the header");
+        }
+        WriteChunk("IDAT", band.data);
+        adler_ = Adler32::Combine(adler_, band.adler, band.raw_size);
+        rows_written_ += band.rows;
+        finished_stream_ = band.final;
+        bytes_written_ += band.data.size();
+    }
+
+    void Finish() {
+        if (rows_written_ != height_) {
+            throw std::logic_error("PngWriter: image is incomplete");
+        }
+        std::vector<std::uint8_t> tail;
+        if (!finished_stream_) {
+            AppendStoredBlocks(tail, {}, true);
+        }
+        AppendBigEndian(tail, adler_);
+        WriteChunk("IDAT", tail);
+        WriteChunk("IEND", {});
+        out_.flush();
+        if (!out_) {
+            throw std::runtime_error("Failed to write PNG data");
+        }
+    }
+
+    [[nodiscard]] std::uint64_t CompressedBytes() const noexcept { return bytes_written_; }
+
+private:
+    void WriteHeader() {
+        static constexpr std::array<std::uint8_t, 8> SIGNATURE{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        out_.write(reinterpret_cast<const char *>(SIGNATURE.data()), SIGNATURE.size());
+
+        std::vector<std::uint8_t> ihdr;
+        AppendBigEndian(ihdr, width_);
+        AppendBigEndian(ihdr, height_);
+        ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});  // 8 бит на канал, RGB, deflate, без фильтров, без чересстрочности
+        WriteChunk("IHDR", ihdr);
+
+        // Заголовок zlib: deflate с окном 32К, без словаря
+        WriteChunk("IDAT", std::vector<std::uint8_t>{0x78, 0x9C});
+    }
+
+    void WriteChunk(const char (&type)[5], std::span<const std::uint8_t> data) {
+        std::vector<std::uint8_t> header;
+        AppendBigEndian(header, static_cast<std::uint32_t>(data.size()));
+        header.insert(header.end(), type, type + 4);
+
+        auto crc = Crc32Update(0, std::span{header}.subspan(4));
+        crc = Crc32Update(crc, data);
+        std::vector<std::uint8_t> trailer;
+        AppendBigEndian(trailer, crc);
+
+        out_.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+        out_.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        out_.write(reinterpret_cast<const char *>(trailer.data()), static_cast<std::streamsize>(trailer.size()));
+    }
+
+    std::ofstream file_;
+    std::ostream &out_;
+    std::uint32_t width_;
+    std::uint32_t height_;
+    std::uint32_t rows_written_{0};
+    std::uint32_t adler_{1};
+    bool finished_stream_{false};
+    std::uint64_t bytes_written_{0};
+};
+
+inline void WritePpm(const std::filesystem::path &path, std::uint32_t width, std::uint32_t height,
+                     const RgbaBuffer &rgba) {
+    std::ofstream out{path, std::ios::binary};
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path.string() + " for writing");
+    }
+    const auto header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    std::vector<std::uint8_t> row(static_cast<std::size_t>(width) * 3);
+    const auto *src = rgba.data();
+    for (std::uint32_t r = 0; r < height; ++r) {
+        for (std::uint32_t c = 0; c < width; ++c, src += RGBA_CHANNELS) {
+            std::copy_n(src, 3, row.data() + static_cast<std::size_t>(c) * 3);
+        }
+        out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+inline void WritePng(const std::filesystem::path &path, std::uint32_t width, std::uint32_t height,
+                     const RgbaBuffer &rgba) {
+    PngWriter writer{path, width, height};
+    // Порциями по 64 строки, чтобы не держать вторую копию кадра целиком
+    constexpr std::uint32_t ROWS_PER_CHUNK = 64;
+    for (std::uint32_t row = 0; row < height; row += ROWS_PER_CHUNK) {
+        const auto rows = std::min(ROWS_PER_CHUNK, height - row);
+        writer.WriteRows(rgba.data() + static_cast<std::size_t>(row) * width * RGBA_CHANNELS, rows);
+    }
+    writer.Finish();
+}
+
+// Несжатый видеопоток YUV4MPEG2 (4:4:4, BT.601, ограниченный диапазон): его напрямую принимают ffmpeg и x264,
+// поэтому последовательность кадров можно отдать в кодировщик через stdout без промежуточных файлов
+class Y4mWriter {
+public:
+    Y4mWriter(std::ostream &out, std::uint32_t width, std::uint32_t height, std::uint32_t fps)
+        : out_{out}, width_{width}, height_{height}, planes_(static_cast<std::size_t>(width) * height * 3) {
+        const auto header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) + " F" +
+                            std::to_string(fps) + ":1 Ip A1:1 C444\n";
+        out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    }
+
+    void WriteFrame(const RgbaBuffer &rgba) {
+        const auto pixels = static_cast<std::size_t>(width_) * height_;
+        if (rgba.size() < pixels * RGBA_CHANNELS) {
+            throw std::invalid_argument("Pixel buffer is smaller than the frame");
+        }
+        auto *y = planes_.data();
+        auto *u = y + pixels;
+        auto *v = u + pixels;
+        const auto *src = rgba.data();
+        for (std::size_t i = 0; i < pixels; ++i, src += RGBA_CHANNELS) {
+            const int r = src[0];
+            const int g = src[1];
+            const int b = src[2];
+            y[i] = static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            u[i] = static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[i] = static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+        static constexpr char FRAME_HEADER[] = "FRAME\n";
+        out_.write(FRAME_HEADER, sizeof(FRAME_HEADER) - 1);
+        out_.write(reinterpret_cast<const char *>(planes_.data()), static_cast<std::streamsize>(planes_.size()));
+        if (!out_) {
+            throw std::runtime_error("Failed to write Y4M frame");
+        }
+    }
+
+private:
+    std::ostream &out_;
+    std::uint32_t width_;
+    std::uint32_t height_;
+    std::vector<std::uint8_t> planes_;
+};
+
+// PNG целиком в памяти
+[[nodiscard]] inline std::string EncodePng(std::uint32_t width, std::uint32_t height, const RgbaBuffer &rgba,
+                                           int level = DEFAULT_COMPRESSION_LEVEL) {
+    std::ostringstream out;
+    PngWriter writer{out, width, height};
+    writer.WriteRows(rgba.data(), height, level);
+    writer.Finish();
+    return std::move(out).str();
+}
+
+// Формат выбирается по расширению: .png или .ppm
+inline void WriteImage(const std::filesystem::path &path, std::uint32_t width, std::uint32_t height,
+                       const RgbaBuffer &rgba) {
+    if (rgba.size() < static_cast<std::size_t>(width) * height * RGBA_CHANNELS) {
+        throw std::invalid_argument("Pixel buffer is smaller than the image");
+    }
+    const auto ext = path.extension().string();
+    if (ext == ".png" || ext == ".PNG") {
+        WritePng(path, width, height, rgba);
+    } else if (ext == ".ppm" || ext == ".PPM") {
+        WritePpm(path, width, height, rgba);
+    } else {
+        throw std::invalid_argument("Unsupported image format: " + path.string() + " (expected .png or .ppm)");
+    }
+}
+
+}  // namespace image
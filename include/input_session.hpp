@@ -0,0 +1,338 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+#include "frame_pacer.hpp"
+#include "mandelbrot.hpp"
+#include "types.hpp"
+
+// Запись и воспроизведение интерактивных сессий. Ввод хранится в виде смысловых событий, привязанных
+// к номеру кадра, а не ко времени: при воспроизведении приближение идёт по тем же точкам и в тех же
+// кадрах независимо от скорости машины, поэтому сборки можно сравнивать на одинаковой нагрузке.
+
+namespace session {
+
+enum class InputType : std::uint8_t {
+    CLOSE = 0,
+    LEFT_PRESS = 1,
+    LEFT_RELEASE = 2,
+    RIGHT_PRESS = 3,
+    RIGHT_RELEASE = 4,
+    TOGGLE_HUD = 5,
+};
+
+inline constexpr std::uint8_t INPUT_TYPE_COUNT = 6;
+inline constexpr double ZOOM_FACTOR = 0.8;
+
+inline void ApplyInput(AppState &state, InputType input) noexcept {
+    switch (input) {
+    case InputType::CLOSE:
+        state.should_exit = true;
+        break;
+    case InputType::LEFT_PRESS:
+        state.left_mouse_pressed = true;
+        state.need_rerender = true;
+        break;
+    case InputType::LEFT_RELEASE:
+        state.left_mouse_pressed = false;
+        break;
+    case InputType::RIGHT_PRESS:
+        state.right_mouse_pressed = true;
+        state.need_rerender = true;
+        break;
+    case InputType::RIGHT_RELEASE:
+        state.right_mouse_pressed = false;
+        break;
+    case InputType::TOGGLE_HUD:
+        state.show_hud = !state.show_hud;
+        break;
+    }
+}
+
+// Приближает (или отдаляет) область так, чтобы точка под пикселем оказалась в центре
+inline void ZoomToPoint(AppState &state, const RenderSettings &settings, int pixel_x, int pixel_y, bool zoom_in,
+                        double factor = ZOOM_FACTOR) noexcept {
+    auto &viewport = state.viewport;
+    const double target_x = viewport.x_min + (static_cast<double>(pixel_x) / settings.width) * viewport.width();
+    const double target_y = viewport.y_min + (static_cast<double>(pixel_y) / settings.height) * viewport.height();
+
+    const double zoom_factor = zoom_in ? factor : (1.0 / factor);
+    const double new_width = viewport.width() * zoom_factor;
+    const double new_height = viewport.height() * zoom_factor;
+
+    viewport.x_min = target_x - new_width / 2.0;
+    viewport.x_max = target_x + new_width / 2.0;
+    viewport.y_min = target_y - new_height / 2.0;
+    viewport.y_max = target_y + new_height / 2.0;
+}
+
+struct ZoomInput {
+    int x{};
+    int y{};
+};
+
+// Ввод одного кадра и область после его обработки — по ней воспроизведение проверяет расхождение
+struct FrameInput {
+    std::uint64_t frame{};
+    std::chrono::microseconds time{};
+    std::vector<InputType> events;
+    std::optional<ZoomInput> zoom;
+    mandelbrot::ViewPort viewport;
+
+    [[nodiscard]] bool Empty() const noexcept { return events.empty() && !zoom; }
+};
+
+struct Session {
+    RenderSettings settings;
+    mandelbrot::ViewPort start_viewport;
+    // Только кадры, в которых был ввод; остальные кадры сессии пустые
+    std::vector<FrameInput> frames;
+    std::uint64_t frame_count{};
+};
+
+inline constexpr std::string_view SESSION_MAGIC = "mandelbrot-session";
+inline constexpr int SESSION_VERSION = 2;
+
+// Текстовый формат: заголовок с настройками, строка на каждый кадр с вводом и итоговое число кадров.
+// Числа с плавающей точкой пишутся кратчайшим точным представлением и читаются без потерь.
+class SessionRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SessionRecorder(std::ostream &out, const RenderSettings &settings, const mandelbrot::ViewPort &start)
+        : out_{out}, start_{Clock::now()} {
+        out_ << std::format("{} {}\nsettings {} {} {} {} {} {} {}\nviewport {} {} {} {}\n", SESSION_MAGIC,
+                            SESSION_VERSION, settings.width, settings.height, settings.max_iterations,
+                            settings.escape_radius, static_cast<unsigned>(settings.kernel), settings.aa_samples,
+                            settings.aa_threshold, start.x_min, start.x_max, start.y_min, start.y_max);
+    }
+
+    SessionRecorder(const SessionRecorder &) = delete;
+    SessionRecorder &operator=(const SessionRecorder &) = delete;
+
+    ~SessionRecorder() { Finish(); }
+
+    // Вызывается на каждом кадре; кадры без ввода только увеличивают счётчик
+    void Record(FrameInput input) {
+        input.frame = frame_count_++;
+        if (input.Empty()) {
+            return;
+        }
+        input.time = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_);
+        const auto &vp = input.viewport;
+        out_ << std::format("F {} {} {} {} {} {} {} {} {} {}", input.frame, input.time.count(), vp.x_min, vp.x_max,
+                            vp.y_min, vp.y_max, input.zoom ? 1 : 0, input.zoom ? input.zoom->x : 0,
+                            input.zoom ? input.zoom->y : 0, input.events.size());
+        for (const auto event : input.events) {
+            out_ << ' ' << static_cast<int>(event);
+        }
+        out_ << '\n';
+    }
+
+    void Finish() {
+        if (!finished_) {
+            finished_ = true;
+            out_ << "end " << frame_count_ << '\n';
+            out_.flush();
+        }
+    }
+
+    [[nodiscard]] std::uint64_t FrameCount() const noexcept { return frame_count_; }
+
+private:
+    std::ostream &out_;
+    Clock::time_point start_;
+    std::uint64_t frame_count_{0};
+    bool finished_{false};
+};
+
+namespace detail {
+
+template <typename T>
+T ParseToken(std::istringstream &line, std::string_view what) {
+    std::string token;
+    if (!(line >> token)) {
+        throw std::runtime_error("Session file: missing " + std::string{what});
+    }
+    T value{};
+    const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (ec != std::errc{} || ptr != token.data() + token.size()) {
+        throw std::runtime_error("Session file: invalid " + std::string{what} + " '" + token + "'");
+    }
+    return value;
+}
+
+inline mandelbrot::ViewPort ParseViewport(std::istringstream &line) {
+    mandelbrot::ViewPort vp;
+    vp.x_min = ParseToken<double>(line, "viewport");
+    vp.x_max = ParseToken<double>(line, "viewport");
+    vp.y_min = ParseToken<double>(line, "viewport");
+    vp.y_max = ParseToken<double>(line, "viewport");
+    return vp;
+}
+
+}  // namespace detail
+
+[[nodiscard]] inline Session ReadSession(std::istream &in) {
+    Session session;
+    std::string text;
+    bool has_header = false;
+    bool has_end = false;
+    while (std::getline(in, text)) {
+        if (text.empty()) {
+            continue;
+        }
+        std::istringstream line{text};
+        std::string tag;
+        line >> tag;
+        if (tag == SESSION_MAGIC) {
+            if (detail::ParseToken<int>(line, "version") != SESSION_VERSION) {
+                throw std::runtime_error("Session file: unsupported version");
+            }
+            has_header = true;
+        } else if (tag == "settings") {
+            session.settings.width = detail::ParseToken<std::uint32_t>(line, "width");
+            session.settings.height = detail::ParseToken<std::uint32_t>(line, "height");
+            session.settings.max_iterations = detail::ParseToken<std::uint32_t>(line, "max_iterations");
+            session.settings.escape_radius = detail::ParseToken<double>(line, "escape_radius");
+            const auto kernel = detail::ParseToken<unsigned>(line, "kernel");
+            if (kernel >= mandelbrot::KERNEL_NAMES.size()) {
+                throw std::runtime_error("Session file: unknown kernel " + std::to_string(kernel));
+            }
+            session.settings.kernel = static_cast<mandelbrot::Kernel>(kernel);
+            session.settings.aa_samples = detail::ParseToken<std::uint32_t>(line, "aa_samples");
+            session.settings.aa_threshold = detail::ParseToken<std::uint32_t>(line, "aa_threshold");
+        } else if (tag == "viewport") {
+            session.start_viewport = detail::ParseViewport(line);
+        } else if (tag == "F") {
+            FrameInput input;
+            input.frame = detail::ParseToken<std::uint64_t>(line, "frame");
+            input.time = std::chrono::microseconds{detail::ParseToken<std::int64_t>(line, "time")};
+            input.viewport = detail::ParseViewport(line);
+            const auto zoom = detail::ParseToken<int>(line, "zoom flag");
+            const auto x = detail::ParseToken<int>(line, "zoom x");
+            const auto y = detail::ParseToken<int>(line, "zoom y");
+            if (zoom != 0) {
+                input.zoom = ZoomInput{x, y};
+            }
+            const auto count = detail::ParseToken<std::uint32_t>(line, "event count");
+            for (std::uint32_t i = 0; i < count; ++i) {
+                const auto type = detail::ParseToken<unsigned>(line, "event");
+                if (type >= INPUT_TYPE_COUNT) {
+                    throw std::runtime_error("Session file: unknown event " + std::to_string(type));
+                }
+                input.events.push_back(static_cast<InputType>(type));
+            }
+            if (!session.frames.empty() && input.frame <= session.frames.back().frame) {
+                throw std::runtime_error("Session file: frames out of order");
+            }
+            session.frames.push_back(std::move(input));
+        } else if (tag == "end") {
+            session.frame_count = detail::ParseToken<std::uint64_t>(line, "frame count");
+            has_end = true;
+        } else {
+            throw std::runtime_error("Session file: unknown record '" + tag + "'");
+        }
+    }
+    if (!has_header) {
+        throw std::runtime_error("Session file: missing header");
+    }
+    // Запись, оборванная без end, воспроизводится до последнего кадра с вводом
+    if (!has_end) {
+        session.frame_count = session.frames.empty() ? 0 : session.frames.back().frame + 1;
+    }
+    return session;
+}
+
+// Выдаёт ввод сессии кадр за кадром и считает кадры, в которых область разошлась с записанной
+class SessionPlayer {
+public:
+    explicit SessionPlayer(Session session) : session_{std::move(session)} {}
+
+    [[nodiscard]] const Session &GetSession() const noexcept { return session_; }
+
+    // Применяет ввод очередного кадра к состоянию
+    void ApplyNextFrame(AppState &state) {
+        const auto frame = frame_++;
+        if (next_ >= session_.frames.size() || session_.frames[next_].frame != frame) {
+            return;
+        }
+        const auto &input = session_.frames[next_++];
+        for (const auto event : input.events) {
+            ApplyInput(state, event);
+        }
+        if (input.zoom) {
+            ZoomToPoint(state, session_.settings, input.zoom->x, input.zoom->y, state.left_mouse_pressed);
+        }
+        const auto &vp = input.viewport;
+        if (state.viewport.x_min != vp.x_min || state.viewport.x_max != vp.x_max ||
+            state.viewport.y_min != vp.y_min || state.viewport.y_max != vp.y_max) {
+            ++divergences_;
+        }
+    }
+
+    [[nodiscard]] bool Finished() const noexcept { return frame_ >= session_.frame_count; }
+    [[nodiscard]] std::uint64_t Frame() const noexcept { return frame_; }
+    [[nodiscard]] std::uint64_t Divergences() const noexcept { return divergences_; }
+
+private:
+    Session session_;
+    std::uint64_t frame_{0};
+    std::size_t next_{0};
+    std::uint64_t divergences_{0};
+};
+
+struct ReplaySummary {
+    std::uint64_t frames{};
+    std::uint64_t renders{};
+    std::uint64_t divergences{};
+    std::chrono::nanoseconds total_time{};
+};
+
+// Воспроизведение без окна: каждый кадр применяет ввод и забирает полосы тем же потоковым
+// StreamMandelbrotAsyncSender, что и конвейер приложения. Кадры идут без паузы между ними, поэтому
+// перезапущенный рендер дожидается конца в том же кадре — иначе следующий перезапуск отбросил бы его.
+// Длительность каждого кадра попадает в stats.frame_time.
+template <typename Renderer>
+ReplaySummary ReplayHeadless(Renderer &renderer, const Session &session, FrameStats &stats) {
+    using Clock = std::chrono::steady_clock;
+    SessionPlayer player{session};
+    AppState state;
+    state.viewport = session.start_viewport;
+    BasicTileStream stream{renderer};
+
+    ReplaySummary summary;
+    const auto start = Clock::now();
+    while (!player.Finished() && !state.should_exit) {
+        const auto frame_start = Clock::now();
+        player.ApplyNextFrame(state);
+        if (state.need_rerender) {
+            ++summary.renders;
+        }
+        (void)stdexec::sync_wait(StreamMandelbrotAsyncSender{state, session.settings, stream});
+        if (!stream.Idle()) {
+            stream.WaitIdle();
+            (void)stdexec::sync_wait(StreamMandelbrotAsyncSender{state, session.settings, stream});
+        }
+        stats.frame_time.Record(Clock::now() - frame_start);
+        ++summary.frames;
+    }
+    summary.total_time = Clock::now() - start;
+    summary.divergences = player.Divergences();
+    return summary;
+}
+
+}  // namespace session
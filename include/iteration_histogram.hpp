@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+
+// Распределение числа итераций по пикселям кадра в логарифмических корзинах: корзина k (k >= 1) содержит
+// значения [2^(k-1), 2^k), корзина 0 — пиксели, ушедшие сразу. Точки, дошедшие до предела итераций
+// (внутри множества), считаются отдельно. Заполнение стоит одного bit_width и инкремента на пиксель,
+// поэтому каждый исполнитель ведёт свою частичную гистограмму прямо при вычислении, а кадр их складывает.
+class IterationHistogram {
+public:
+    static constexpr std::size_t BIN_COUNT = 33;
+
+    IterationHistogram() = default;
+    explicit IterationHistogram(std::uint32_t max_iterations) noexcept : max_iterations_{max_iterations} {}
+
+    void Add(std::uint32_t iterations) noexcept {
+        if (iterations >= max_iterations_) {
+            ++inside_;
+        } else {
+            ++bins_[std::bit_width(iterations)];
+        }
+    }
+
+    void AddRow(std::span<const std::uint32_t> row) noexcept {
+        for (const auto iterations : row) {
+            Add(iterations);
+        }
+    }
+
+    IterationHistogram &operator+=(const IterationHistogram &other) noexcept {
+        if (max_iterations_ == 0) {
+            max_iterations_ = other.max_iterations_;
+        }
+        for (std::size_t i = 0; i < BIN_COUNT; ++i) {
+            bins_[i] += other.bins_[i];
+        }
+        inside_ += other.inside_;
+        return *this;
+    }
+
+    [[nodiscard]] std::uint32_t MaxIterations() const noexcept { return max_iterations_; }
+    [[nodiscard]] std::uint64_t Count(std::size_t bin) const noexcept { return bins_[bin]; }
+    [[nodiscard]] std::uint64_t Inside() const noexcept { return inside_; }
+
+    [[nodiscard]] std::uint64_t Total() const noexcept {
+        std::uint64_t total = inside_;
+        for (const auto count : bins_) {
+            total += count;
+        }
+        return total;
+    }
+
+    // Границы корзины [lower, upper)
+    [[nodiscard]] static constexpr std::uint64_t BinLower(std::size_t bin) noexcept {
+        return bin == 0 ? 0 : std::uint64_t{1} << (bin - 1);
+    }
+    [[nodiscard]] static constexpr std::uint64_t BinUpper(std::size_t bin) noexcept {
+        return std::uint64_t{1} << bin;
+    }
+
+    // Доля пикселей внутри множества — они всегда стоят полный предел итераций
+    [[nodiscard]] double InsideFraction() const noexcept {
+        const auto total = Total();
+        return total == 0 ? 0.0 : static_cast<double>(inside_) / static_cast<double>(total);
+    }
+
+    // Оценка q-квантиля: корзина, в которую он попадает, и линейная интерполяция внутри неё
+    [[nodiscard]] double Quantile(double q) const noexcept {
+        const auto total = Total();
+        if (total == 0) {
+            return 0.0;
+        }
+        const auto target = q * static_cast<double>(total);
+        double seen = 0.0;
+        for (std::size_t i = 0; i < BIN_COUNT; ++i) {
+            if (bins_[i] == 0) {
+                continue;
+            }
+            const auto count = static_cast<double>(bins_[i]);
+            if (seen + count >= target) {
+                const auto lower = static_cast<double>(BinLower(i));
+                const auto upper = static_cast<double>(BinUpper(i));
+                return lower + (upper - lower) * (target - seen) / count;
+            }
+            seen += count;
+        }
+        return max_iterations_;
+    }
+
+    // Столбцы lower,upper,count; последняя строка — пиксели внутри множества с границами [max, max]
+    void WriteCsv(std::ostream &out) const {
+        out << "lower,upper,count\n";
+        for (std::size_t i = 0; i < BIN_COUNT; ++i) {
+            if (bins_[i] != 0) {
+                out << BinLower(i) << ',' << BinUpper(i) << ',' << bins_[i] << '\n';
+            }
+        }
+        out << max_iterations_ << ',' << max_iterations_ << ',' << inside_ << '\n';
+    }
+
+    void WriteJson(std::ostream &out) const {
+        out << R"({"max_iterations":)" << max_iterations_ << R"(,"total":)" << Total() << R"(,"inside":)" << inside_
+            << R"(,"bins":[)";
+        bool first = true;
+        for (std::size_t i = 0; i < BIN_COUNT; ++i) {
+            if (bins_[i] == 0) {
+                continue;
+            }
+            out << (first ? "" : ",") << R"({"lower":)" << BinLower(i) << R"(,"upper":)" << BinUpper(i)
+                << R"(,"count":)" << bins_[i] << "}";
+            first = false;
+        }
+        out << "]}\n";
+    }
+
+    // Формат выбирается по расширению: .csv или JSON для всего остального
+    void Write(const std::filesystem::path &path) const {
+        std::ofstream file{path, std::ios::binary};
+        if (!file) {
+            throw std::runtime_error("Failed to open histogram file: " + path.string());
+        }
+        if (path.extension() == ".csv") {
+            WriteCsv(file);
+        } else {
+            WriteJson(file);
+        }
+    }
+
+private:
+    std::uint32_t max_iterations_{0};
+    std::array<std::uint64_t, BIN_COUNT> bins_{};
+    std::uint64_t inside_{0};
+};
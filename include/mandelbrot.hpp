@@ -1,15 +1,18 @@
 #pragma once
 
 #include "mandelbrot_renderer.hpp"
+#include "tile_stream.hpp"
+#include "trace.hpp"
 #include <stdexec/execution.hpp>
 #include <tuple>
 
+// Полный пересчёт кадра на любом BasicMandelbrotRenderer; полос столько же, сколько исполнителей планировщика
+template <typename Renderer>
 class CalculateMandelbrotAsyncSender {
 public:
     using sender_concept = stdexec::sender_t;
 
-    explicit CalculateMandelbrotAsyncSender(AppState &state, RenderSettings render_settings,
-                                            MandelbrotRenderer &renderer)
+    explicit CalculateMandelbrotAsyncSender(AppState &state, RenderSettings render_settings, Renderer &renderer)
         : state_(state), render_settings_{render_settings}, renderer_{renderer} {}
 
     template <typename Env>
@@ -23,29 +26,33 @@ public:
     struct OpState {
         Receiver receiver_;
         RenderSettings render_settings_;
-        MandelbrotRenderer &renderer_;
+        Renderer &renderer_;
         AppState &state_;
 
-        OpState(Receiver &&r, RenderSettings rs, MandelbrotRenderer &renderer, AppState &state)
+        OpState(Receiver &&r, RenderSettings rs, Renderer &renderer, AppState &state)
             : receiver_(std::forward<Receiver>(r)), render_settings_(rs), renderer_(renderer), state_(state) {}
 
         void start() noexcept {
+            trace::Span span{"CalculateMandelbrotAsyncSender", "pipeline"};
             try {
                 // Если перерисовки не требуется — возвращаем пустой RenderResult
                 if (!state_.need_rerender) {
                     RenderResult empty;
                     empty.settings = render_settings_;
                     empty.viewport = state_.viewport;
+                    span.End();
                     stdexec::set_value(std::move(receiver_), std::move(empty));
                     return;
                 }
 
-                auto sender_render = renderer_.RenderAsync<THREAD_POOL_SIZE>(state_.viewport, render_settings_);
-                auto tup = stdexec::sync_wait(std::move(sender_render)).value();
-                auto rr = std::get<0>(tup);
+                auto rr = DispatchLanes(renderer_.Concurrency(), [&]<std::size_t N>() {
+                    auto sender_render = renderer_.template RenderAsync<N>(state_.viewport, render_settings_);
+                    return std::get<0>(stdexec::sync_wait(std::move(sender_render)).value());
+                });
 
                 state_.need_rerender = false;
 
+                span.End();
                 stdexec::set_value(std::move(receiver_), std::move(rr));
             } catch (...) {
                 stdexec::set_error(std::move(receiver_), std::current_exception());
@@ -60,6 +67,70 @@ public:
 
 private:
     RenderSettings render_settings_;
-    MandelbrotRenderer &renderer_;
+    Renderer &renderer_;
+    AppState &state_;
+};
+
+// Неблокирующий вариант CalculateMandelbrotAsyncSender: при необходимости перезапускает потоковый рендер
+// и сразу возвращает полосы, успевшие посчитаться с прошлого кадра.
+template <typename Stream>
+class StreamMandelbrotAsyncSender {
+public:
+    using sender_concept = stdexec::sender_t;
+
+    explicit StreamMandelbrotAsyncSender(AppState &state, RenderSettings render_settings, Stream &stream)
+        : state_(state), render_settings_{render_settings}, stream_{stream} {}
+
+    template <typename Env>
+    auto get_completion_signatures(Env &&) const {
+        return stdexec::completion_signatures<stdexec::set_value_t(RenderResult),
+                                              stdexec::set_error_t(std::exception_ptr),
+                                              stdexec::set_stopped_t()>{};
+    }
+
+    template <typename Receiver>
+    struct OpState {
+        Receiver receiver_;
+        RenderSettings render_settings_;
+        Stream &stream_;
+        AppState &state_;
+
+        OpState(Receiver &&r, RenderSettings rs, Stream &stream, AppState &state)
+            : receiver_(std::forward<Receiver>(r)), render_settings_(rs), stream_(stream), state_(state) {}
+
+        void start() noexcept {
+            trace::Span span{"StreamMandelbrotAsyncSender", "pipeline"};
+            try {
+                if (state_.need_rerender) {
+                    stream_.Restart(state_.viewport, render_settings_);
+                    state_.need_rerender = false;
+                }
+
+                RenderResult result;
+                result.settings = render_settings_;
+                result.viewport = state_.viewport;
+                result.tiles = stream_.Drain();
+                // Кадр дособран: статистика этапов уходит вместе с последними полосами
+                if (auto stats = stream_.TakeFrameStats()) {
+                    result.stats = std::move(*stats);
+                    result.render_time = std::chrono::duration_cast<std::chrono::milliseconds>(result.stats.compute);
+                }
+
+                span.End();
+                stdexec::set_value(std::move(receiver_), std::move(result));
+            } catch (...) {
+                stdexec::set_error(std::move(receiver_), std::current_exception());
+            }
+        }
+    };
+
+    template <typename Receiver>
+    auto connect(Receiver &&receiver) const {
+        return OpState{std::forward<Receiver>(receiver), render_settings_, stream_, state_};
+    }
+
+private:
+    RenderSettings render_settings_;
+    Stream &stream_;
     AppState &state_;
 };
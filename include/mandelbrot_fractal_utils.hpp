@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <complex>
 #include <cstdint>
+#include <limits>
+#include <string_view>
 
 namespace mandelbrot {
 
@@ -29,19 +34,104 @@ struct RgbColors {
     inline static constexpr RgbColor BLACK = RgbColor{0, 0, 0};
 };
 
-[[nodiscard]] constexpr std::uint32_t CalculateIterationsForPoint(const Complex &c, std::uint32_t max_iterations,
-                                                                  double escape_radius) noexcept {
+// Вариант ядра итераций. Все варианты дают те же итерации, что и скалярное ядро, бит в бит.
+enum class Kernel : std::uint8_t {
+    // По одной точке за раз
+    SCALAR = 0,
+    // Группы по SIMD_LANES соседних точек; группа считается, пока не убежит самая медленная точка
+    SIMD = 1,
+    // SIMD_LANES дорожек, каждая берёт следующую точку строки, как только её точка убежала
+    SIMD_STREAMING = 2,
+};
+
+inline constexpr std::array<std::string_view, 3> KERNEL_NAMES{"double scalar", "double simd", "double simd streaming"};
+
+[[nodiscard]] constexpr std::string_view KernelName(Kernel kernel) noexcept {
+    return KERNEL_NAMES[static_cast<std::size_t>(kernel)];
+}
+
+// Точность и вариант ядра по умолчанию — для логов и экранной панели
+inline constexpr std::string_view KERNEL_NAME = KernelName(Kernel::SCALAR);
+
+// Битовая маска выходных каналов ядра
+using ChannelMask = std::uint32_t;
+
+struct Channels {
+    Channels() = delete;
+
+    // Число итераций до выхода за радиус (max_iterations — точка внутри множества)
+    inline static constexpr ChannelMask ITERATIONS = 1u << 0;
+    // Непрерывное число итераций: i + 1 - log2(ln|z|), без ступенек между полосами
+    inline static constexpr ChannelMask SMOOTH = 1u << 1;
+    // Оценка расстояния до множества |z| ln|z| / (2 |dz/dc|); 0 для точек внутри
+    inline static constexpr ChannelMask DISTANCE = 1u << 2;
+    // z на момент выхода из цикла
+    inline static constexpr ChannelMask FINAL_Z = 1u << 3;
+    // Наименьшее расстояние от орбиты z_1, z_2, ... до ловушки в начале координат
+    inline static constexpr ChannelMask ORBIT_TRAP = 1u << 4;
+
+    inline static constexpr ChannelMask ALL = ITERATIONS | SMOOTH | DISTANCE | FINAL_Z | ORBIT_TRAP;
+};
+
+// Значения каналов одной точки; поля невыбранных каналов остаются нулевыми
+struct PointChannels {
+    std::uint32_t iterations{};
+    double smooth{};
+    double distance{};
+    Complex final_z{};
+    double orbit_trap{};
+};
+
+// Ядро итераций, которое ведёт во внутреннем цикле только выбранные в CHANNELS величины.
+// Итерации считаются всегда; CalculateChannelsForPoint<Channels::ITERATIONS> — это в точности прежний цикл.
+template <ChannelMask CHANNELS>
+[[nodiscard]] constexpr PointChannels CalculateChannelsForPoint(const Complex &c, std::uint32_t max_iterations,
+                                                                double escape_radius) noexcept {
+    static_assert((CHANNELS & ~Channels::ALL) == 0, "Unknown channel bits");
+    constexpr bool DERIVATIVE = (CHANNELS & Channels::DISTANCE) != 0;
+    constexpr bool TRAP = (CHANNELS & Channels::ORBIT_TRAP) != 0;
 
     Complex z{0.0, 0.0};
+    Complex dz{0.0, 0.0};
+    double trap_squared = std::numeric_limits<double>::infinity();
     const double escape_radius_squared = escape_radius * escape_radius;
 
-    for (std::uint32_t i = 0; i < max_iterations; ++i) {
+    std::uint32_t i = 0;
+    for (; i < max_iterations; ++i) {
         if (std::norm(z) > escape_radius_squared) {
-            return i;
+            break;
+        }
+        if constexpr (DERIVATIVE) {
+            dz = 2.0 * z * dz + 1.0;
         }
         z = z * z + c;
+        if constexpr (TRAP) {
+            trap_squared = std::min(trap_squared, std::norm(z));
+        }
+    }
+
+    PointChannels point;
+    point.iterations = i;
+    const bool escaped = i < max_iterations;
+    if constexpr ((CHANNELS & Channels::SMOOTH) != 0) {
+        point.smooth = escaped ? i + 1.0 - std::log2(std::log(std::abs(z))) : static_cast<double>(max_iterations);
+    }
+    if constexpr (DERIVATIVE) {
+        const double abs_z = std::abs(z);
+        point.distance = escaped ? 0.5 * abs_z * std::log(abs_z) / std::abs(dz) : 0.0;
     }
-    return max_iterations;
+    if constexpr ((CHANNELS & Channels::FINAL_Z) != 0) {
+        point.final_z = z;
+    }
+    if constexpr (TRAP) {
+        point.orbit_trap = std::sqrt(trap_squared);
+    }
+    return point;
+}
+
+[[nodiscard]] constexpr std::uint32_t CalculateIterationsForPoint(const Complex &c, std::uint32_t max_iterations,
+                                                                  double escape_radius) noexcept {
+    return CalculateChannelsForPoint<Channels::ITERATIONS>(c, max_iterations, escape_radius).iterations;
 }
 
 [[nodiscard]] constexpr Complex Pixel2DToComplex(std::uint32_t x, std::uint32_t y, const ViewPort &viewport,
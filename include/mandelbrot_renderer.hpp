@@ -1,24 +1,196 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <utility>
+
 #include <exec/static_thread_pool.hpp>
+#include <exec/variant_sender.hpp>
 #include <stdexec/execution.hpp>
 
+#include "adaptive_aa.hpp"
+#include "dirty_regions.hpp"
+#include "iteration_histogram.hpp"
 #include "mandelbrot_sender.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
 #include "types.hpp"
 
-class MandelbrotRenderer {
+// Вычисляет область кадра и сразу переводит итерации в RGBA, засекая оба этапа
+[[nodiscard]] inline RenderedTile RenderTile(const mandelbrot::ViewPort &viewport, const RenderSettings &settings,
+                                             const PixelRegion &region) {
+    RenderedTile tile;
+    tile.start = std::chrono::steady_clock::now();
+    const auto matrix = ComputePixelMatrixForRegion(viewport, settings, region);
+    tile.computed = std::chrono::steady_clock::now();
+
+    tile.region = region;
+    tile.region.end_row = region.start_row + static_cast<std::uint32_t>(matrix.size());
+    const auto cols = matrix.empty() ? 0u : static_cast<std::uint32_t>(matrix.front().size());
+    tile.region.end_col = tile.region.start_col + cols;
+    tile.rgba.resize(matrix.size() * cols * RGBA_CHANNELS);
+
+    auto *dst = tile.rgba.data();
+    for (const auto &row : matrix) {
+        for (const auto it : row) {
+            StoreRgba(dst, mandelbrot::IterationsToColor(it, settings.max_iterations));
+            dst += RGBA_CHANNELS;
+            tile.iterations += it;
+        }
+    }
+    tile.end = std::chrono::steady_clock::now();
+    return tile;
+}
+
+// Начало вычисления полосы на потоке пула: время и показания аппаратных счётчиков потока
+struct StripStart {
+    std::chrono::steady_clock::time_point time;
+    perf::Scope counters;
+};
+
+// Итерации полосы вместе с моментами начала и конца её вычисления на пуле
+struct TimedStrip {
+    PixelMatrix matrix;
+    ChannelBuffers channels;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    std::uint64_t iterations{};
+    IterationHistogram histogram;
+    perf::CounterSet counters;
+};
+
+// Пустой кадр с буферами только под выбранные каналы. Канал ITERATIONS — это итерации и их раскраска:
+// без него pixel_data и rgba_data остаются пустыми, хотя ядро считает итерации всегда.
+[[nodiscard]] inline RenderResult MakeFrameResult(const mandelbrot::ViewPort &viewport,
+                                                  const RenderSettings &settings) {
+    const auto pixels = static_cast<std::size_t>(settings.width) * settings.height;
+    RenderResult result;
+    result.viewport = viewport;
+    result.settings = settings;
+    if ((settings.channels & mandelbrot::Channels::ITERATIONS) != 0) {
+        result.pixel_data.resize(settings.height, std::vector<std::uint32_t>(settings.width));
+        result.rgba_data.resize(pixels * RGBA_CHANNELS);
+    }
+    result.channels.Allocate(settings.channels, pixels);
+    return result;
+}
+
+// Переносит итерации полосы в кадр и раскрашивает их: заполняет pixel_data и rgba_data, если они выделены.
+// Каналы полосы, если переданы, копируются в result.channels.
+inline void MergeStrip(RenderResult &result, const PixelRegion &region, const PixelMatrix &matrix,
+                       const ChannelBuffers *channels = nullptr) {
+    const auto &settings = result.settings;
+    const bool iterations = !result.pixel_data.empty();
+    for (std::uint32_t py = 0; py < matrix.size(); ++py) {
+        const std::uint32_t y = region.start_row + py;
+        if (iterations) {
+            auto *rgba_row = result.rgba_data.data() +
+                             (static_cast<std::size_t>(y) * settings.width + region.start_col) * RGBA_CHANNELS;
+            for (std::uint32_t px = 0; px < matrix[py].size(); ++px) {
+                const std::uint32_t x = region.start_col + px;
+                const std::uint32_t it = matrix[py][px];
+                result.pixel_data[y][x] = it;
+                StoreRgba(rgba_row + px * RGBA_CHANNELS, mandelbrot::IterationsToColor(it, settings.max_iterations));
+            }
+        }
+        if (channels != nullptr) {
+            const auto cols = matrix[py].size();
+            const auto frame_index = static_cast<std::size_t>(y) * settings.width + region.start_col;
+            result.channels.CopyFrom(*channels, py * cols, frame_index, cols);
+        }
+    }
+}
+
+// Разбивает кадр на полосы высотой tile_rows, начиная с центра экрана — там обычно смотрит пользователь
+[[nodiscard]] inline std::vector<PixelRegion> MakeStreamTiles(const RenderSettings &settings, std::uint32_t tile_rows) {
+    tile_rows = std::max(tile_rows, 1u);
+
+    std::vector<PixelRegion> tiles;
+    for (std::uint32_t row = 0; row < settings.height; row += tile_rows) {
+        tiles.push_back({row, std::min(row + tile_rows, settings.height), 0, settings.width});
+    }
+
+    const auto center = static_cast<std::int64_t>(settings.height);
+    std::stable_sort(tiles.begin(), tiles.end(), [center](const PixelRegion &a, const PixelRegion &b) {
+        return std::abs(static_cast<std::int64_t>(a.start_row + a.end_row) - center) <
+               std::abs(static_cast<std::int64_t>(b.start_row + b.end_row) - center);
+    });
+    return tiles;
+}
+
+// Наибольшее число полос или исполнителей, для которого инстанцируются рендеры
+inline constexpr std::size_t MAX_LANES = 64;
+
+// Переводит число полос, известное только во время выполнения, в параметр шаблона: вызывает
+// f.template operator()<N>() для ближайшей сверху степени двойки N (не больше MAX_LANES).
+// Так набор инстанцирований RenderAsync и StreamTilesAsync остаётся небольшим.
+template <std::size_t N = 1, typename F>
+decltype(auto) DispatchLanes(std::size_t lanes, F &&f) {
+    if constexpr (N < MAX_LANES) {
+        if (lanes > N) {
+            return DispatchLanes<N * 2>(lanes, std::forward<F>(f));
+        }
+    }
+    return f.template operator()<N>();
+}
+
+// Если планировщик умеет отправлять пачку задач за одно пробуждение (Batched у ws::WorkStealingPool),
+// задачи, которые sender ставит при запуске, уходят пачкой; иначе sender возвращается как есть
+template <typename Scheduler, typename Sender>
+[[nodiscard]] auto SubmitAsBatch(const Scheduler &scheduler, Sender &&sender) {
+    if constexpr (requires { scheduler.Batched(std::forward<Sender>(sender)); }) {
+        return scheduler.Batched(std::forward<Sender>(sender));
+    } else {
+        return std::forward<Sender>(sender);
+    }
+}
+
+using ThreadPoolScheduler = decltype(std::declval<exec::static_thread_pool &>().get_scheduler());
+
+// Общий пул процесса: рендереры, построенные на его планировщике, делят ядра без переподписки
+[[nodiscard]] inline exec::static_thread_pool &SharedThreadPool() {
+    static exec::static_thread_pool pool{std::thread::hardware_concurrency()};
+    return pool;
+}
+
+// Рендерер поверх любого планировщика stdexec: общего или своего пула, inline-планировщика в тестах,
+// другой реализации пула для сравнения. Планировщик должен жить дольше рендерера.
+template <stdexec::scheduler Scheduler>
+class BasicMandelbrotRenderer {
 private:
-    exec::static_thread_pool thread_pool_;
+    // Собственный пул, если рендерер создан по числу потоков, а не на готовом планировщике
+    std::unique_ptr<exec::static_thread_pool> owned_pool_;
+    Scheduler scheduler_;
+    std::uint32_t concurrency_;
 
 public:
-    explicit MandelbrotRenderer(std::uint32_t num_threads = std::thread::hardware_concurrency())
-        : thread_pool_{num_threads} {}
+    explicit BasicMandelbrotRenderer(Scheduler scheduler,
+                                     std::uint32_t concurrency = std::thread::hardware_concurrency())
+        : scheduler_{std::move(scheduler)}, concurrency_{std::max(concurrency, 1u)} {}
+
+    explicit BasicMandelbrotRenderer(std::uint32_t num_threads = std::thread::hardware_concurrency())
+        requires std::same_as<Scheduler, ThreadPoolScheduler>
+        : owned_pool_{std::make_unique<exec::static_thread_pool>(num_threads)},
+          scheduler_{owned_pool_->get_scheduler()}, concurrency_{std::max(num_threads, 1u)} {}
+
+    [[nodiscard]] Scheduler GetScheduler() const noexcept { return scheduler_; }
+
+    // Сколько задач планировщик выполняет одновременно — по нему выбирается число полос и исполнителей
+    [[nodiscard]] std::uint32_t Concurrency() const noexcept { return concurrency_; }
 
     template <size_t N>
     [[nodiscard]] auto RenderAsync(mandelbrot::ViewPort viewport, RenderSettings settings) {
         /*
         1. Разделите экран на N полос, чтобы каждый пиксель находился только в одной из N областей
-        2. Запланируйте (schedule) выполнение MandelbrotSender сендера на thread_pool_
+        2. Запланируйте (schedule) выполнение MandelbrotSender сендера на scheduler_
         3. Следующей операцией в цепочке сендеров необходимо реализовать преобразование полученного результата в
         двумерный массив цветов для заданной области пикселей
         4. Используйте техники fold-expr и раскрытие пачки параметров для объединения всех созданных сендеров в новом
@@ -29,48 +201,218 @@ public:
         Важно: функция RenderAsync должна лишь возвращать сендер, а его непосредственный запуск должен производиться в
         сенлдере CalculateMandelbrotAsyncSender
         */
-        auto sched = thread_pool_.get_scheduler();
+        using Clock = std::chrono::steady_clock;
+        auto sched = scheduler_;
 
+        const auto partition_start = Clock::now();
         std::array<PixelRegion, N> regions;
         const std::uint32_t strip_height = settings.height / N;
         const std::uint32_t remainder = settings.height % N;
         std::uint32_t current_row = 0;
-        
+
         for (size_t i = 0; i < N; ++i) {
             std::uint32_t height = strip_height + (i < remainder ? 1 : 0);
             regions[i] = {current_row, current_row + height, 0, settings.width};
             current_row += height;
         }
+        const auto partition_time = Clock::now() - partition_start;
+
+        // Каждая полоса засекает своё время на потоке пула и сразу считает сумму и гистограмму итераций
+        auto timed_strip = [&](const PixelRegion &region) {
+            return stdexec::schedule(sched) | stdexec::then([] { return StripStart{Clock::now(), perf::Scope{}}; }) |
+                   stdexec::let_value([viewport, settings, region](const StripStart &start) {
+                       return MakeMandelbrotSender(viewport, settings, region) |
+                              stdexec::then([start, region, settings](PixelMatrix matrix, ChannelBuffers channels) {
+                                  std::uint64_t iterations = 0;
+                                  IterationHistogram histogram{settings.max_iterations};
+                                  for (const auto &row : matrix) {
+                                      iterations = std::accumulate(row.begin(), row.end(), iterations);
+                                      histogram.AddRow(row);
+                                  }
+                                  const auto counters = start.counters.Stop();
+                                  const auto end = Clock::now();
+                                  trace::Record("strip", "compute", start.time, end, "start_row", region.start_row);
+                                  return TimedStrip{std::move(matrix), std::move(channels), start.time, end,
+                                                    iterations, histogram, counters};
+                              });
+                   });
+        };
 
         auto create_when_all = [&]<size_t... I>(std::index_sequence<I...>) {
-            return stdexec::when_all((stdexec::on(sched, MakeMandelbrotSender(viewport, settings, regions[I])))...);
+            return stdexec::when_all(timed_strip(regions[I])...);
         };
 
-        auto all_senders = create_when_all(std::make_index_sequence<N>{});
+        auto all_senders = SubmitAsBatch(sched, create_when_all(std::make_index_sequence<N>{}));
 
-        return all_senders | stdexec::then([regions, viewport, settings](auto &&...matrices) {
-                   RenderResult result;
-                   result.viewport = viewport;
-                   result.settings = settings;
-                   result.pixel_data.resize(settings.height, std::vector<std::uint32_t>(settings.width));
-                   result.color_data.resize(settings.height, std::vector<mandelbrot::RgbColor>(settings.width));
+        return all_senders | stdexec::then([regions, viewport, settings, partition_time](auto &&...strips) {
+                   const trace::Span span{"merge", "render"};
+                   const perf::Scope merge_counters;
+                   const auto merge_start = Clock::now();
+                   auto result = MakeFrameResult(viewport, settings);
+                   result.dirty_regions = MergeDirtyRegions({regions.begin(), regions.end()});
 
                    size_t index = 0;
-                   (
-                       [&](auto &&mat) {
-                           const auto &reg = regions[index++];
-                           for (std::uint32_t py = 0; py < mat.size(); ++py) {
-                               std::uint32_t y = reg.start_row + py;
-                               for (std::uint32_t px = 0; px < mat[py].size(); ++px) {
-                                   std::uint32_t x = reg.start_col + px;
-                                   std::uint32_t it = mat[py][px];
-                                   result.pixel_data[y][x] = it;
-                                   result.color_data[y][x] = mandelbrot::IterationsToColor(it, settings.max_iterations);
-                               }
-                           }
-                       }(std::move(matrices)),
-                       ...);
+                   (MergeStrip(result, regions[index++], strips.matrix, &strips.channels), ...);
+
+                   auto &stats = result.stats;
+                   stats.partition = partition_time;
+                   stats.compute = std::max({strips.end...}) - std::min({strips.start...});
+                   stats.merge = Clock::now() - merge_start;
+                   stats.worker_busy = {(strips.end - strips.start)...};
+                   stats.total_iterations = (strips.iterations + ...);
+                   (stats.iteration_histogram += ... += strips.histogram);
+                   stats.pixels_computed = static_cast<std::uint64_t>(settings.width) * settings.height;
+                   (stats.hw_compute += ... += strips.counters);
+                   stats.hw_merge = merge_counters.Stop();
+                   result.render_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       stats.partition + stats.compute + stats.merge);
+                   return result;
+               }) |
+               stdexec::let_value([sched](RenderResult &result) {
+                   const auto aa_start = Clock::now();
+                   // Второй проход: граничные пиксели делятся на N частей и досэмплируются на пуле
+                   auto edges = std::make_shared<std::vector<std::uint32_t>>();
+                   if (result.settings.aa_samples > 0 && !result.pixel_data.empty()) {
+                       *edges = aa::FindEdgePixels(result.pixel_data, result.settings.aa_threshold);
+                   }
+                   result.aa_pixels = static_cast<std::uint32_t>(edges->size());
+
+                   auto supersample_part = [&result, edges](size_t part) {
+                       return [&result, edges, part]() {
+                           const trace::Span span{"antialias", "compute", "part", static_cast<std::int64_t>(part)};
+                           const perf::Scope counters;
+                           aa::SupersampleEdges(result, *edges, edges->size() * part / N,
+                                                edges->size() * (part + 1) / N);
+                           return counters.Stop();
+                       };
+                   };
+                   auto create_aa_when_all = [&]<size_t... I>(std::index_sequence<I...>) {
+                       return stdexec::when_all((stdexec::schedule(sched) | stdexec::then(supersample_part(I)))...);
+                   };
+                   auto antialias = [&] {
+                       return SubmitAsBatch(sched, create_aa_when_all(std::make_index_sequence<N>{})) |
+                              stdexec::then([&result, aa_start](auto... counters) {
+                                  (result.stats.hw_antialias += ... += counters);
+                                  result.stats.antialias = Clock::now() - aa_start;
+                                  result.render_time += std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      result.stats.antialias);
+                                  return std::move(result);
+                              });
+                   };
+                   using AntialiasSender =
+                       exec::variant_sender<decltype(stdexec::just(std::move(result))), decltype(antialias())>;
+
+                   // Сглаживание выключено или досэмплировать нечего — кадр идёт дальше без задач на пуле
+                   if (edges->empty()) {
+                       return AntialiasSender{stdexec::just(std::move(result))};
+                   }
+                   return AntialiasSender{antialias()};
+               });
+    }
+
+    // Итерации произвольного прямоугольника кадра: строки области делятся на N частей, которые считаются на пуле.
+    // Считаются только пиксели области (обрезанной по кадру); результат — матрица её строк и столбцов,
+    // которую MergeStrip кладёт на место в кадре. Дополнительные каналы здесь не считаются.
+    template <size_t N>
+    [[nodiscard]] auto RenderRegionAsync(mandelbrot::ViewPort viewport, RenderSettings settings, PixelRegion region) {
+        auto sched = scheduler_;
+        settings.channels = mandelbrot::Channels::ITERATIONS;
+
+        region.start_row = std::min(region.start_row, settings.height);
+        region.end_row = std::max(std::min(region.end_row, settings.height), region.start_row);
+        const auto rows = region.end_row - region.start_row;
+        std::array<PixelRegion, N> parts;
+        for (size_t i = 0; i < N; ++i) {
+            parts[i] = region;
+            parts[i].start_row = region.start_row + static_cast<std::uint32_t>(rows * i / N);
+            parts[i].end_row = region.start_row + static_cast<std::uint32_t>(rows * (i + 1) / N);
+        }
+
+        auto part_sender = [&](const PixelRegion &part) {
+            return stdexec::schedule(sched) | stdexec::let_value([viewport, settings, part] {
+                       return MakeMandelbrotSender(viewport, settings, part) |
+                              stdexec::then([](PixelMatrix matrix, ChannelBuffers) { return matrix; });
+                   });
+        };
+        auto create_when_all = [&]<size_t... I>(std::index_sequence<I...>) {
+            return stdexec::when_all(part_sender(parts[I])...);
+        };
+
+        return SubmitAsBatch(sched, create_when_all(std::make_index_sequence<N>{})) |
+               stdexec::then([rows](auto &&...matrices) {
+                   const trace::Span span{"region merge", "render"};
+                   PixelMatrix result;
+                   result.reserve(rows);
+                   (std::move(matrices.begin(), matrices.end(), std::back_inserter(result)), ...);
                    return result;
                });
     }
+
+    // Частичное обновление готового кадра (уточнённый тайл, исправленный глитч): пересчитывает область в его
+    // viewport и settings и возвращает кадр, у которого dirty_regions — только эта область, так что в текстуру
+    // выгружается лишь она. Сглаживание и дополнительные каналы области не пересчитываются.
+    template <size_t N>
+    [[nodiscard]] auto RenderRegionIntoAsync(RenderResult frame, PixelRegion region) {
+        region.end_row = std::min(region.end_row, frame.settings.height);
+        region.end_col = std::min(region.end_col, frame.settings.width);
+        if (IsEmptyRegion(region)) {
+            region = PixelRegion{};
+        }
+        const auto start = std::chrono::steady_clock::now();
+        return RenderRegionAsync<N>(frame.viewport, frame.settings, region) |
+               stdexec::then([frame = std::move(frame), region, start](PixelMatrix matrix) mutable {
+                   frame.stats = RenderStats{};
+                   frame.aa_pixels = 0;
+                   frame.tiles.clear();
+                   frame.dirty_regions.clear();
+                   if (!IsEmptyRegion(region) && !frame.pixel_data.empty()) {
+                       MergeStrip(frame, region, matrix);
+                       frame.dirty_regions.push_back(region);
+                       frame.stats.pixels_computed =
+                           static_cast<std::uint64_t>(region.end_row - region.start_row) *
+                           (region.end_col - region.start_col);
+                   }
+                   frame.stats.compute = std::chrono::steady_clock::now() - start;
+                   frame.render_time = std::chrono::duration_cast<std::chrono::milliseconds>(frame.stats.compute);
+                   return std::move(frame);
+               });
+    }
+
+    // Потоковый рендер: N исполнителей разбирают полосы кадра из общего счётчика и отдают каждую готовую полосу
+    // в sink(RenderedTile &&) прямо из потока пула. Если sink вернул false, кадр больше не нужен и работа
+    // прекращается. sink вызывается конкурентно и должен быть потокобезопасным.
+    template <size_t N, typename TileSink>
+    [[nodiscard]] auto StreamTilesAsync(mandelbrot::ViewPort viewport, RenderSettings settings,
+                                        std::uint32_t tile_rows, TileSink sink) {
+        auto sched = scheduler_;
+
+        struct SharedState {
+            std::vector<PixelRegion> tiles;
+            std::atomic<std::size_t> next_tile{0};
+            TileSink sink;
+        };
+        auto shared = std::make_shared<SharedState>(MakeStreamTiles(settings, tile_rows), 0, std::move(sink));
+
+        auto lane = [shared, viewport, settings]() {
+            const auto total = shared->tiles.size();
+            for (auto i = shared->next_tile.fetch_add(1, std::memory_order_relaxed); i < total;
+                 i = shared->next_tile.fetch_add(1, std::memory_order_relaxed)) {
+                const trace::Span span{"tile", "compute", "start_row", shared->tiles[i].start_row};
+                if (!shared->sink(RenderTile(viewport, settings, shared->tiles[i]))) {
+                    shared->next_tile.store(total, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        };
+
+        auto create_when_all = [&]<size_t... I>(std::index_sequence<I...>) {
+            return stdexec::when_all(((void)I, stdexec::schedule(sched) | stdexec::then(lane))...);
+        };
+
+        return SubmitAsBatch(sched, create_when_all(std::make_index_sequence<N>{}));
+    }
 };
+
+// Рендерер на пуле exec::static_thread_pool: собственном (по числу потоков) или общем
+// (MandelbrotRenderer{SharedThreadPool().get_scheduler()})
+using MandelbrotRenderer = BasicMandelbrotRenderer<ThreadPoolScheduler>;
@@ -1,27 +1,79 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <utility>
 #include <stdexec/execution.hpp>
 
+#include "simd_kernel.hpp"
 #include "types.hpp"
 
-PixelMatrix ComputePixelMatrixForRegion(const mandelbrot::ViewPort &viewport, const RenderSettings &settings,
-                                        const PixelRegion &region) {
+// Строка row в столбцах [start_c, end_c) скалярным ядром с каналами CHANNELS: итерации пишутся в iterations[i],
+// остальные каналы — в channels начиная с индекса offset
+template <mandelbrot::ChannelMask CHANNELS>
+void ComputeChannelRow(const mandelbrot::ViewPort &viewport, const RenderSettings &settings, std::uint32_t row,
+                       std::uint32_t start_c, std::uint32_t end_c, std::uint32_t *iterations, ChannelBuffers *channels,
+                       std::size_t offset) {
+    for (std::uint32_t c = start_c; c < end_c; ++c) {
+        const auto complex_point = mandelbrot::Pixel2DToComplex(c, row, viewport, settings.width, settings.height);
+        const auto point = mandelbrot::CalculateChannelsForPoint<CHANNELS>(complex_point, settings.max_iterations,
+                                                                           settings.escape_radius);
+        iterations[c - start_c] = point.iterations;
+        if constexpr (CHANNELS != mandelbrot::Channels::ITERATIONS) {
+            channels->Store<CHANNELS>(offset + (c - start_c), point);
+        }
+    }
+}
+
+using ChannelRowKernel = void (*)(const mandelbrot::ViewPort &, const RenderSettings &, std::uint32_t, std::uint32_t,
+                                  std::uint32_t, std::uint32_t *, ChannelBuffers *, std::size_t);
+
+// Готовое ядро на каждую маску каналов: выбор в settings.channels сводится к одному косвенному вызову на строку
+inline constexpr auto CHANNEL_ROW_KERNELS = []<std::size_t... MASK>(std::index_sequence<MASK...>) {
+    return std::array<ChannelRowKernel, sizeof...(MASK)>{
+        &ComputeChannelRow<static_cast<mandelbrot::ChannelMask>(MASK) | mandelbrot::Channels::ITERATIONS>...};
+}(std::make_index_sequence<mandelbrot::Channels::ALL + 1>{});
+
+// Итерации области кадра. Если передан channels, туда же считаются каналы settings.channels помимо итераций
+// (по пикселю области, строки подряд); векторные ядра считают только итерации, поэтому каналы всегда идут
+// через скалярное ядро.
+inline PixelMatrix ComputePixelMatrixForRegion(const mandelbrot::ViewPort &viewport, const RenderSettings &settings,
+                                               const PixelRegion &region, ChannelBuffers *channels = nullptr) {
     const auto screen_w = settings.width;
     const auto screen_h = settings.height;
 
+    // Область обрезается по кадру; матрица содержит ровно её строки и столбцы
     const auto start_r = std::min(region.start_row, screen_h);
-    const auto end_r = std::min(region.end_row, screen_h);
+    const auto end_r = std::max(std::min(region.end_row, screen_h), start_r);
+    const auto start_c = std::min(region.start_col, screen_w);
+    const auto end_c = std::max(std::min(region.end_col, screen_w), start_c);
 
     PixelMatrix result;
     result.resize(end_r - start_r);
 
+    const auto mask = channels != nullptr ? settings.channels & mandelbrot::Channels::ALL : 0u;
+    const auto kernel = (mask & ~mandelbrot::Channels::ITERATIONS) != 0 ? mandelbrot::Kernel::SCALAR : settings.kernel;
+    const auto row_kernel = CHANNEL_ROW_KERNELS[mask];
+    if (channels != nullptr) {
+        channels->Allocate(mask, static_cast<std::size_t>(end_r - start_r) * (end_c - start_c));
+    }
+
     for (std::uint32_t r = start_r; r < end_r; ++r) {
-        result[r - start_r].resize(screen_w);
-        for (std::uint32_t c = 0; c < screen_w; ++c) {
-            auto complex_point = mandelbrot::Pixel2DToComplex(c, r, viewport, screen_w, screen_h);
-            result[r - start_r][c] =
-                mandelbrot::CalculateIterationsForPoint(complex_point, settings.max_iterations, settings.escape_radius);
+        auto &row = result[r - start_r];
+        row.resize(end_c - start_c);
+        switch (kernel) {
+        case mandelbrot::Kernel::SIMD:
+            mandelbrot::simd::ComputeRowFixed(viewport, screen_w, screen_h, r, start_c, end_c, settings.max_iterations,
+                                              settings.escape_radius, row.data());
+            break;
+        case mandelbrot::Kernel::SIMD_STREAMING:
+            mandelbrot::simd::ComputeRowStreaming(viewport, screen_w, screen_h, r, start_c, end_c,
+                                                  settings.max_iterations, settings.escape_radius, row.data());
+            break;
+        case mandelbrot::Kernel::SCALAR:
+            row_kernel(viewport, settings, r, start_c, end_c, row.data(), channels,
+                       static_cast<std::size_t>(r - start_r) * (end_c - start_c));
+            break;
         }
     }
     return result;
@@ -36,7 +88,9 @@ struct MandelbrotOperationState {
 
     void start() noexcept {
         try {
-            stdexec::set_value(std::move(receiver_), ComputePixelMatrixForRegion(viewport_, settings_, region_));
+            ChannelBuffers channels;
+            auto matrix = ComputePixelMatrixForRegion(viewport_, settings_, region_, &channels);
+            stdexec::set_value(std::move(receiver_), std::move(matrix), std::move(channels));
         } catch (...) {
             stdexec::set_error(std::move(receiver_), std::current_exception());
         }
@@ -58,7 +112,7 @@ struct MandelbrotSender {
 
     template <typename Env>
     auto get_completion_signatures(Env &&) const {
-        return stdexec::completion_signatures<stdexec::set_value_t(PixelMatrix),
+        return stdexec::completion_signatures<stdexec::set_value_t(PixelMatrix, ChannelBuffers),
                                               stdexec::set_error_t(std::exception_ptr), stdexec::set_stopped_t()>{};
     }
 };
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+// Минимальная обёртка над POSIX TCP сокетами (только IPv4): сервер тайлов и распределённый рендер
+// работают на локальной машине или в доверенной сети, поэтому TLS и разрешение имён не нужны.
+
+namespace net {
+
+[[noreturn]] inline void ThrowSystemError(const char *what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Владеет файловым дескриптором сокета и закрывает его в деструкторе
+class Socket {
+public:
+    Socket() = default;
+    explicit Socket(int fd) noexcept : fd_{fd} {}
+    Socket(Socket &&other) noexcept : fd_{std::exchange(other.fd_, -1)} {}
+    Socket &operator=(Socket &&other) noexcept {
+        if (this != &other) {
+            Close();
+            fd_ = std::exchange(other.fd_, -1);
+        }
+        return *this;
+    }
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+    ~Socket() { Close(); }
+
+    [[nodiscard]] int Fd() const noexcept { return fd_; }
+    [[nodiscard]] bool Valid() const noexcept { return fd_ >= 0; }
+
+    // Прерывает блокирующие accept/recv в других потоках, не освобождая дескриптор
+    void Shutdown() const noexcept {
+        if (fd_ >= 0) {
+            ::shutdown(fd_, SHUT_RDWR);
+        }
+    }
+
+    void Close() noexcept {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    int fd_{-1};
+};
+
+[[nodiscard]] inline sockaddr_in MakeAddress(const std::string &host, std::uint16_t port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid IPv4 address: " + host);
+    }
+    return addr;
+}
+
+// Слушающий сокет; порт 0 — выбрать свободный, узнать его можно через LocalPort
+[[nodiscard]] inline Socket ListenTcp(const std::string &host, std::uint16_t port, int backlog = 128) {
+    Socket socket{::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if (!socket.Valid()) {
+        ThrowSystemError("socket");
+    }
+    const int reuse = 1;
+    ::setsockopt(socket.Fd(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    const auto addr = MakeAddress(host, port);
+    if (::bind(socket.Fd(), reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ThrowSystemError("bind");
+    }
+    if (::listen(socket.Fd(), backlog) != 0) {
+        ThrowSystemError("listen");
+    }
+    return socket;
+}
+
+[[nodiscard]] inline std::uint16_t LocalPort(const Socket &socket) {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (::getsockname(socket.Fd(), reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+        ThrowSystemError("getsockname");
+    }
+    return ntohs(addr.sin_port);
+}
+
+// Ошибки accept, после которых слушающий сокет исправен: сбой одного входящего соединения
+// или временная нехватка ресурсов (дескрипторов, буферов), которая проходит сама
+[[nodiscard]] inline bool IsTransientAcceptError(int error) noexcept {
+    switch (error) {
+    case EINTR:
+    case ECONNABORTED:
+    case EPROTO:
+    case EPERM:
+    case ENETDOWN:
+    case ENETUNREACH:
+    case EHOSTDOWN:
+    case EHOSTUNREACH:
+    case ENOPROTOOPT:
+    case EOPNOTSUPP:
+    case EMFILE:
+    case ENFILE:
+    case ENOBUFS:
+    case ENOMEM:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Один вызов accept: сокет соединения; пустой сокет — слушающий сокет закрыт (Shutdown/Close);
+// nullopt — временная ошибка или (для неблокирующего сокета) нет ожидающих соединений, стоит повторить.
+// При нехватке ресурсов выдерживается короткая пауза, чтобы не крутиться в цикле, пока дескрипторы заняты.
+[[nodiscard]] inline std::optional<Socket> TryAccept(const Socket &listener) {
+    constexpr std::chrono::milliseconds RESOURCE_BACKOFF{10};
+    const int fd = ::accept4(listener.Fd(), nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) {
+        const int no_delay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        return Socket{fd};
+    }
+    const int error = errno;
+    if (error == EAGAIN || error == EWOULDBLOCK) {
+        return std::nullopt;
+    }
+    if (!IsTransientAcceptError(error)) {
+        return Socket{};
+    }
+    if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+        std::this_thread::sleep_for(RESOURCE_BACKOFF);
+    }
+    return std::nullopt;
+}
+
+// Пустой сокет означает, что слушающий сокет закрыт. Временные ошибки повторяются.
+[[nodiscard]] inline Socket Accept(const Socket &listener) {
+    for (;;) {
+        if (auto socket = TryAccept(listener)) {
+            return std::move(*socket);
+        }
+    }
+}
+
+// Канал пробуждения на pipe: Notify из любого потока прерывает ожидание Accept(listener, wake)
+class WakePipe {
+public:
+    WakePipe() {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+            ThrowSystemError("pipe2");
+        }
+        read_fd_ = fds[0];
+        write_fd_ = fds[1];
+    }
+    WakePipe(const WakePipe &) = delete;
+    WakePipe &operator=(const WakePipe &) = delete;
+    ~WakePipe() {
+        ::close(read_fd_);
+        ::close(write_fd_);
+    }
+
+    void Notify() const noexcept {
+        const char byte = 1;
+        // Переполненный канал уже разбудит ожидающих, поэтому результат записи не важен
+        (void)!::write(write_fd_, &byte, 1);
+    }
+
+    [[nodiscard]] int ReadFd() const noexcept { return read_fd_; }
+
+private:
+    int read_fd_{-1};
+    int write_fd_{-1};
+};
+
+// Ожидает соединение или сигнал wake. Пустой сокет — пришёл сигнал или слушающий сокет закрыт.
+// Слушающий сокет должен быть неблокирующим (SetNonBlocking): соединение, оборвавшееся между poll
+// и accept, иначе заблокировало бы поток и он пропустил бы сигнал.
+[[nodiscard]] inline Socket Accept(const Socket &listener, const WakePipe &wake) {
+    for (;;) {
+        std::array<pollfd, 2> fds{{{listener.Fd(), POLLIN, 0}, {wake.ReadFd(), POLLIN, 0}}};
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return Socket{};
+        }
+        if (fds[1].revents != 0 || (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+            return Socket{};
+        }
+        if (auto socket = TryAccept(listener)) {
+            return std::move(*socket);
+        }
+    }
+}
+
+inline void SetNonBlocking(const Socket &socket) {
+    const int flags = ::fcntl(socket.Fd(), F_GETFL);
+    if (flags < 0 || ::fcntl(socket.Fd(), F_SETFL, flags | O_NONBLOCK) != 0) {
+        ThrowSystemError("fcntl");
+    }
+}
+
+[[nodiscard]] inline Socket ConnectTcp(const std::string &host, std::uint16_t port) {
+    Socket socket{::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if (!socket.Valid()) {
+        ThrowSystemError("socket");
+    }
+    const auto addr = MakeAddress(host, port);
+    if (::connect(socket.Fd(), reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ThrowSystemError("connect");
+    }
+    const int no_delay = 1;
+    ::setsockopt(socket.Fd(), IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    return socket;
+}
+
+// Отправляет все байты; false — соединение закрыто другой стороной
+[[nodiscard]] inline bool SendAll(const Socket &socket, std::string_view data) noexcept {
+    while (!data.empty()) {
+        const auto sent = ::send(socket.Fd(), data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+// Читает ровно size байт; false — соединение закрыто раньше
+[[nodiscard]] inline bool RecvExact(const Socket &socket, void *buffer, std::size_t size) noexcept {
+    auto *dst = static_cast<char *>(buffer);
+    while (size > 0) {
+        const auto received = ::recv(socket.Fd(), dst, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        dst += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+// Буферизованное чтение до разделителя (например, конца HTTP заголовков). Лишние байты остаются в буфере
+// и достаются следующему вызову.
+class LineReader {
+public:
+    explicit LineReader(const Socket &socket) : socket_{socket} {}
+
+    [[nodiscard]] std::optional<std::string> ReadUntil(std::string_view delimiter, std::size_t max_size) {
+        for (;;) {
+            if (const auto pos = buffer_.find(delimiter); pos != std::string::npos) {
+                auto result = buffer_.substr(0, pos);
+                buffer_.erase(0, pos + delimiter.size());
+                return result;
+            }
+            if (buffer_.size() > max_size) {
+                return std::nullopt;
+            }
+            char chunk[4096];
+            const auto received = ::recv(socket_.Fd(), chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return std::nullopt;
+            }
+            buffer_.append(chunk, static_cast<std::size_t>(received));
+        }
+    }
+
+    // Читает ровно size байт с учётом уже буферизованных
+    [[nodiscard]] std::optional<std::string> ReadExact(std::size_t size) {
+        std::string result = buffer_.substr(0, size);
+        buffer_.erase(0, result.size());
+        const auto have = result.size();
+        result.resize(size);
+        if (!RecvExact(socket_, result.data() + have, size - have)) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+private:
+    const Socket &socket_;
+    std::string buffer_;
+};
+
+}  // namespace net
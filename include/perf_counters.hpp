@@ -0,0 +1,177 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Аппаратные счётчики производительности через Linux perf_event_open. Каждый поток открывает свои
+// счётчики при первом чтении и держит их до завершения. Если счётчики выключены, недоступны
+// (не Linux, контейнер, perf_event_paranoid) или конкретное событие не поддерживается процессором,
+// чтение возвращает пустой набор и ничего не стоит.
+//
+// Счётчика операций с плавающей точкой нет среди переносимых событий perf: он задаётся сырым кодом
+// конкретной микроархитектуры, поэтому здесь не собирается.
+
+namespace perf {
+
+enum class Event : std::size_t {
+    CYCLES = 0,
+    INSTRUCTIONS = 1,
+    BRANCH_MISSES = 2,
+    LLC_MISSES = 3,
+};
+
+inline constexpr std::size_t EVENT_COUNT = 4;
+inline constexpr std::array<std::string_view, EVENT_COUNT> EVENT_NAMES{"cycles", "instructions", "branch_misses",
+                                                                       "llc_misses"};
+
+// Значения счётчиков; valid отмечает события, которые действительно измерялись
+struct CounterSet {
+    std::array<std::uint64_t, EVENT_COUNT> values{};
+    std::array<bool, EVENT_COUNT> valid{};
+
+    [[nodiscard]] bool Has(Event event) const noexcept { return valid[static_cast<std::size_t>(event)]; }
+    [[nodiscard]] std::uint64_t Get(Event event) const noexcept { return values[static_cast<std::size_t>(event)]; }
+
+    [[nodiscard]] bool Any() const noexcept {
+        for (const auto v : valid) {
+            if (v) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Инструкций за такт; 0, если цикл или инструкции не измерялись
+    [[nodiscard]] double Ipc() const noexcept {
+        if (!Has(Event::CYCLES) || !Has(Event::INSTRUCTIONS) || Get(Event::CYCLES) == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(Get(Event::INSTRUCTIONS)) / static_cast<double>(Get(Event::CYCLES));
+    }
+
+    CounterSet &operator+=(const CounterSet &other) noexcept {
+        for (std::size_t i = 0; i < EVENT_COUNT; ++i) {
+            if (other.valid[i]) {
+                values[i] += other.values[i];
+                valid[i] = true;
+            }
+        }
+        return *this;
+    }
+
+    // Разница двух чтений одного потока
+    [[nodiscard]] friend CounterSet operator-(const CounterSet &end, const CounterSet &start) noexcept {
+        CounterSet delta;
+        for (std::size_t i = 0; i < EVENT_COUNT; ++i) {
+            delta.valid[i] = end.valid[i] && start.valid[i];
+            delta.values[i] = delta.valid[i] && end.values[i] >= start.values[i] ? end.values[i] - start.values[i] : 0;
+        }
+        return delta;
+    }
+};
+
+// Счётчики текущего потока
+class ThreadCounters {
+public:
+    ThreadCounters() noexcept {
+#if defined(__linux__)
+        constexpr std::array<std::uint64_t, EVENT_COUNT> CONFIGS{PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                                 PERF_COUNT_HW_BRANCH_MISSES,
+                                                                 PERF_COUNT_HW_CACHE_MISSES};
+        for (std::size_t i = 0; i < EVENT_COUNT; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = CONFIGS[i];
+            // Только пользовательский код: так счётчики доступны без root при perf_event_paranoid <= 2
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds_[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        }
+#endif
+    }
+
+    ThreadCounters(const ThreadCounters &) = delete;
+    ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+    ~ThreadCounters() {
+#if defined(__linux__)
+        for (const auto fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+#endif
+    }
+
+    [[nodiscard]] CounterSet Read() const noexcept {
+        CounterSet result;
+#if defined(__linux__)
+        for (std::size_t i = 0; i < EVENT_COUNT; ++i) {
+            if (fds_[i] < 0) {
+                continue;
+            }
+            // value, time_enabled, time_running
+            std::uint64_t data[3]{};
+            if (::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) {
+                continue;
+            }
+            // При мультиплексировании счётчик работал не всё время — масштабируем на долю времени
+            result.values[i] = data[2] == data[1] ? data[0]
+                                                  : static_cast<std::uint64_t>(static_cast<double>(data[0]) *
+                                                                               static_cast<double>(data[1]) /
+                                                                               static_cast<double>(data[2]));
+            result.valid[i] = true;
+        }
+#endif
+        return result;
+    }
+
+private:
+    std::array<int, EVENT_COUNT> fds_{-1, -1, -1, -1};
+};
+
+namespace detail {
+
+inline std::atomic<bool> &EnabledFlag() noexcept {
+    static std::atomic<bool> flag{false};
+    return flag;
+}
+
+}  // namespace detail
+
+inline void Enable() noexcept { detail::EnabledFlag().store(true, std::memory_order_release); }
+inline void Disable() noexcept { detail::EnabledFlag().store(false, std::memory_order_release); }
+[[nodiscard]] inline bool Enabled() noexcept { return detail::EnabledFlag().load(std::memory_order_relaxed); }
+
+// Текущие значения счётчиков потока; пустой набор, если сбор выключен
+[[nodiscard]] inline CounterSet ReadThisThread() noexcept {
+    if (!Enabled()) {
+        return {};
+    }
+    thread_local const ThreadCounters counters;
+    return counters.Read();
+}
+
+// Счётчики за время жизни объекта в одном потоке
+class Scope {
+public:
+    Scope() noexcept : start_{ReadThisThread()} {}
+
+    [[nodiscard]] CounterSet Stop() const noexcept { return start_.Any() ? ReadThisThread() - start_ : CounterSet{}; }
+
+private:
+    CounterSet start_;
+};
+
+}  // namespace perf
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "iteration_histogram.hpp"
+#include "perf_counters.hpp"
+
+// Статистика одного кадра: где тратится время и насколько равномерно нагружены исполнители
+struct RenderStats {
+    using Duration = std::chrono::nanoseconds;
+
+    // Время по этапам (по часам, а не процессорное)
+    Duration partition{};
+    Duration compute{};
+    Duration merge{};
+    Duration antialias{};
+    // Заполняет тот, кто показывает или сохраняет кадр
+    Duration present{};
+
+    // Время работы каждой задачи вычисления полосы на пуле
+    std::vector<Duration> worker_busy;
+
+    std::uint64_t total_iterations{};
+    // Пиксели, для которых посчитаны итерации, и пиксели, заполненные без вычисления
+    std::uint64_t pixels_computed{};
+    std::uint64_t pixels_filled{};
+    // Распределение итераций по посчитанным пикселям, сложенное из гистограмм полос
+    IterationHistogram iteration_histogram;
+
+    // Аппаратные счётчики по этапам, суммарно по всем потокам; пустые, если сбор выключен
+    perf::CounterSet hw_compute;
+    perf::CounterSet hw_merge;
+    perf::CounterSet hw_antialias;
+
+    [[nodiscard]] Duration Total() const noexcept { return partition + compute + merge + antialias + present; }
+
+    [[nodiscard]] Duration MaxWorkerBusy() const noexcept {
+        return worker_busy.empty() ? Duration{} : *std::max_element(worker_busy.begin(), worker_busy.end());
+    }
+
+    [[nodiscard]] Duration MeanWorkerBusy() const noexcept {
+        if (worker_busy.empty()) {
+            return Duration{};
+        }
+        return std::accumulate(worker_busy.begin(), worker_busy.end(), Duration{}) /
+               static_cast<std::int64_t>(worker_busy.size());
+    }
+
+    // Отношение самого долгого исполнителя к среднему: 1.0 — идеальный баланс
+    [[nodiscard]] double LoadImbalance() const noexcept {
+        const auto mean = MeanWorkerBusy();
+        if (mean.count() == 0) {
+            return 1.0;
+        }
+        return static_cast<double>(MaxWorkerBusy().count()) / static_cast<double>(mean.count());
+    }
+};
+
+// Одна строка лога на кадр; счётчики вычисления дописываются, только если они измерялись
+[[nodiscard]] inline std::string FormatRenderStats(const RenderStats &stats) {
+    const auto ms = [](RenderStats::Duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    auto line = std::format(
+        "frame {:.2f} ms: partition {:.3f}, compute {:.2f}, merge {:.2f}, aa {:.2f}, present {:.2f} ms; "
+        "{} workers busy max {:.2f} / mean {:.2f} ms, imbalance {:.2f}; {} iterations, {} px computed, {} px filled",
+        ms(stats.Total()), ms(stats.partition), ms(stats.compute), ms(stats.merge), ms(stats.antialias),
+        ms(stats.present), stats.worker_busy.size(), ms(stats.MaxWorkerBusy()), ms(stats.MeanWorkerBusy()),
+        stats.LoadImbalance(), stats.total_iterations, stats.pixels_computed, stats.pixels_filled);
+    const auto &histogram = stats.iteration_histogram;
+    if (histogram.Total() > 0) {
+        line += std::format("; inside {:.1f}%, iterations p50 {:.0f} / p99 {:.0f}", histogram.InsideFraction() * 100.0,
+                            histogram.Quantile(0.5), histogram.Quantile(0.99));
+    }
+    const auto &hw = stats.hw_compute;
+    if (hw.Any()) {
+        line += std::format("; compute IPC {:.2f}", hw.Ipc());
+        for (std::size_t i = 0; i < perf::EVENT_COUNT; ++i) {
+            if (hw.valid[i]) {
+                line += std::format(", {} {}", perf::EVENT_NAMES[i], hw.values[i]);
+            }
+        }
+    }
+    return line;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "mandelbrot_renderer.hpp"
+#include "work_stealing_pool.hpp"
+
+// Выбор пула потоков рендерера в программах (--pool static|ws): exec::static_thread_pool или
+// ws::WorkStealingPool с пакетной отправкой задач кадра
+
+enum class PoolKind : std::uint8_t {
+    STATIC = 0,
+    WORK_STEALING = 1,
+};
+
+[[nodiscard]] constexpr std::string_view PoolKindName(PoolKind kind) noexcept {
+    return kind == PoolKind::WORK_STEALING ? "ws" : "static";
+}
+
+[[nodiscard]] inline PoolKind ParsePoolKind(std::string_view name) {
+    if (name == "static") {
+        return PoolKind::STATIC;
+    }
+    if (name == "ws") {
+        return PoolKind::WORK_STEALING;
+    }
+    throw std::invalid_argument("--pool expects static or ws, got '" + std::string{name} + "'");
+}
+
+// Создаёт рендерер на выбранном пуле из threads потоков и вызывает f(renderer). Пул и рендерер живут до
+// возврата из f, поэтому всё, что ссылается на рендерер, должно создаваться внутри f.
+template <typename F>
+decltype(auto) WithRenderer(PoolKind kind, std::uint32_t threads, F &&f) {
+    if (kind == PoolKind::WORK_STEALING) {
+        ws::WorkStealingPool pool{threads};
+        BasicMandelbrotRenderer renderer{pool.GetScheduler(), threads};
+        return std::forward<F>(f)(renderer);
+    }
+    MandelbrotRenderer renderer{threads};
+    return std::forward<F>(f)(renderer);
+}
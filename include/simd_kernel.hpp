@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "mandelbrot_fractal_utils.hpp"
+
+// Векторные ядра итераций на векторных расширениях GCC/Clang: SIMD_LANES точек double в одном векторе,
+// который компилятор раскладывает на регистры целевого набора инструкций (SSE2, AVX2, AVX-512).
+// Формулы повторяют скалярное CalculateIterationsForPoint операция в операцию, поэтому итерации совпадают
+// с ним бит в бит.
+//
+// Группа из SIMD_LANES соседних точек считается, пока не убежит самая медленная, и у границы множества
+// большинство дорожек простаивает. Потоковое ядро держит очередь точек строки: дорожка, чья точка убежала
+// или дошла до предела, сразу берёт следующую, так что дорожки простаивают только в хвосте строки.
+
+namespace mandelbrot::simd {
+
+inline constexpr std::size_t SIMD_LANES = 4;
+
+using VecD = double __attribute__((vector_size(SIMD_LANES * sizeof(double))));
+using VecI = std::int64_t __attribute__((vector_size(SIMD_LANES * sizeof(std::int64_t))));
+
+// Загрузка дорожек: сколько шагов итерации сделано и сколько из них пришлось на дорожки с точкой
+struct LaneStats {
+    std::uint64_t lane_steps{};
+    std::uint64_t active_lane_steps{};
+
+    [[nodiscard]] double Utilization() const noexcept {
+        return lane_steps == 0 ? 0.0 : static_cast<double>(active_lane_steps) / static_cast<double>(lane_steps);
+    }
+
+    LaneStats &operator+=(const LaneStats &other) noexcept {
+        lane_steps += other.lane_steps;
+        active_lane_steps += other.active_lane_steps;
+        return *this;
+    }
+};
+
+namespace detail {
+
+[[nodiscard]] inline bool AnyLane(const VecI &mask) noexcept {
+    std::int64_t any = 0;
+    for (std::size_t lane = 0; lane < SIMD_LANES; ++lane) {
+        any |= mask[lane];
+    }
+    return any != 0;
+}
+
+[[nodiscard]] inline std::uint64_t CountLanes(const VecI &mask) noexcept {
+    std::uint64_t count = 0;
+    for (std::size_t lane = 0; lane < SIMD_LANES; ++lane) {
+        count += mask[lane] != 0;
+    }
+    return count;
+}
+
+}  // namespace detail
+
+// Итерации точек строки row в столбцах [start_col, end_col) группами по SIMD_LANES; out[i] — столбец start_col + i
+inline void ComputeRowFixed(const ViewPort &viewport, std::uint32_t screen_width, std::uint32_t screen_height,
+                            std::uint32_t row, std::uint32_t start_col, std::uint32_t end_col,
+                            std::uint32_t max_iterations, double escape_radius, std::uint32_t *out,
+                            LaneStats *stats = nullptr) noexcept {
+    const double escape_radius_squared = escape_radius * escape_radius;
+    const auto max_it = VecI{} + static_cast<std::int64_t>(max_iterations);
+
+    for (std::uint32_t base = start_col; base < end_col; base += SIMD_LANES) {
+        VecD cr{};
+        VecD ci{};
+        VecI alive{};
+        for (std::size_t lane = 0; lane < SIMD_LANES; ++lane) {
+            if (base + lane < end_col) {
+                const auto c = Pixel2DToComplex(base + static_cast<std::uint32_t>(lane), row, viewport, screen_width,
+                                                screen_height);
+                cr[lane] = c.real();
+                ci[lane] = c.imag();
+                alive[lane] = -1;
+            }
+        }
+
+        VecD zr{};
+        VecD zi{};
+        VecI iter{};
+        VecI result{};
+        for (;;) {
+            const VecD zr2 = zr * zr;
+            const VecD zi2 = zi * zi;
+            const VecI done = alive & ((zr2 + zi2 > escape_radius_squared) | (iter >= max_it));
+            result = (result & ~done) | (iter & done);
+            alive &= ~done;
+            if (!detail::AnyLane(alive)) {
+                break;
+            }
+            if (stats != nullptr) {
+                stats->lane_steps += SIMD_LANES;
+                stats->active_lane_steps += detail::CountLanes(alive);
+            }
+            // Как z * z + c у std::complex: (x*x - y*y, x*y + y*x) и затем сложение с c
+            zi = (zr * zi + zi * zr) + ci;
+            zr = (zr2 - zi2) + cr;
+            iter += 1;
+        }
+
+        for (std::size_t lane = 0; lane < SIMD_LANES && base + lane < end_col; ++lane) {
+            out[base - start_col + lane] = static_cast<std::uint32_t>(result[lane]);
+        }
+    }
+}
+
+// То же, но дорожка, закончившая точку, сразу берёт следующую точку строки
+inline void ComputeRowStreaming(const ViewPort &viewport, std::uint32_t screen_width, std::uint32_t screen_height,
+                                std::uint32_t row, std::uint32_t start_col, std::uint32_t end_col,
+                                std::uint32_t max_iterations, double escape_radius, std::uint32_t *out,
+                                LaneStats *stats = nullptr) noexcept {
+    const double escape_radius_squared = escape_radius * escape_radius;
+    const auto max_it = VecI{} + static_cast<std::int64_t>(max_iterations);
+    // Свободная дорожка считает точку 0 с числом итераций, которое никогда не дойдёт до предела
+    constexpr std::int64_t IDLE = std::numeric_limits<std::int64_t>::min() / 2;
+    constexpr std::uint32_t NO_PIXEL = std::numeric_limits<std::uint32_t>::max();
+
+    VecD zr{};
+    VecD zi{};
+    VecD cr{};
+    VecD ci{};
+    VecI iter{};
+    std::array<std::uint32_t, SIMD_LANES> column{};
+    std::uint32_t next = start_col;
+    std::size_t active = 0;
+
+    // Кладёт в дорожку следующую точку очереди; false — очередь пуста и дорожка освобождена
+    auto refill = [&](std::size_t lane) {
+        zr[lane] = 0.0;
+        zi[lane] = 0.0;
+        if (next >= end_col) {
+            cr[lane] = 0.0;
+            ci[lane] = 0.0;
+            iter[lane] = IDLE;
+            column[lane] = NO_PIXEL;
+            return false;
+        }
+        const auto c = Pixel2DToComplex(next, row, viewport, screen_width, screen_height);
+        cr[lane] = c.real();
+        ci[lane] = c.imag();
+        iter[lane] = 0;
+        column[lane] = next++;
+        return true;
+    };
+    for (std::size_t lane = 0; lane < SIMD_LANES; ++lane) {
+        active += refill(lane);
+    }
+
+    while (active > 0) {
+        const VecD zr2 = zr * zr;
+        const VecD zi2 = zi * zi;
+        const VecI done = (zr2 + zi2 > escape_radius_squared) | (iter >= max_it);
+        if (detail::AnyLane(done)) {
+            for (std::size_t lane = 0; lane < SIMD_LANES; ++lane) {
+                if (done[lane] != 0) {
+                    out[column[lane] - start_col] = static_cast<std::uint32_t>(iter[lane]);
+                    active -= !refill(lane);
+                }
+            }
+            // Квадраты новых точек ещё не посчитаны
+            continue;
+        }
+        if (stats != nullptr) {
+            stats->lane_steps += SIMD_LANES;
+            stats->active_lane_steps += active;
+        }
+        zi = (zr * zi + zi * zr) + ci;
+        zr = (zr2 - zi2) + cr;
+        iter += 1;
+    }
+}
+
+}  // namespace mandelbrot::simd
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Ограниченная lock-free очередь на кольцевом буфере (схема Д. Вьюкова).
+// Каждая ячейка хранит номер хода, по которому производители и потребители договариваются
+// о владении ячейкой без блокировок; безопасна для нескольких производителей и потребителей.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : mask_{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1}, cells_{new Cell[mask_ + 1]} {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // Значение перемещается только при успешной вставке
+    [[nodiscard]] bool TryPush(T &&value) {
+        auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto &cell = cells_[pos & mask_];
+            const auto seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] std::optional<T> TryPop() {
+        auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto &cell = cells_[pos & mask_];
+            const auto seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> result{std::move(*cell.value)};
+                    cell.value.reset();
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return result;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t Capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        std::optional<T> value;
+    };
+
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(CACHE_LINE) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(CACHE_LINE) std::atomic<std::size_t> dequeue_pos_{0};
+};
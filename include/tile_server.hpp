@@ -0,0 +1,515 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <format>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+#include "frame_pacer.hpp"
+#include "image_writer.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "net_utils.hpp"
+#include "types.hpp"
+
+// Локальный HTTP сервер тайлов в схеме XYZ (/z/x/y.png), как у веб-карт. Уровень z делит квадрат
+// [-2.5, 1.5] x [-2, 2] на 2^z x 2^z тайлов. Порядок обработки запроса: кэш готовых PNG, затем ожидание
+// уже идущего рендера того же тайла, и только потом новый рендер с ограничением числа одновременных.
+
+namespace tiles {
+
+inline constexpr std::uint32_t TILE_SIZE = 256;
+// x и y пакуются в ключ по 29 бит
+inline constexpr std::uint32_t MAX_ZOOM = 29;
+
+struct TileKey {
+    std::uint32_t z{};
+    std::uint32_t x{};
+    std::uint32_t y{};
+
+    bool operator==(const TileKey &) const = default;
+};
+
+struct TileKeyHash {
+    std::size_t operator()(const TileKey &key) const noexcept {
+        return std::hash<std::uint64_t>{}((static_cast<std::uint64_t>(key.z) << 58) ^
+                                          (static_cast<std::uint64_t>(key.x) << 29) ^ key.y);
+    }
+};
+
+[[nodiscard]] inline mandelbrot::ViewPort TileViewport(const TileKey &key) noexcept {
+    const mandelbrot::ViewPort world;
+    const double size = world.width() / static_cast<double>(1ull << key.z);
+    const double x_min = world.x_min + key.x * size;
+    const double y_min = world.y_min + key.y * size;
+    return {x_min, x_min + size, y_min, y_min + size};
+}
+
+// Разбирает путь вида /z/x/y.png; пустой результат — путь не похож на тайл
+[[nodiscard]] inline std::optional<TileKey> ParseTilePath(std::string_view path) {
+    constexpr std::string_view SUFFIX = ".png";
+    if (!path.starts_with('/') || !path.ends_with(SUFFIX)) {
+        return std::nullopt;
+    }
+    path = path.substr(1, path.size() - 1 - SUFFIX.size());
+
+    std::uint32_t parts[3]{};
+    for (std::size_t i = 0; i < 3; ++i) {
+        const auto slash = path.find('/');
+        if ((slash == std::string_view::npos) != (i == 2)) {
+            return std::nullopt;
+        }
+        const auto part = path.substr(0, slash);
+        const auto [ptr, ec] = std::from_chars(part.data(), part.data() + part.size(), parts[i]);
+        if (part.empty() || ec != std::errc{} || ptr != part.data() + part.size()) {
+            return std::nullopt;
+        }
+        path.remove_prefix(slash == std::string_view::npos ? path.size() : slash + 1);
+    }
+
+    const TileKey key{parts[0], parts[1], parts[2]};
+    if (key.z > MAX_ZOOM || key.x >= (1u << key.z) || key.y >= (1u << key.z)) {
+        return std::nullopt;
+    }
+    return key;
+}
+
+// Сравнение ASCII строк без учёта регистра: имена заголовков HTTP и их токены регистронезависимы
+[[nodiscard]] constexpr bool EqualsIgnoreCase(std::string_view a, std::string_view b) noexcept {
+    auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+    return std::ranges::equal(a, b, {}, lower, lower);
+}
+
+[[nodiscard]] constexpr std::string_view TrimSpaces(std::string_view text) noexcept {
+    const auto begin = text.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+// Просит ли клиент закрыть соединение: заголовок Connection (в любом регистре) содержит токен close.
+// request — строка запроса и заголовки до пустой строки.
+[[nodiscard]] constexpr bool RequestsClose(std::string_view request) noexcept {
+    auto pos = request.find("\r\n");
+    while (pos != std::string_view::npos) {
+        request.remove_prefix(pos + 2);
+        pos = request.find("\r\n");
+        const auto line = request.substr(0, pos);
+        const auto colon = line.find(':');
+        if (colon == std::string_view::npos || !EqualsIgnoreCase(TrimSpaces(line.substr(0, colon)), "Connection")) {
+            continue;
+        }
+        auto value = line.substr(colon + 1);
+        while (!value.empty()) {
+            const auto comma = value.find(',');
+            if (EqualsIgnoreCase(TrimSpaces(value.substr(0, comma)), "close")) {
+                return true;
+            }
+            value.remove_prefix(comma == std::string_view::npos ? value.size() : comma + 1);
+        }
+    }
+    return false;
+}
+
+using TileData = std::shared_ptr<const std::string>;
+
+// LRU кэш готовых PNG
+class TileCache {
+public:
+    explicit TileCache(std::size_t capacity) : capacity_{capacity} {}
+
+    [[nodiscard]] TileData Get(const TileKey &key) {
+        std::lock_guard lock{mutex_};
+        const auto it = index_.find(key);
+        if (it == index_.end()) {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    void Put(const TileKey &key, TileData data) {
+        if (capacity_ == 0) {
+            return;
+        }
+        std::lock_guard lock{mutex_};
+        if (const auto it = index_.find(key); it != index_.end()) {
+            it->second->second = std::move(data);
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+        lru_.emplace_front(key, std::move(data));
+        index_.emplace(key, lru_.begin());
+        if (lru_.size() > capacity_) {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+    [[nodiscard]] std::size_t Size() const {
+        std::lock_guard lock{mutex_};
+        return lru_.size();
+    }
+
+private:
+    using Entry = std::pair<TileKey, TileData>;
+
+    const std::size_t capacity_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;
+    std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash> index_;
+};
+
+struct TileServiceOptions {
+    std::uint32_t max_iterations{500};
+    std::size_t cache_tiles{4096};
+    // Сколько тайлов может считаться одновременно; остальные запросы ждут
+    std::uint32_t max_renders_in_flight{THREAD_POOL_SIZE};
+    int compression_level{1};
+    // Окно текущей частоты запросов в статистике: более частые снимки возвращают последнюю посчитанную
+    std::chrono::milliseconds rate_window{1000};
+};
+
+struct TileServiceStats {
+    std::uint64_t requests{};
+    std::uint64_t cache_hits{};
+    // Запросы, дождавшиеся чужого рендера того же тайла
+    std::uint64_t coalesced{};
+    std::uint64_t renders{};
+    std::uint32_t peak_renders_in_flight{};
+    // Запросы в секунду за последнее окно rate_window между снимками статистики — текущая нагрузка
+    double tiles_per_second{};
+    // Запросы в секунду за всё время работы сервиса
+    double average_tiles_per_second{};
+    DurationSummary latency;
+};
+
+// Выдача тайлов без сети: кэш, склейка одинаковых запросов и ограничение параллельных рендеров
+template <typename Renderer>
+class BasicTileService {
+public:
+    BasicTileService(Renderer &renderer, TileServiceOptions options = {})
+        : renderer_{renderer},
+          options_{options},
+          cache_{options.cache_tiles},
+          render_slots_{std::max<std::ptrdiff_t>(options.max_renders_in_flight, 1)} {}
+
+    // Блокирует вызывающий поток до готовности тайла; ошибки рендера пробрасываются всем ожидающим
+    [[nodiscard]] TileData GetTile(const TileKey &key) {
+        const auto start = std::chrono::steady_clock::now();
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        auto data = Lookup(key);
+        latency_.Record(std::chrono::steady_clock::now() - start);
+        return data;
+    }
+
+    [[nodiscard]] TileServiceStats GetStats() {
+        const auto now = std::chrono::steady_clock::now();
+        const auto uptime = std::chrono::duration<double>(now - started_).count();
+        const auto requests = requests_.load(std::memory_order_relaxed);
+        return TileServiceStats{.requests = requests,
+                                .cache_hits = cache_hits_.load(std::memory_order_relaxed),
+                                .coalesced = coalesced_.load(std::memory_order_relaxed),
+                                .renders = renders_.load(std::memory_order_relaxed),
+                                .peak_renders_in_flight = peak_in_flight_.load(std::memory_order_relaxed),
+                                .tiles_per_second = SampleRate(now, requests),
+                                .average_tiles_per_second = uptime > 0 ? requests / uptime : 0.0,
+                                .latency = latency_.GetSummary()};
+    }
+
+private:
+    double SampleRate(std::chrono::steady_clock::time_point now, std::uint64_t requests) {
+        std::lock_guard lock{rate_mutex_};
+        const std::chrono::duration<double> elapsed = now - rate_window_start_;
+        const auto rate = elapsed.count() > 0 ? (requests - rate_window_requests_) / elapsed.count() : 0.0;
+        if (elapsed < options_.rate_window) {
+            // До первого полного окна отдаём частоту по неполному
+            return last_rate_.value_or(rate);
+        }
+        last_rate_ = rate;
+        rate_window_start_ = now;
+        rate_window_requests_ = requests;
+        return rate;
+    }
+
+    TileData Lookup(const TileKey &key) {
+        if (auto cached = cache_.Get(key)) {
+            cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            return cached;
+        }
+
+        std::promise<TileData> promise;
+        {
+            std::unique_lock lock{pending_mutex_};
+            // Повторная проверка под замком: рендер мог закончиться между Get и захватом замка
+            if (auto cached = cache_.Get(key)) {
+                cache_hits_.fetch_add(1, std::memory_order_relaxed);
+                return cached;
+            }
+            if (const auto it = pending_.find(key); it != pending_.end()) {
+                auto future = it->second;
+                lock.unlock();
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return future.get();
+            }
+            pending_.emplace(key, promise.get_future().share());
+        }
+
+        try {
+            auto data = Render(key);
+            cache_.Put(key, data);
+            promise.set_value(data);
+            Forget(key);
+            return data;
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            Forget(key);
+            throw;
+        }
+    }
+
+    TileData Render(const TileKey &key) {
+        render_slots_.acquire();
+        const auto in_flight = in_flight_.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto peak = peak_in_flight_.load(std::memory_order_relaxed);
+        while (peak < in_flight && !peak_in_flight_.compare_exchange_weak(peak, in_flight, std::memory_order_relaxed)) {
+        }
+
+        auto release = [this] {
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            render_slots_.release();
+        };
+        try {
+            const RenderSettings settings{.width = TILE_SIZE, .height = TILE_SIZE,
+                                          .max_iterations = options_.max_iterations};
+            auto result = DispatchLanes(renderer_.Concurrency(), [&]<std::size_t N>() {
+                return std::get<0>(
+                    stdexec::sync_wait(renderer_.template RenderAsync<N>(TileViewport(key), settings)).value());
+            });
+            release();
+            renders_.fetch_add(1, std::memory_order_relaxed);
+            return std::make_shared<const std::string>(
+                image::EncodePng(TILE_SIZE, TILE_SIZE, result.rgba_data, options_.compression_level));
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    void Forget(const TileKey &key) {
+        std::lock_guard lock{pending_mutex_};
+        pending_.erase(key);
+    }
+
+    Renderer &renderer_;
+    const TileServiceOptions options_;
+    TileCache cache_;
+    std::counting_semaphore<> render_slots_;
+
+    std::mutex pending_mutex_;
+    std::unordered_map<TileKey, std::shared_future<TileData>, TileKeyHash> pending_;
+
+    const std::chrono::steady_clock::time_point started_{std::chrono::steady_clock::now()};
+    std::atomic<std::uint64_t> requests_{0};
+    std::atomic<std::uint64_t> cache_hits_{0};
+    std::atomic<std::uint64_t> coalesced_{0};
+    std::atomic<std::uint64_t> renders_{0};
+    std::atomic<std::uint32_t> in_flight_{0};
+    std::atomic<std::uint32_t> peak_in_flight_{0};
+    LatencyHistogram latency_;
+
+    std::mutex rate_mutex_;
+    std::chrono::steady_clock::time_point rate_window_start_{started_};
+    std::uint64_t rate_window_requests_{0};
+    std::optional<double> last_rate_;
+};
+
+using TileService = BasicTileService<MandelbrotRenderer>;
+
+struct TileServerOptions {
+    std::string host{"127.0.0.1"};
+    // 0 — свободный порт, см. TileServer::Port
+    std::uint16_t port{8080};
+    // Потоки, обслуживающие соединения; ожидание рендера блокирует поток
+    std::uint32_t connection_threads{32};
+    TileServiceOptions service;
+};
+
+// HTTP/1.1 поверх TileService: GET /z/x/y.png и GET /stats (JSON), соединения keep-alive
+template <typename Renderer>
+class BasicTileServer {
+public:
+    BasicTileServer(Renderer &renderer, TileServerOptions options = {})
+        : options_{std::move(options)}, service_{renderer, options_.service} {}
+
+    BasicTileServer(const BasicTileServer &) = delete;
+    BasicTileServer &operator=(const BasicTileServer &) = delete;
+
+    ~BasicTileServer() { Stop(); }
+
+    void Start() {
+        listener_ = net::ListenTcp(options_.host, options_.port);
+        port_ = net::LocalPort(listener_);
+        stopping_ = false;
+        acceptor_ = std::thread{[this] { AcceptLoop(); }};
+        for (std::uint32_t i = 0; i < std::max(options_.connection_threads, 1u); ++i) {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    void Stop() {
+        if (!acceptor_.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+            for (auto *socket : active_) {
+                socket->Shutdown();
+            }
+        }
+        cv_.notify_all();
+        listener_.Shutdown();
+        acceptor_.join();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+        queue_.clear();
+        listener_.Close();
+    }
+
+    [[nodiscard]] std::uint16_t Port() const noexcept { return port_; }
+    [[nodiscard]] BasicTileService<Renderer> &Service() noexcept { return service_; }
+
+    [[nodiscard]] static std::string StatsJson(const TileServiceStats &stats) {
+        return std::format("{{\"requests\":{},\"cache_hits\":{},\"coalesced\":{},\"renders\":{},"
+                           "\"peak_renders_in_flight\":{},\"tiles_per_second\":{:.2f},"
+                           "\"average_tiles_per_second\":{:.2f},"
+                           "\"latency_us\":{{\"p50\":{},\"p99\":{},\"max\":{}}}}}",
+                           stats.requests, stats.cache_hits, stats.coalesced, stats.renders,
+                           stats.peak_renders_in_flight, stats.tiles_per_second, stats.average_tiles_per_second,
+                           stats.latency.p50.count(), stats.latency.p99.count(), stats.latency.max.count());
+    }
+
+private:
+    void AcceptLoop() {
+        for (;;) {
+            auto socket = net::Accept(listener_);
+            std::lock_guard lock{mutex_};
+            if (!socket.Valid() || stopping_) {
+                return;
+            }
+            queue_.push_back(std::move(socket));
+            cv_.notify_one();
+        }
+    }
+
+    void WorkerLoop() {
+        for (;;) {
+            net::Socket socket;
+            {
+                std::unique_lock lock{mutex_};
+                cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+                socket = std::move(queue_.front());
+                queue_.pop_front();
+                active_.push_back(&socket);
+            }
+            Serve(socket);
+            std::lock_guard lock{mutex_};
+            std::erase(active_, &socket);
+        }
+    }
+
+    // Обслуживает запросы одного соединения, пока клиент его не закроет
+    void Serve(const net::Socket &socket) {
+        constexpr std::size_t MAX_HEADER = 8192;
+        net::LineReader reader{socket};
+        for (;;) {
+            const auto request = reader.ReadUntil("\r\n\r\n", MAX_HEADER);
+            if (!request) {
+                return;
+            }
+            const auto line_end = request->find("\r\n");
+            const std::string_view line{request->data(), std::min(line_end, request->size())};
+            const auto method_end = line.find(' ');
+            const auto path_end = line.find(' ', method_end + 1);
+            if (method_end == std::string_view::npos || path_end == std::string_view::npos) {
+                (void)Respond(socket, "400 Bad Request", "text/plain", "Malformed request line\n", false);
+                return;
+            }
+            const auto method = line.substr(0, method_end);
+            const auto path = line.substr(method_end + 1, path_end - method_end - 1);
+            const bool keep_alive = !RequestsClose(*request);
+
+            bool sent = false;
+            if (method != "GET") {
+                sent = Respond(socket, "405 Method Not Allowed", "text/plain", "Only GET is supported\n", keep_alive);
+            } else if (path == "/stats") {
+                sent = Respond(socket, "200 OK", "application/json", StatsJson(service_.GetStats()) + "\n",
+                               keep_alive);
+            } else if (const auto key = ParseTilePath(path)) {
+                try {
+                    const auto tile = service_.GetTile(*key);
+                    sent = Respond(socket, "200 OK", "image/png", *tile, keep_alive);
+                } catch (const std::exception &e) {
+                    sent = Respond(socket, "500 Internal Server Error", "text/plain", std::string{e.what()} + "\n",
+                                   keep_alive);
+                }
+            } else {
+                sent = Respond(socket, "404 Not Found", "text/plain", "Expected /z/x/y.png or /stats\n", keep_alive);
+            }
+            if (!sent || !keep_alive) {
+                return;
+            }
+        }
+    }
+
+    static bool Respond(const net::Socket &socket, std::string_view status, std::string_view content_type,
+                        std::string_view body, bool keep_alive) {
+        const auto header = std::format("HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\n"
+                                        "Access-Control-Allow-Origin: *\r\nConnection: {}\r\n\r\n",
+                                        status, content_type, body.size(), keep_alive ? "keep-alive" : "close");
+        return net::SendAll(socket, header) && net::SendAll(socket, body);
+    }
+
+    const TileServerOptions options_;
+    BasicTileService<Renderer> service_;
+
+    net::Socket listener_;
+    std::uint16_t port_{0};
+    std::thread acceptor_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<net::Socket> queue_;
+    // Соединения в обработке: при остановке их нужно прервать
+    std::vector<const net::Socket *> active_;
+    bool stopping_{false};
+};
+
+using TileServer = BasicTileServer<MandelbrotRenderer>;
+
+}  // namespace tiles
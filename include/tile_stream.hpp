@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+#include "mandelbrot_renderer.hpp"
+#include "render_stats.hpp"
+#include "tile_queue.hpp"
+#include "types.hpp"
+
+// Связывает потоковый рендер на пуле с потоком интерфейса: исполнители кладут готовые полосы
+// в lock-free очередь, а поток интерфейса забирает их каждый кадр и сразу показывает.
+// Каждый перезапуск получает новое поколение — полосы устаревших кадров отбрасываются.
+// Число исполнителей равно параллелизму планировщика рендерера. По забранным полосам копится статистика
+// этапов кадра; Restart, Drain и TakeFrameStats вызываются из одного потока интерфейса.
+template <typename Renderer>
+class BasicTileStream {
+public:
+    static constexpr std::uint32_t TILE_ROWS = 16;
+    static constexpr std::size_t QUEUE_CAPACITY = 1024;
+
+    explicit BasicTileStream(Renderer &renderer, std::size_t queue_capacity = QUEUE_CAPACITY)
+        : renderer_{renderer}, lanes_{renderer.Concurrency()}, queue_{queue_capacity} {}
+
+    BasicTileStream(const BasicTileStream &) = delete;
+    BasicTileStream &operator=(const BasicTileStream &) = delete;
+
+    ~BasicTileStream() {
+        Cancel();
+        WaitIdle();
+    }
+
+    void Restart(mandelbrot::ViewPort viewport, RenderSettings settings) {
+        const auto generation = generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        frame_stats_ = RenderStats{};
+        frame_pixels_ = static_cast<std::uint64_t>(settings.width) * settings.height;
+        first_start_ = std::chrono::steady_clock::time_point::max();
+        last_computed_ = std::chrono::steady_clock::time_point::min();
+        frame_reported_ = false;
+
+        auto sink = [this, generation](RenderedTile &&tile) {
+            tile.generation = generation;
+            while (generation_.load(std::memory_order_acquire) == generation) {
+                if (queue_.TryPush(std::move(tile))) {
+                    return true;
+                }
+                // Очередь заполнена — поток интерфейса не успевает забирать полосы
+                std::this_thread::yield();
+            }
+            return false;
+        };
+
+        in_flight_.fetch_add(1, std::memory_order_acq_rel);
+        DispatchLanes(lanes_, [&]<std::size_t N>() {
+            stdexec::start_detached(renderer_.template StreamTilesAsync<N>(viewport, settings, TILE_ROWS, sink) |
+                                    stdexec::upon_error([](std::exception_ptr) noexcept {}) |
+                                    stdexec::then([this]() noexcept {
+                                        if (in_flight_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                                            in_flight_.notify_all();
+                                        }
+                                    }));
+        });
+    }
+
+    [[nodiscard]] std::uint32_t Lanes() const noexcept { return lanes_; }
+
+    void Cancel() noexcept { generation_.fetch_add(1, std::memory_order_acq_rel); }
+
+    // Забирает все накопившиеся полосы текущего поколения
+    [[nodiscard]] std::vector<RenderedTile> Drain() {
+        std::vector<RenderedTile> tiles;
+        const auto generation = generation_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < queue_.Capacity(); ++i) {
+            auto tile = queue_.TryPop();
+            if (!tile) {
+                break;
+            }
+            if (tile->generation == generation) {
+                AccountTile(*tile);
+                tiles.push_back(std::move(*tile));
+            }
+        }
+        return tiles;
+    }
+
+    // Статистика текущего кадра, когда все его полосы уже забраны через Drain; отдаётся один раз.
+    // compute — от начала первой полосы до конца расчёта последней, merge — суммарное время перевода
+    // полос в RGBA на всех потоках.
+    [[nodiscard]] std::optional<RenderStats> TakeFrameStats() {
+        if (frame_reported_ || frame_pixels_ == 0 || frame_stats_.pixels_computed < frame_pixels_) {
+            return std::nullopt;
+        }
+        frame_reported_ = true;
+        frame_stats_.compute = last_computed_ - first_start_;
+        return frame_stats_;
+    }
+
+    void WaitIdle() const noexcept {
+        auto n = in_flight_.load(std::memory_order_acquire);
+        while (n != 0) {
+            in_flight_.wait(n, std::memory_order_acquire);
+            n = in_flight_.load(std::memory_order_acquire);
+        }
+    }
+
+    [[nodiscard]] bool Idle() const noexcept { return in_flight_.load(std::memory_order_acquire) == 0; }
+
+private:
+    void AccountTile(const RenderedTile &tile) {
+        const auto &region = tile.region;
+        frame_stats_.pixels_computed +=
+            static_cast<std::uint64_t>(region.end_row - region.start_row) * (region.end_col - region.start_col);
+        frame_stats_.total_iterations += tile.iterations;
+        frame_stats_.merge += tile.end - tile.computed;
+        frame_stats_.worker_busy.push_back(tile.end - tile.start);
+        first_start_ = std::min(first_start_, tile.start);
+        last_computed_ = std::max(last_computed_, tile.computed);
+    }
+
+    Renderer &renderer_;
+    std::uint32_t lanes_;
+    BoundedQueue<RenderedTile> queue_;
+    std::atomic<std::uint64_t> generation_{0};
+    std::atomic<std::uint32_t> in_flight_{0};
+
+    RenderStats frame_stats_;
+    std::uint64_t frame_pixels_{};
+    std::chrono::steady_clock::time_point first_start_;
+    std::chrono::steady_clock::time_point last_computed_;
+    bool frame_reported_{false};
+};
+
+using TileStream = BasicTileStream<MandelbrotRenderer>;
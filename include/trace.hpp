@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Необязательная трассировка конвейера в формате Chrome trace (открывается в chrome://tracing и Perfetto).
+// Каждый поток пишет интервалы в собственный буфер без блокировок; общий мьютекс берётся только один раз
+// при регистрации потока и при выгрузке файла. Пока трассировка выключена, Span стоит одну relaxed-загрузку.
+
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+// Имена и категории — строковые литералы: буфер хранит только указатели
+struct Event {
+    const char *name{};
+    const char *category{};
+    Clock::time_point start;
+    Clock::time_point end;
+    const char *arg_name{};
+    std::int64_t arg_value{};
+};
+
+// Буфер одного потока фиксированной ёмкости. Пишет только поток-владелец, читатель видит события
+// до опубликованного счётчика. Переполненный буфер отбрасывает новые события и считает их.
+class ThreadBuffer {
+public:
+    ThreadBuffer(std::uint32_t tid, std::size_t capacity) : tid_{tid}, events_(capacity) {}
+
+    void Push(const Event &event) noexcept {
+        const auto n = size_.load(std::memory_order_relaxed);
+        if (n >= events_.size()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events_[n] = event;
+        size_.store(n + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] std::uint32_t Tid() const noexcept { return tid_; }
+    [[nodiscard]] std::size_t Size() const noexcept { return size_.load(std::memory_order_acquire); }
+    [[nodiscard]] const Event &At(std::size_t i) const noexcept { return events_[i]; }
+    [[nodiscard]] std::uint64_t Dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+    // Вызывается только когда запись остановлена
+    void Clear() noexcept {
+        size_.store(0, std::memory_order_release);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::uint32_t tid_;
+    std::vector<Event> events_;
+    std::atomic<std::size_t> size_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+};
+
+class Tracer {
+public:
+    static constexpr std::size_t EVENTS_PER_THREAD = 1 << 16;
+
+    [[nodiscard]] static Tracer &Instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    [[nodiscard]] bool Enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    void Enable() {
+        epoch_ = Clock::now();
+        enabled_.store(true, std::memory_order_release);
+    }
+    void Disable() noexcept { enabled_.store(false, std::memory_order_release); }
+
+    void Record(const Event &event) noexcept {
+        if (auto *buffer = LocalBuffer()) {
+            buffer->Push(event);
+        }
+    }
+
+    // Сбрасывает записанные события; трассировка при этом должна быть выключена
+    void Clear() {
+        std::lock_guard lock{mutex_};
+        for (auto &buffer : buffers_) {
+            buffer->Clear();
+        }
+    }
+
+    [[nodiscard]] std::size_t EventCount() const {
+        std::lock_guard lock{mutex_};
+        std::size_t total = 0;
+        for (const auto &buffer : buffers_) {
+            total += buffer->Size();
+        }
+        return total;
+    }
+
+    [[nodiscard]] std::uint64_t DroppedCount() const {
+        std::lock_guard lock{mutex_};
+        std::uint64_t total = 0;
+        for (const auto &buffer : buffers_) {
+            total += buffer->Dropped();
+        }
+        return total;
+    }
+
+    // JSON в формате Chrome trace: полные события ("ph":"X") с временем в микросекундах от Enable
+    void WriteJson(std::ostream &out) const {
+        std::lock_guard lock{mutex_};
+        const auto us = [this](Clock::time_point t) {
+            return std::chrono::duration<double, std::micro>(t - epoch_).count();
+        };
+
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out << std::fixed << std::setprecision(3) << R"({"displayTimeUnit":"ms","traceEvents":[)";
+        bool first = true;
+        auto separator = [&]() -> std::ostream & {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            return out;
+        };
+        for (const auto &buffer : buffers_) {
+            separator() << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->Tid()
+                        << R"(,"args":{"name":"thread )" << buffer->Tid() << R"("}})";
+            const auto size = buffer->Size();
+            for (std::size_t i = 0; i < size; ++i) {
+                const auto &event = buffer->At(i);
+                separator() << R"({"name":")" << event.name << R"(","cat":")" << event.category
+                            << R"(","ph":"X","pid":1,"tid":)" << buffer->Tid() << R"(,"ts":)" << us(event.start)
+                            << R"(,"dur":)" << std::max(us(event.end) - us(event.start), 0.0);
+                if (event.arg_name != nullptr) {
+                    out << R"(,"args":{")" << event.arg_name << R"(":)" << event.arg_value << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    void WriteJson(const std::filesystem::path &path) const {
+        std::ofstream file{path, std::ios::binary};
+        if (!file) {
+            throw std::runtime_error("Failed to open trace file: " + path.string());
+        }
+        WriteJson(file);
+    }
+
+private:
+    Tracer() = default;
+
+    // Буфер текущего потока создаётся при первой записи и живёт до конца программы,
+    // поэтому события завершившихся потоков пула тоже попадают в файл
+    ThreadBuffer *LocalBuffer() noexcept {
+        thread_local ThreadBuffer *local = nullptr;
+        if (local == nullptr) {
+            try {
+                std::lock_guard lock{mutex_};
+                buffers_.push_back(std::make_unique<ThreadBuffer>(static_cast<std::uint32_t>(buffers_.size() + 1),
+                                                                  EVENTS_PER_THREAD));
+                local = buffers_.back().get();
+            } catch (...) {
+                return nullptr;
+            }
+        }
+        return local;
+    }
+
+    std::atomic<bool> enabled_{false};
+    Clock::time_point epoch_{Clock::now()};
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+[[nodiscard]] inline bool Enabled() noexcept { return Tracer::Instance().Enabled(); }
+
+// Записывает уже измеренный интервал, например, засечённый на другом этапе конвейера
+inline void Record(const char *name, const char *category, Clock::time_point start, Clock::time_point end,
+                   const char *arg_name = nullptr, std::int64_t arg_value = 0) noexcept {
+    auto &tracer = Tracer::Instance();
+    if (tracer.Enabled()) {
+        tracer.Record(Event{name, category, start, end, arg_name, arg_value});
+    }
+}
+
+// Интервал от создания до уничтожения объекта
+class Span {
+public:
+    Span(const char *name, const char *category, const char *arg_name = nullptr, std::int64_t arg_value = 0) noexcept
+        : enabled_{Enabled()}, name_{name}, category_{category}, arg_name_{arg_name}, arg_value_{arg_value} {
+        if (enabled_) {
+            start_ = Clock::now();
+        }
+    }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+    ~Span() { End(); }
+
+    // Закрывает интервал раньше деструктора — например, перед set_value, после которого
+    // в том же потоке продолжается остальной конвейер
+    void End() noexcept {
+        if (enabled_) {
+            Tracer::Instance().Record(Event{name_, category_, start_, Clock::now(), arg_name_, arg_value_});
+            enabled_ = false;
+        }
+    }
+
+private:
+    bool enabled_;
+    const char *name_;
+    const char *category_;
+    const char *arg_name_;
+    std::int64_t arg_value_;
+    Clock::time_point start_;
+};
+
+}  // namespace trace
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <vector>
 
 #include "mandelbrot_fractal_utils.hpp"
+#include "render_stats.hpp"
 
 const constexpr std::uint32_t THREAD_POOL_SIZE{8};
 
@@ -15,6 +17,14 @@ struct RenderSettings {
     std::uint32_t height{600};
     std::uint32_t max_iterations{100};
     double escape_radius{2.0};
+    // Адаптивное сглаживание: сколько дополнительных сэмплов получает пиксель на границе (0 — выключено)
+    std::uint32_t aa_samples{0};
+    // Пиксель считается граничным, если итерации соседа отличаются больше чем на этот порог
+    std::uint32_t aa_threshold{1};
+    mandelbrot::Kernel kernel{mandelbrot::Kernel::SCALAR};
+    // Какие каналы хранит кадр. Ядро считает итерации всегда, но pixel_data и rgba_data выделяются
+    // только с ITERATIONS; сглаживанию тоже нужен этот канал
+    mandelbrot::ChannelMask channels{mandelbrot::Channels::ITERATIONS};
 };
 
 struct PixelRegion {
@@ -24,18 +34,133 @@ struct PixelRegion {
     std::uint32_t end_col{};
 };
 
+// Непрерывный буфер кадра в формате RGBA8, строки подряд без выравнивания
+using RgbaBuffer = std::vector<std::uint8_t>;
+
+inline constexpr std::size_t RGBA_CHANNELS = 4;
+
+// Дополнительные каналы ядра, строки подряд без выравнивания. Буферы выделяются только под выбранные каналы,
+// остальные остаются пустыми.
+struct ChannelBuffers {
+    std::vector<double> smooth;
+    std::vector<double> distance;
+    std::vector<mandelbrot::Complex> final_z;
+    std::vector<double> orbit_trap;
+
+    void Allocate(mandelbrot::ChannelMask channels, std::size_t pixels) {
+        using mandelbrot::Channels;
+        smooth.resize((channels & Channels::SMOOTH) != 0 ? pixels : 0);
+        distance.resize((channels & Channels::DISTANCE) != 0 ? pixels : 0);
+        final_z.resize((channels & Channels::FINAL_Z) != 0 ? pixels : 0);
+        orbit_trap.resize((channels & Channels::ORBIT_TRAP) != 0 ? pixels : 0);
+    }
+
+    // Запись значений точки; проверки каналов разрешаются при компиляции
+    template <mandelbrot::ChannelMask CHANNELS>
+    void Store(std::size_t index, const mandelbrot::PointChannels &point) noexcept {
+        using mandelbrot::Channels;
+        if constexpr ((CHANNELS & Channels::SMOOTH) != 0) {
+            smooth[index] = point.smooth;
+        }
+        if constexpr ((CHANNELS & Channels::DISTANCE) != 0) {
+            distance[index] = point.distance;
+        }
+        if constexpr ((CHANNELS & Channels::FINAL_Z) != 0) {
+            final_z[index] = point.final_z;
+        }
+        if constexpr ((CHANNELS & Channels::ORBIT_TRAP) != 0) {
+            orbit_trap[index] = point.orbit_trap;
+        }
+    }
+
+    // Копирует count значений всех выделенных каналов из src[src_index] в this[dst_index]
+    void CopyFrom(const ChannelBuffers &src, std::size_t src_index, std::size_t dst_index, std::size_t count) {
+        auto copy = [&](const auto &from, auto &to) {
+            if (!from.empty() && !to.empty()) {
+                std::copy_n(from.begin() + src_index, count, to.begin() + dst_index);
+            }
+        };
+        copy(src.smooth, smooth);
+        copy(src.distance, distance);
+        copy(src.final_z, final_z);
+        copy(src.orbit_trap, orbit_trap);
+    }
+};
+
+// Готовый фрагмент кадра, который можно показать до завершения всего кадра
+struct RenderedTile {
+    PixelRegion region;
+    RgbaBuffer rgba;
+    std::uint64_t generation{};
+    // Сумма итераций по пикселям фрагмента
+    std::uint64_t iterations{};
+    // Начало вычисления на пуле, конец расчёта итераций и конец перевода в RGBA
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point computed;
+    std::chrono::steady_clock::time_point end;
+};
+
 struct RenderResult {
     PixelMatrix pixel_data;
-    ColorMatrix color_data;
+    // Цвета кадра хранятся только в RGBA; двумерную матрицу при необходимости даёт UnpackRgbaToColors
+    RgbaBuffer rgba_data;
+    // Каналы из settings.channels помимо итераций, по пикселю кадра
+    ChannelBuffers channels;
+    // Изменившиеся области кадра; пустой список означает, что обновился весь кадр
+    std::vector<PixelRegion> dirty_regions;
+    // Фрагменты потокового рендера, каждый со своим буфером
+    std::vector<RenderedTile> tiles;
     mandelbrot::ViewPort viewport;
     RenderSettings settings;
+    // Время от запуска вычисления до готового кадра
     std::chrono::milliseconds render_time{};
+    // Сколько пикселей получили дополнительные сэмплы сглаживания
+    std::uint32_t aa_pixels{};
+    RenderStats stats;
 };
 
+inline void StoreRgba(std::uint8_t *dst, mandelbrot::RgbColor color) noexcept {
+    dst[0] = color.r;
+    dst[1] = color.g;
+    dst[2] = color.b;
+    dst[3] = 255;
+}
+
+[[nodiscard]] inline mandelbrot::RgbColor LoadRgba(const std::uint8_t *src) noexcept {
+    return mandelbrot::RgbColor{src[0], src[1], src[2]};
+}
+
+// Упаковывает двумерную матрицу цветов в непрерывный RGBA буфер
+inline void PackColorsToRgba(const ColorMatrix &colors, std::uint32_t width, std::uint32_t height, RgbaBuffer &out) {
+    out.resize(static_cast<std::size_t>(width) * height * RGBA_CHANNELS);
+    auto *dst = out.data();
+    for (std::uint32_t r = 0; r < height; ++r) {
+        const auto &row = colors[r];
+        for (std::uint32_t c = 0; c < width; ++c, dst += RGBA_CHANNELS) {
+            StoreRgba(dst, row[c]);
+        }
+    }
+}
+
+// Обратное преобразование: собирает матрицу цветов из RGBA буфера для тех, кому нужен доступ по [y][x]
+[[nodiscard]] inline ColorMatrix UnpackRgbaToColors(const RgbaBuffer &rgba, std::uint32_t width,
+                                                     std::uint32_t height) {
+    ColorMatrix colors(height, std::vector<mandelbrot::RgbColor>(width));
+    const auto *src = rgba.data();
+    for (std::uint32_t r = 0; r < height; ++r) {
+        for (std::uint32_t c = 0; c < width; ++c, src += RGBA_CHANNELS) {
+            colors[r][c] = LoadRgba(src);
+        }
+    }
+    return colors;
+}
+
 struct AppState {
     mandelbrot::ViewPort viewport;
     bool need_rerender{true};
     bool left_mouse_pressed{false};
     bool right_mouse_pressed{false};
     bool should_exit{false};
+    // Экранная панель производительности, переключается клавишей F1
+    bool show_hud{false};
 };
@@ -0,0 +1,556 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+// Пул потоков с перехватом работы для мелких задач рендера (тайлов 16x16 и т. п.).
+//
+// У каждого потока своя дека Чейза — Лева: задачи, запущенные с потока пула, кладутся в его деку и снимаются
+// с того же конца, остальные потоки крадут с противоположного конца у случайной жертвы. Задачи извне пула
+// попадают в общую очередь; поток, взявший оттуда задачу, переносит в свою деку ещё часть очереди, чтобы
+// её могли украсть остальные. Поток без работы немного крутится, пытаясь украсть, и только потом засыпает.
+//
+// Будится не больше одного потока за раз: пока кто-то ищет работу, новые задачи никого не будят, а поток,
+// нашедший работу последним из ищущих, будит следующего. Задачи, отправленные внутри BatchScope (например,
+// все тайлы кадра), стоят отправителю одного пробуждения на всю пачку. Scheduler::Batched оборачивает sender
+// так, что его запуск целиком идёт внутри BatchScope — этим пользуется рендерер.
+
+namespace ws {
+
+// Задача пула: операция stdexec, которая знает, как себя выполнить
+struct Task {
+    void (*execute)(Task *) noexcept;
+};
+
+// Дека Чейза — Лева (в варианте Lê и др. для модели памяти C11). Push и Pop вызывает только владелец,
+// Steal — любой поток. Буфер растёт вдвое; старые буферы живут до разрушения деки, потому что вор мог
+// успеть прочитать указатель на них.
+template <typename T>
+class ChaseLevDeque {
+private:
+    struct Buffer {
+        std::int64_t capacity;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit Buffer(std::int64_t size)
+            : capacity{size}, items{std::make_unique<std::atomic<T>[]>(static_cast<std::size_t>(size))} {}
+
+        [[nodiscard]] T Get(std::int64_t index) const noexcept {
+            return items[static_cast<std::size_t>(index & (capacity - 1))].load(std::memory_order_relaxed);
+        }
+        void Put(std::int64_t index, T value) noexcept {
+            items[static_cast<std::size_t>(index & (capacity - 1))].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<Buffer *> buffer_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+
+public:
+    inline static constexpr std::int64_t INITIAL_CAPACITY = 256;
+
+    ChaseLevDeque() {
+        buffers_.push_back(std::make_unique<Buffer>(INITIAL_CAPACITY));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque &) = delete;
+    ChaseLevDeque &operator=(const ChaseLevDeque &) = delete;
+
+    void Push(T value) {
+        const auto bottom = bottom_.load(std::memory_order_relaxed);
+        const auto top = top_.load(std::memory_order_acquire);
+        auto *buffer = buffer_.load(std::memory_order_relaxed);
+        if (bottom - top > buffer->capacity - 1) {
+            auto grown = std::make_unique<Buffer>(buffer->capacity * 2);
+            for (auto i = top; i < bottom; ++i) {
+                grown->Put(i, buffer->Get(i));
+            }
+            buffer = grown.get();
+            buffers_.push_back(std::move(grown));
+            buffer_.store(buffer, std::memory_order_release);
+        }
+        buffer->Put(bottom, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Последний положенный элемент; false — дека пуста
+    bool Pop(T &out) noexcept {
+        const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        auto *buffer = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+
+        bool taken = false;
+        if (top <= bottom) {
+            out = buffer->Get(bottom);
+            taken = true;
+            if (top == bottom) {
+                // Последний элемент: соревнуемся с ворами
+                taken = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                     std::memory_order_relaxed);
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return taken;
+    }
+
+    // Самый старый элемент; false — дека пуста или элемент перехватил другой поток
+    bool Steal(T &out) noexcept {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        const auto *buffer = buffer_.load(std::memory_order_acquire);
+        out = buffer->Get(top);
+        return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::int64_t SizeApprox() const noexcept {
+        return std::max<std::int64_t>(bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed),
+                                      0);
+    }
+};
+
+// Счётчики пула с момента создания
+struct PoolStats {
+    // Пробуждения от отправителей задач и цепочкой от потоков, нашедших работу
+    std::uint64_t submit_wakeups{};
+    std::uint64_t chain_wakeups{};
+    std::uint64_t steals{};
+    std::uint64_t parks{};
+    // Задачи, перенесённые из общей очереди в деки потоков
+    std::uint64_t transferred{};
+};
+
+class WorkStealingPool {
+public:
+    class Scheduler;
+
+private:
+    struct Worker {
+        ChaseLevDeque<Task *> deque;
+        // xorshift для выбора жертвы
+        std::uint64_t random_state{};
+        std::thread thread;
+    };
+
+    struct WorkerContext {
+        WorkStealingPool *pool{};
+        std::size_t index{};
+        // Открытые на этом потоке BatchScope и отложенное ими пробуждение
+        WorkStealingPool *batch_pool{};
+        std::uint32_t batch_depth{};
+        bool batch_pending{};
+    };
+
+    inline static constexpr std::uint32_t SPIN_ROUNDS = 64;
+    // Больше задач за раз из общей очереди в деку не переносится
+    inline static constexpr std::size_t INJECT_BATCH = 32;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex inject_mutex_;
+    std::deque<Task *> injected_;
+
+    // Задачи во всех очередях; ищущие и спящие потоки. Пробуждение и засыпание согласуются через эти
+    // счётчики (seq_cst с обеих сторон), поэтому задача не может остаться без потока.
+    std::atomic<std::int64_t> queued_{0};
+    std::atomic<std::uint32_t> searching_{0};
+    std::atomic<std::uint32_t> sleeping_{0};
+
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::uint32_t wake_tokens_{};
+    bool stop_{false};
+
+    std::atomic<std::uint64_t> submit_wakeups_{0};
+    std::atomic<std::uint64_t> chain_wakeups_{0};
+    std::atomic<std::uint64_t> steals_{0};
+    std::atomic<std::uint64_t> parks_{0};
+    std::atomic<std::uint64_t> transferred_{0};
+
+    static WorkerContext &CurrentWorker() noexcept {
+        static thread_local WorkerContext context;
+        return context;
+    }
+
+    static void Pause() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // Будит один спящий поток и сразу записывает его в ищущие, чтобы следующие задачи никого не будили
+    bool WakeOne() {
+        std::lock_guard lock{park_mutex_};
+        if (sleeping_.load(std::memory_order_seq_cst) <= wake_tokens_) {
+            return false;
+        }
+        ++wake_tokens_;
+        searching_.fetch_add(1, std::memory_order_seq_cst);
+        park_cv_.notify_one();
+        return true;
+    }
+
+    // Будит поток, если задачу некому подхватить: никто не ищет работу, а спящие есть
+    void WakeForSubmit() {
+        if (searching_.load(std::memory_order_seq_cst) == 0 && sleeping_.load(std::memory_order_seq_cst) > 0 &&
+            WakeOne()) {
+            submit_wakeups_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Берёт задачу из общей очереди и переносит в деку потока self свою долю оставшихся (не больше
+    // INJECT_BATCH): из деки их могут украсть другие потоки, а общий замок берётся реже
+    Task *TakeInjected(std::size_t self) {
+        std::array<Task *, INJECT_BATCH> batch;
+        std::size_t count = 0;
+        Task *task = nullptr;
+        {
+            std::lock_guard lock{inject_mutex_};
+            if (injected_.empty()) {
+                return nullptr;
+            }
+            task = injected_.front();
+            injected_.pop_front();
+            count = std::min({injected_.size() / workers_.size() + 1, injected_.size(), INJECT_BATCH});
+            std::copy_n(injected_.begin(), count, batch.begin());
+            injected_.erase(injected_.begin(), injected_.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+        auto &deque = workers_[self]->deque;
+        for (std::size_t i = 0; i < count; ++i) {
+            deque.Push(batch[i]);
+        }
+        if (count > 0) {
+            transferred_.fetch_add(count, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task *FindTask(std::size_t self) {
+        auto &worker = *workers_[self];
+        Task *task = nullptr;
+        if (worker.deque.Pop(task)) {
+            return task;
+        }
+        if (queued_.load(std::memory_order_relaxed) <= 0) {
+            return nullptr;
+        }
+        if ((task = TakeInjected(self)) != nullptr) {
+            return task;
+        }
+        // Жертвы по кругу от случайной
+        auto &state = worker.random_state;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const auto count = workers_.size();
+        const auto start = static_cast<std::size_t>(state % count);
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto victim = (start + i) % count;
+            if (victim != self && workers_[victim]->deque.Steal(task)) {
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void Run(std::size_t self) {
+        CurrentWorker().pool = this;
+        CurrentWorker().index = self;
+        bool searching = true;
+
+        for (;;) {
+            Task *task = FindTask(self);
+            for (std::uint32_t spin = 0; task == nullptr && spin < SPIN_ROUNDS; ++spin) {
+                Pause();
+                task = FindTask(self);
+            }
+
+            if (task != nullptr) {
+                queued_.fetch_sub(1, std::memory_order_seq_cst);
+                if (searching) {
+                    searching = false;
+                    // Последний ищущий нашёл работу: если есть ещё, её подхватит следующий поток
+                    if (searching_.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+                        queued_.load(std::memory_order_seq_cst) > 0 && WakeOne()) {
+                        chain_wakeups_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                task->execute(task);
+                continue;
+            }
+
+            if (!searching) {
+                searching = true;
+                searching_.fetch_add(1, std::memory_order_seq_cst);
+                continue;
+            }
+
+            std::unique_lock lock{park_mutex_};
+            searching_.fetch_sub(1, std::memory_order_seq_cst);
+            sleeping_.fetch_add(1, std::memory_order_seq_cst);
+            if (queued_.load(std::memory_order_seq_cst) > 0 && !stop_) {
+                sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+                searching_.fetch_add(1, std::memory_order_seq_cst);
+                continue;
+            }
+            parks_.fetch_add(1, std::memory_order_relaxed);
+            park_cv_.wait(lock, [this] { return wake_tokens_ > 0 || stop_; });
+            sleeping_.fetch_sub(1, std::memory_order_seq_cst);
+            if (wake_tokens_ > 0) {
+                // searching_ уже увеличил тот, кто будил
+                --wake_tokens_;
+            } else {
+                searching_.fetch_add(1, std::memory_order_seq_cst);
+            }
+            if (stop_) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(std::uint32_t num_threads = std::thread::hardware_concurrency()) {
+        num_threads = std::max(num_threads, 1u);
+        searching_.store(num_threads, std::memory_order_relaxed);
+        for (std::uint32_t i = 0; i < num_threads; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+            workers_.back()->random_state = 0x9E3779B97F4A7C15ull * (i + 1);
+        }
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread{[this, i] { Run(i); }};
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Задачи, не успевшие выполниться, отбрасываются, как и у exec::static_thread_pool
+    ~WorkStealingPool() {
+        {
+            std::lock_guard lock{park_mutex_};
+            stop_ = true;
+        }
+        park_cv_.notify_all();
+        for (auto &worker : workers_) {
+            worker->thread.join();
+        }
+    }
+
+    // Пачка отправок с текущего потока: задачи сразу попадают в очереди, а пробуждение откладывается
+    // до закрытия внешнего BatchScope
+    class BatchScope {
+    private:
+        WorkStealingPool &pool_;
+
+    public:
+        explicit BatchScope(WorkStealingPool &pool) : pool_{pool} {
+            auto &context = CurrentWorker();
+            if (context.batch_depth++ == 0) {
+                context.batch_pool = &pool_;
+                context.batch_pending = false;
+            }
+        }
+
+        BatchScope(const BatchScope &) = delete;
+        BatchScope &operator=(const BatchScope &) = delete;
+
+        ~BatchScope() {
+            auto &context = CurrentWorker();
+            if (--context.batch_depth == 0) {
+                context.batch_pool = nullptr;
+                if (context.batch_pending) {
+                    pool_.WakeForSubmit();
+                }
+            }
+        }
+    };
+
+    // Ставит задачу в очередь: с потока пула — в его деку, иначе — в общую очередь
+    void Submit(Task *task) {
+        auto &context = CurrentWorker();
+        if (context.pool == this) {
+            workers_[context.index]->deque.Push(task);
+        } else {
+            std::lock_guard lock{inject_mutex_};
+            injected_.push_back(task);
+        }
+        queued_.fetch_add(1, std::memory_order_seq_cst);
+        if (context.batch_pool == this) {
+            context.batch_pending = true;
+            return;
+        }
+        WakeForSubmit();
+    }
+
+    [[nodiscard]] std::size_t ThreadCount() const noexcept { return workers_.size(); }
+
+    [[nodiscard]] std::uint32_t SleepingThreads() const noexcept { return sleeping_.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] PoolStats Stats() const noexcept {
+        return {submit_wakeups_.load(std::memory_order_relaxed), chain_wakeups_.load(std::memory_order_relaxed),
+                steals_.load(std::memory_order_relaxed), parks_.load(std::memory_order_relaxed),
+                transferred_.load(std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] Scheduler GetScheduler() noexcept;
+
+    template <typename Receiver>
+    class ScheduleOperation : private Task {
+    private:
+        WorkStealingPool *pool_;
+        Receiver receiver_;
+
+        static void Execute(Task *task) noexcept {
+            auto &self = *static_cast<ScheduleOperation *>(task);
+            if (stdexec::get_stop_token(stdexec::get_env(self.receiver_)).stop_requested()) {
+                stdexec::set_stopped(std::move(self.receiver_));
+            } else {
+                stdexec::set_value(std::move(self.receiver_));
+            }
+        }
+
+    public:
+        ScheduleOperation(WorkStealingPool *pool, Receiver receiver)
+            : Task{&Execute}, pool_{pool}, receiver_{std::move(receiver)} {}
+
+        ScheduleOperation(const ScheduleOperation &) = delete;
+        ScheduleOperation &operator=(const ScheduleOperation &) = delete;
+
+        void start() noexcept {
+            try {
+                pool_->Submit(this);
+            } catch (...) {
+                stdexec::set_error(std::move(receiver_), std::current_exception());
+            }
+        }
+    };
+
+    class ScheduleSender {
+    private:
+        WorkStealingPool *pool_;
+
+    public:
+        using sender_concept = stdexec::sender_t;
+
+        struct Env {
+            WorkStealingPool *pool;
+
+            template <typename CPO>
+            [[nodiscard]] auto query(stdexec::get_completion_scheduler_t<CPO>) const noexcept {
+                return pool->GetScheduler();
+            }
+        };
+
+        explicit ScheduleSender(WorkStealingPool *pool) noexcept : pool_{pool} {}
+
+        template <typename Receiver>
+        auto connect(Receiver &&receiver) const {
+            return ScheduleOperation<std::decay_t<Receiver>>(pool_, std::forward<Receiver>(receiver));
+        }
+
+        template <typename Env>
+        auto get_completion_signatures(Env &&) const {
+            return stdexec::completion_signatures<stdexec::set_value_t(), stdexec::set_error_t(std::exception_ptr),
+                                                  stdexec::set_stopped_t()>{};
+        }
+
+        [[nodiscard]] Env get_env() const noexcept { return Env{pool_}; }
+    };
+
+    // Запускает вложенную операцию внутри BatchScope. После запуска к себе не обращается: вложенная
+    // операция может завершиться и разрушить её на другом потоке до выхода из start.
+    template <typename InnerOperation>
+    class BatchOperation {
+    private:
+        WorkStealingPool *pool_;
+        InnerOperation inner_;
+
+    public:
+        template <typename Sender, typename Receiver>
+        BatchOperation(WorkStealingPool *pool, Sender &&sender, Receiver &&receiver)
+            : pool_{pool}, inner_{stdexec::connect(std::forward<Sender>(sender), std::forward<Receiver>(receiver))} {}
+
+        BatchOperation(const BatchOperation &) = delete;
+        BatchOperation &operator=(const BatchOperation &) = delete;
+
+        void start() noexcept {
+            const BatchScope batch{*pool_};
+            stdexec::start(inner_);
+        }
+    };
+
+    template <typename Inner>
+    class BatchSender {
+    private:
+        WorkStealingPool *pool_;
+        Inner inner_;
+
+    public:
+        using sender_concept = stdexec::sender_t;
+
+        BatchSender(WorkStealingPool *pool, Inner inner) : pool_{pool}, inner_{std::move(inner)} {}
+
+        template <typename Receiver>
+        auto connect(Receiver &&receiver) && {
+            return BatchOperation<stdexec::connect_result_t<Inner, std::decay_t<Receiver>>>{
+                pool_, std::move(inner_), std::forward<Receiver>(receiver)};
+        }
+
+        template <typename Env>
+        auto get_completion_signatures(Env &&) const {
+            return stdexec::completion_signatures_of_t<Inner, Env>{};
+        }
+
+        [[nodiscard]] auto get_env() const noexcept { return stdexec::get_env(inner_); }
+    };
+
+    class Scheduler {
+    private:
+        WorkStealingPool *pool_;
+
+    public:
+        using scheduler_concept = stdexec::scheduler_t;
+
+        explicit Scheduler(WorkStealingPool *pool) noexcept : pool_{pool} {}
+
+        [[nodiscard]] ScheduleSender schedule() const noexcept { return ScheduleSender{pool_}; }
+
+        // Sender, задачи которого при запуске отправляются одной пачкой с одним пробуждением
+        template <typename Sender>
+        [[nodiscard]] BatchSender<std::decay_t<Sender>> Batched(Sender &&sender) const {
+            return BatchSender<std::decay_t<Sender>>{pool_, std::forward<Sender>(sender)};
+        }
+
+        bool operator==(const Scheduler &) const noexcept = default;
+    };
+};
+
+inline WorkStealingPool::Scheduler WorkStealingPool::GetScheduler() noexcept { return Scheduler{this}; }
+
+}  // namespace ws
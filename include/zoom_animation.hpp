@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+#include "mandelbrot_renderer.hpp"
+#include "types.hpp"
+
+// Рендер анимации приближения. Путь задаётся ключевыми кадрами (центр и ширина области), между ними ширина
+// меняется экспоненциально — с постоянной скоростью зума. Каждый кадр отдельно не считается: на каждое
+// приближение в key_ratio раз рендерится одно опорное изображение с запасом по разрешению, а промежуточные
+// кадры получаются из него пересэмплированием.
+
+namespace zoom {
+
+struct ZoomKeyframe {
+    std::uint32_t frame{};
+    double center_x{};
+    double center_y{};
+    // Ширина видимой области комплексной плоскости; высота следует из пропорций кадра
+    double width{};
+};
+
+// Область с центром (center_x, center_y) и шириной width в пропорциях кадра
+[[nodiscard]] inline mandelbrot::ViewPort MakeViewport(double center_x, double center_y, double width,
+                                                      const RenderSettings &settings) noexcept {
+    const double height = width * settings.height / settings.width;
+    return {center_x - width / 2, center_x + width / 2, center_y - height / 2, center_y + height / 2};
+}
+
+class ZoomPath {
+public:
+    explicit ZoomPath(std::vector<ZoomKeyframe> keyframes) : keyframes_{std::move(keyframes)} {
+        if (keyframes_.empty()) {
+            throw std::invalid_argument("Zoom path needs at least one keyframe");
+        }
+        std::sort(keyframes_.begin(), keyframes_.end(),
+                  [](const ZoomKeyframe &a, const ZoomKeyframe &b) { return a.frame < b.frame; });
+        for (std::size_t i = 0; i < keyframes_.size(); ++i) {
+            if (!(keyframes_[i].width > 0.0)) {
+                throw std::invalid_argument("Zoom keyframe width must be positive");
+            }
+            if (i > 0 && keyframes_[i].frame == keyframes_[i - 1].frame) {
+                throw std::invalid_argument("Two zoom keyframes share frame " + std::to_string(keyframes_[i].frame));
+            }
+        }
+    }
+
+    [[nodiscard]] std::uint32_t FrameCount() const noexcept { return keyframes_.back().frame + 1; }
+
+    // Ширина интерполируется в логарифмическом масштабе, центр — пропорционально пройденной части зума,
+    // поэтому кадр приходит в центр следующего ключевого кадра одновременно с нужным масштабом
+    [[nodiscard]] mandelbrot::ViewPort ViewportAt(std::uint32_t frame, const RenderSettings &settings) const {
+        const auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), frame,
+                                           [](std::uint32_t f, const ZoomKeyframe &k) { return f < k.frame; });
+        if (next == keyframes_.begin()) {
+            return MakeViewport(next->center_x, next->center_y, next->width, settings);
+        }
+        const auto &prev = *(next - 1);
+        if (next == keyframes_.end()) {
+            return MakeViewport(prev.center_x, prev.center_y, prev.width, settings);
+        }
+
+        const double t = static_cast<double>(frame - prev.frame) / (next->frame - prev.frame);
+        const double width = prev.width * std::pow(next->width / prev.width, t);
+        const double s = prev.width == next->width ? t : (prev.width - width) / (prev.width - next->width);
+        return MakeViewport(prev.center_x + (next->center_x - prev.center_x) * s,
+                            prev.center_y + (next->center_y - prev.center_y) * s, width, settings);
+    }
+
+private:
+    std::vector<ZoomKeyframe> keyframes_;
+};
+
+struct ZoomRenderOptions {
+    // Во сколько раз растёт приближение между соседними опорными изображениями
+    double key_ratio{2.0};
+    // Дополнительный запас разрешения опорного изображения (1 — пиксель опорного не крупнее пикселя кадра)
+    double oversample{1.0};
+    // Во сколько раз опорное изображение может превысить ожидаемую площадь (key_ratio * oversample)^2 кадров
+    // из-за смещения центра; если больше — кадры группы считаются напрямую
+    double max_key_growth{4.0};
+};
+
+struct ZoomRenderStats {
+    std::uint32_t frames{};
+    std::uint32_t key_renders{};
+    std::uint32_t direct_renders{};
+    std::uint64_t rendered_pixels{};
+    std::chrono::nanoseconds render_time{};
+    std::chrono::nanoseconds resample_time{};
+    std::chrono::nanoseconds total_time{};
+};
+
+// Группа подряд идущих кадров [first_frame, end_frame), которые берутся из одного опорного изображения
+struct ZoomKeyPlan {
+    std::uint32_t first_frame{};
+    std::uint32_t end_frame{};
+    // Кадры группы считаются напрямую, без опорного изображения
+    bool direct{false};
+    mandelbrot::ViewPort key_viewport;
+    std::uint32_t key_width{};
+    std::uint32_t key_height{};
+};
+
+[[nodiscard]] inline std::vector<ZoomKeyPlan> PlanZoomKeys(const ZoomPath &path, const RenderSettings &settings,
+                                                           const ZoomRenderOptions &options = {}) {
+    if (!(options.key_ratio > 1.0) || !(options.oversample >= 1.0)) {
+        throw std::invalid_argument("Zoom key ratio must exceed 1 and oversample must be at least 1");
+    }
+    const auto log_ratio = std::log(options.key_ratio);
+    auto scale_index = [&](const mandelbrot::ViewPort &vp) {
+        return static_cast<std::int64_t>(std::floor(std::log(vp.width()) / log_ratio));
+    };
+
+    const auto frame_pixels = static_cast<double>(settings.width) * settings.height;
+    const auto max_key_pixels = frame_pixels * options.key_ratio * options.key_ratio * options.oversample *
+                                options.oversample * options.max_key_growth;
+
+    std::vector<ZoomKeyPlan> plans;
+    const auto frames = path.FrameCount();
+    for (std::uint32_t first = 0; first < frames;) {
+        const auto first_vp = path.ViewportAt(first, settings);
+        const auto index = scale_index(first_vp);
+
+        ZoomKeyPlan plan{.first_frame = first};
+        auto bounds = first_vp;
+        double pixel_w = first_vp.width() / settings.width;
+        double pixel_h = first_vp.height() / settings.height;
+        double margin_w = pixel_w;
+        double margin_h = pixel_h;
+
+        std::uint32_t end = first + 1;
+        for (; end < frames; ++end) {
+            const auto vp = path.ViewportAt(end, settings);
+            if (scale_index(vp) != index) {
+                break;
+            }
+            bounds.x_min = std::min(bounds.x_min, vp.x_min);
+            bounds.x_max = std::max(bounds.x_max, vp.x_max);
+            bounds.y_min = std::min(bounds.y_min, vp.y_min);
+            bounds.y_max = std::max(bounds.y_max, vp.y_max);
+            pixel_w = std::min(pixel_w, vp.width() / settings.width);
+            pixel_h = std::min(pixel_h, vp.height() / settings.height);
+            margin_w = std::max(margin_w, vp.width() / settings.width);
+            margin_h = std::max(margin_h, vp.height() / settings.height);
+        }
+        plan.end_frame = end;
+
+        // Запас в один пиксель самого крупного кадра: фильтр пересэмплирования заходит за границу кадра
+        pixel_w /= options.oversample;
+        pixel_h /= options.oversample;
+        const auto key_w = std::ceil((bounds.width() + 2 * margin_w) / pixel_w);
+        const auto key_h = std::ceil((bounds.height() + 2 * margin_h) / pixel_h);
+
+        plan.direct = end - first == 1 || key_w * key_h > max_key_pixels;
+        if (!plan.direct) {
+            plan.key_width = static_cast<std::uint32_t>(key_w);
+            plan.key_height = static_cast<std::uint32_t>(key_h);
+            const auto x0 = bounds.x_min - margin_w;
+            const auto y0 = bounds.y_min - margin_h;
+            plan.key_viewport = {x0, x0 + plan.key_width * pixel_w, y0, y0 + plan.key_height * pixel_h};
+        }
+        plans.push_back(plan);
+        first = end;
+    }
+    return plans;
+}
+
+// Отсчёт билинейного фильтра вдоль одной оси: два соседних пикселя опорного изображения и вес второго
+struct ResampleTap {
+    std::uint32_t i0;
+    std::uint32_t i1;
+    float weight;
+};
+
+// Отсчёты для каждого из count пикселей кадра вдоль оси. Пиксель i кадра покрывает в координатах опорного
+// изображения отрезок длины step с центром в first + i * step; фильтр берёт taps равномерных отсчётов на нём
+[[nodiscard]] inline std::vector<ResampleTap> MakeResampleTaps(double first, double step, std::uint32_t count,
+                                                               std::uint32_t taps, std::uint32_t key_size) {
+    std::vector<ResampleTap> result;
+    result.reserve(static_cast<std::size_t>(count) * taps);
+    const double last = static_cast<double>(key_size - 1);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        for (std::uint32_t t = 0; t < taps; ++t) {
+            const double pos =
+                std::clamp(first + i * step + ((t + 0.5) / taps - 0.5) * step, 0.0, last);
+            const auto i0 = static_cast<std::uint32_t>(pos);
+            result.push_back({i0, std::min(i0 + 1, key_size - 1), static_cast<float>(pos - i0)});
+        }
+    }
+    return result;
+}
+
+// Опорное изображение: RGBA буфер и область плоскости, из которой он посчитан
+struct KeyImage {
+    RgbaBuffer rgba;
+    mandelbrot::ViewPort viewport;
+    std::uint32_t width{};
+    std::uint32_t height{};
+};
+
+// Пересэмплирование кадра из опорного изображения: усреднение (box-фильтр) по площади пикселя кадра,
+// внутри — билинейная интерполяция. Строки делятся на N частей и считаются на пуле.
+template <size_t N, typename Scheduler>
+void ResampleFrame(Scheduler sched, const KeyImage &key, const mandelbrot::ViewPort &frame,
+                   const RenderSettings &settings, RgbaBuffer &out) {
+    const double key_pixel_w = key.viewport.width() / key.width;
+    const double key_pixel_h = key.viewport.height() / key.height;
+    const double step_x = frame.width() / settings.width / key_pixel_w;
+    const double step_y = frame.height() / settings.height / key_pixel_h;
+    const auto taps_x = std::max(1u, static_cast<std::uint32_t>(std::ceil(step_x - 1e-9)));
+    const auto taps_y = std::max(1u, static_cast<std::uint32_t>(std::ceil(step_y - 1e-9)));
+
+    const auto cols = MakeResampleTaps((frame.x_min - key.viewport.x_min) / key_pixel_w, step_x, settings.width,
+                                       taps_x, key.width);
+    const auto rows = MakeResampleTaps((frame.y_min - key.viewport.y_min) / key_pixel_h, step_y, settings.height,
+                                       taps_y, key.height);
+    out.resize(static_cast<std::size_t>(settings.width) * settings.height * RGBA_CHANNELS);
+
+    auto resample_rows = [&](std::uint32_t begin, std::uint32_t end) {
+        const float norm = 1.0f / static_cast<float>(taps_x * taps_y);
+        const std::size_t key_stride = static_cast<std::size_t>(key.width) * RGBA_CHANNELS;
+        for (std::uint32_t y = begin; y < end; ++y) {
+            auto *dst = out.data() + static_cast<std::size_t>(y) * settings.width * RGBA_CHANNELS;
+            for (std::uint32_t x = 0; x < settings.width; ++x, dst += RGBA_CHANNELS) {
+                float acc[3]{};
+                for (std::uint32_t ty = 0; ty < taps_y; ++ty) {
+                    const auto &ry = rows[static_cast<std::size_t>(y) * taps_y + ty];
+                    const auto *row0 = key.rgba.data() + ry.i0 * key_stride;
+                    const auto *row1 = key.rgba.data() + ry.i1 * key_stride;
+                    for (std::uint32_t tx = 0; tx < taps_x; ++tx) {
+                        const auto &rx = cols[static_cast<std::size_t>(x) * taps_x + tx];
+                        const auto c0 = rx.i0 * RGBA_CHANNELS;
+                        const auto c1 = rx.i1 * RGBA_CHANNELS;
+                        for (std::size_t ch = 0; ch < 3; ++ch) {
+                            const float top = row0[c0 + ch] + (row0[c1 + ch] - row0[c0 + ch]) * rx.weight;
+                            const float bottom = row1[c0 + ch] + (row1[c1 + ch] - row1[c0 + ch]) * rx.weight;
+                            acc[ch] += top + (bottom - top) * ry.weight;
+                        }
+                    }
+                }
+                for (std::size_t ch = 0; ch < 3; ++ch) {
+                    dst[ch] = static_cast<std::uint8_t>(std::clamp(acc[ch] * norm + 0.5f, 0.0f, 255.0f));
+                }
+                dst[3] = 255;
+            }
+        }
+    };
+
+    auto create_when_all = [&]<size_t... I>(std::index_sequence<I...>) {
+        return stdexec::when_all((stdexec::schedule(sched) | stdexec::then([&] {
+                                      resample_rows(static_cast<std::uint32_t>(settings.height * I / N),
+                                                    static_cast<std::uint32_t>(settings.height * (I + 1) / N));
+                                  }))...);
+    };
+    stdexec::sync_wait(create_when_all(std::make_index_sequence<N>{}));
+}
+
+// Рендерит весь путь и по порядку отдаёт кадры в sink(frame_index, const RgbaBuffer &)
+template <typename Renderer, typename FrameSink>
+ZoomRenderStats RenderZoomSequence(Renderer &renderer, const ZoomPath &path, const RenderSettings &settings,
+                                   FrameSink &&sink, const ZoomRenderOptions &options = {}) {
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    ZoomRenderStats stats;
+    auto render = [&](const mandelbrot::ViewPort &viewport, const RenderSettings &render_settings) {
+        const auto render_start = Clock::now();
+        auto result = DispatchLanes(renderer.Concurrency(), [&]<std::size_t N>() {
+            auto rendered = stdexec::sync_wait(renderer.template RenderAsync<N>(viewport, render_settings));
+            return std::get<0>(std::move(rendered).value());
+        });
+        stats.render_time += Clock::now() - render_start;
+        stats.rendered_pixels += static_cast<std::uint64_t>(render_settings.width) * render_settings.height;
+        return std::move(result.rgba_data);
+    };
+
+    RgbaBuffer frame_rgba;
+    for (const auto &plan : PlanZoomKeys(path, settings, options)) {
+        if (plan.direct) {
+            for (auto f = plan.first_frame; f < plan.end_frame; ++f) {
+                sink(f, render(path.ViewportAt(f, settings), settings));
+                ++stats.direct_renders;
+                ++stats.frames;
+            }
+            continue;
+        }
+
+        auto key_settings = settings;
+        key_settings.width = plan.key_width;
+        key_settings.height = plan.key_height;
+        const KeyImage key{render(plan.key_viewport, key_settings), plan.key_viewport, plan.key_width,
+                           plan.key_height};
+        ++stats.key_renders;
+
+        for (auto f = plan.first_frame; f < plan.end_frame; ++f) {
+            const auto resample_start = Clock::now();
+            DispatchLanes(renderer.Concurrency(), [&]<std::size_t N>() {
+                ResampleFrame<N>(renderer.GetScheduler(), key, path.ViewportAt(f, settings), settings, frame_rgba);
+            });
+            stats.resample_time += Clock::now() - resample_start;
+            sink(f, frame_rgba);
+            ++stats.frames;
+        }
+    }
+    stats.total_time = Clock::now() - start;
+    return stats;
+}
+
+}  // namespace zoom
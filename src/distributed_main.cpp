@@ -0,0 +1,265 @@
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "cli_utils.hpp"
+#include "distributed.hpp"
+#include "image_writer.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "types.hpp"
+
+extern char **environ;
+
+// Распределённый рендер по TCP. Три режима:
+//   coordinator — делит кадр на полосы, раздаёт их рабочим и собирает изображение
+//   worker      — считает полосы, присланные координатором
+//   scaling     — запускает координатор с 1, 2, 4... локальными рабочими и печатает ускорение
+
+namespace {
+
+struct Options {
+    std::string mode;
+    RenderSettings settings{.width = 3840, .height = 2160, .max_iterations = 1000, .escape_radius = 2.0};
+    mandelbrot::ViewPort viewport;
+    std::string host{"127.0.0.1"};
+    std::uint16_t port{9000};
+    std::uint32_t spawn_workers{0};
+    std::uint32_t worker_threads{THREAD_POOL_SIZE};
+    std::vector<std::uint32_t> scaling_workers{1, 2, 4};
+    dist::DistributedOptions distributed;
+    std::filesystem::path output;
+};
+
+void PrintUsage() {
+    std::println("Usage:\n"
+                 "  MandelbrotFractal_distributed coordinator [--listen HOST:PORT] [--spawn N] [render options]\n"
+                 "  MandelbrotFractal_distributed worker --connect HOST:PORT [--threads N]\n"
+                 "  MandelbrotFractal_distributed scaling [--workers 1,2,4] [render options]\n"
+                 "Render options:\n"
+                 "  --size WxH                      image size (default 3840x2160)\n"
+                 "  --iterations N                  iteration cap (default 1000)\n"
+                 "  --viewport x_min,x_max,y_min,y_max  complex plane region (default -2.5,1.5,-2,2)\n"
+                 "  --tile-rows N                   rows per job (default {})\n"
+                 "  --threads N                     threads per worker process (default {})\n"
+                 "  --timeout MS                    requeue tiles of a worker silent this long (default {})\n"
+                 "  --idle-timeout MS               fail the frame after this long without workers (default {})\n"
+                 "  --output FILE                   write the assembled image (.png or .ppm)",
+                 dist::DistributedOptions{}.tile_rows, THREAD_POOL_SIZE,
+                 dist::DistributedOptions{}.worker_timeout.count(), dist::DistributedOptions{}.idle_timeout.count());
+}
+
+void ParseEndpoint(std::string_view text, std::string_view option, Options &options) {
+    const auto parts = cli::Split(text, ':');
+    if (parts.size() != 2) {
+        throw std::invalid_argument(std::string{option} + " expects HOST:PORT");
+    }
+    options.host = parts[0];
+    options.port = cli::ParseNumber<std::uint16_t>(parts[1], option);
+}
+
+Options ParseOptions(int argc, char **argv) {
+    if (argc < 2) {
+        throw std::invalid_argument("Missing mode");
+    }
+    Options options;
+    options.mode = argv[1];
+    if (options.mode != "coordinator" && options.mode != "worker" && options.mode != "scaling") {
+        throw std::invalid_argument("Unknown mode " + options.mode);
+    }
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + std::string{arg});
+        }
+        const std::string_view value{argv[++i]};
+        if (arg == "--listen" || arg == "--connect") {
+            ParseEndpoint(value, arg, options);
+        } else if (arg == "--spawn") {
+            options.spawn_workers = cli::ParseNumber<std::uint32_t>(value, arg);
+        } else if (arg == "--workers") {
+            options.scaling_workers.clear();
+            for (const auto part : cli::Split(value, ',')) {
+                options.scaling_workers.push_back(std::max(cli::ParseNumber<std::uint32_t>(part, arg), 1u));
+            }
+        } else if (arg == "--threads") {
+            options.worker_threads = std::max(cli::ParseNumber<std::uint32_t>(value, arg), 1u);
+        } else if (arg == "--size") {
+            const auto parts = cli::Split(value, 'x');
+            if (parts.size() != 2) {
+                throw std::invalid_argument("--size expects WxH");
+            }
+            options.settings.width = cli::ParseNumber<std::uint32_t>(parts[0], arg);
+            options.settings.height = cli::ParseNumber<std::uint32_t>(parts[1], arg);
+        } else if (arg == "--iterations") {
+            options.settings.max_iterations = cli::ParseNumber<std::uint32_t>(value, arg);
+        } else if (arg == "--viewport") {
+            const auto parts = cli::Split(value, ',');
+            if (parts.size() != 4) {
+                throw std::invalid_argument("--viewport expects x_min,x_max,y_min,y_max");
+            }
+            options.viewport =
+                mandelbrot::ViewPort{cli::ParseNumber<double>(parts[0], arg), cli::ParseNumber<double>(parts[1], arg),
+                                     cli::ParseNumber<double>(parts[2], arg), cli::ParseNumber<double>(parts[3], arg)};
+        } else if (arg == "--tile-rows") {
+            options.distributed.tile_rows = cli::ParseNumber<std::uint32_t>(value, arg);
+        } else if (arg == "--timeout") {
+            options.distributed.worker_timeout =
+                std::chrono::milliseconds{cli::ParseNumber<std::uint32_t>(value, arg)};
+        } else if (arg == "--idle-timeout") {
+            options.distributed.idle_timeout = std::chrono::milliseconds{cli::ParseNumber<std::uint32_t>(value, arg)};
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            throw std::invalid_argument("Unknown option " + std::string{arg});
+        }
+    }
+    if (options.settings.width == 0 || options.settings.height == 0) {
+        throw std::invalid_argument("Image size must be positive");
+    }
+    return options;
+}
+
+// Запускает локальные рабочие процессы этого же исполняемого файла. Они подключаются к адресу, который слушает
+// координатор; при прослушивании всех интерфейсов — к 127.0.0.1.
+std::vector<pid_t> SpawnWorkers(std::uint32_t count, const std::string &host, std::uint16_t port,
+                                std::uint32_t threads) {
+    const std::string endpoint = (host.empty() || host == "0.0.0.0" ? "127.0.0.1" : host) + ":" + std::to_string(port);
+    const std::string threads_arg = std::to_string(threads);
+    std::vector<pid_t> pids;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::vector<char *> args{const_cast<char *>("MandelbrotFractal_distributed"), const_cast<char *>("worker"),
+                                 const_cast<char *>("--connect"), const_cast<char *>(endpoint.c_str()),
+                                 const_cast<char *>("--threads"), const_cast<char *>(threads_arg.c_str()), nullptr};
+        pid_t pid = 0;
+        if (const int error = posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, args.data(), environ);
+            error != 0) {
+            throw std::system_error(error, std::generic_category(), "posix_spawn");
+        }
+        pids.push_back(pid);
+    }
+    return pids;
+}
+
+void WaitWorkers(const std::vector<pid_t> &pids) {
+    for (const auto pid : pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+}
+
+// Без блокировки убирает из pids завершившиеся процессы; true — не осталось ни одного
+bool ReapExitedWorkers(std::vector<pid_t> &pids) {
+    std::erase_if(pids, [](pid_t pid) {
+        int status = 0;
+        return waitpid(pid, &status, WNOHANG) != 0;
+    });
+    return pids.empty();
+}
+
+// Рендерит кадр на запущенных рабочих: рендер прерывается, когда все они завершились. При ошибке оставшиеся
+// рабочие останавливаются, чтобы не пережить координатор.
+dist::DistributedResult RenderOnSpawned(dist::Coordinator &coordinator, std::vector<pid_t> pids,
+                                        const Options &options) {
+    auto distributed = options.distributed;
+    if (!pids.empty()) {
+        distributed.workers_gone = [&pids] { return ReapExitedWorkers(pids); };
+    }
+    try {
+        auto result = coordinator.Render(options.viewport, options.settings, distributed);
+        WaitWorkers(pids);
+        return result;
+    } catch (...) {
+        for (const auto pid : pids) {
+            kill(pid, SIGTERM);
+        }
+        WaitWorkers(pids);
+        throw;
+    }
+}
+
+void PrintStats(const dist::DistributedStats &stats, const RenderSettings &settings) {
+    const auto seconds = std::chrono::duration<double>(stats.total_time).count();
+    std::println("Rendered {}x{} as {} tiles on {} workers in {:.3f} s: {:.2f} Mpix/s; {} worker failures, {} tiles "
+                 "requeued, {} duplicate results",
+                 settings.width, settings.height, stats.tiles, stats.workers, seconds,
+                 static_cast<double>(settings.width) * settings.height / seconds / 1e6, stats.worker_failures,
+                 stats.requeued_tiles, stats.duplicate_results);
+}
+
+int RunCoordinator(const Options &options) {
+    dist::Coordinator coordinator{options.host, options.port};
+    std::println("Coordinator listening on {}:{}", options.host, coordinator.Port());
+    auto result = RenderOnSpawned(
+        coordinator, SpawnWorkers(options.spawn_workers, options.host, coordinator.Port(), options.worker_threads),
+        options);
+    PrintStats(result.stats, options.settings);
+
+    if (!options.output.empty()) {
+        image::WriteImage(options.output, options.settings.width, options.settings.height, result.rgba);
+        std::println("Wrote {}", options.output.string());
+    }
+    return 0;
+}
+
+int RunScaling(const Options &options) {
+    dist::Coordinator coordinator{"127.0.0.1", 0};
+    std::println("{:>8} {:>10} {:>10} {:>8} {:>11}", "workers", "time, s", "Mpix/s", "speedup", "efficiency");
+
+    double baseline = 0.0;
+    for (const auto workers : options.scaling_workers) {
+        const auto result = RenderOnSpawned(
+            coordinator, SpawnWorkers(workers, "127.0.0.1", coordinator.Port(), options.worker_threads), options);
+
+        const auto seconds = std::chrono::duration<double>(result.stats.total_time).count();
+        if (baseline == 0.0) {
+            baseline = seconds * options.scaling_workers.front();
+        }
+        const auto speedup = baseline / seconds;
+        std::println("{:>8} {:>10.3f} {:>10.2f} {:>8.2f} {:>10.0f}%", workers, seconds,
+                     static_cast<double>(options.settings.width) * options.settings.height / seconds / 1e6, speedup,
+                     100.0 * speedup / workers);
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::println(stderr, "Error: {}", e.what());
+        PrintUsage();
+        return 2;
+    }
+
+    try {
+        if (options.mode == "worker") {
+            MandelbrotRenderer renderer{options.worker_threads};
+            const auto tiles = dist::RunWorker(renderer, options.host, options.port);
+            std::println(stderr, "Worker {} rendered {} tiles", getpid(), tiles);
+            return 0;
+        }
+        if (options.mode == "scaling") {
+            return RunScaling(options);
+        }
+        return RunCoordinator(options);
+    } catch (const std::exception &e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+}
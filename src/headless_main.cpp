@@ -0,0 +1,419 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdexec/execution.hpp>
+
+#include "banded_renderer.hpp"
+#include "canonical_viewports.hpp"
+#include "cli_utils.hpp"
+#include "frame_pacer.hpp"
+#include "image_writer.hpp"
+#include "input_session.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "perf_counters.hpp"
+#include "renderer_pool.hpp"
+#include "trace.hpp"
+#include "types.hpp"
+#include "zoom_animation.hpp"
+
+// Рендер одного кадра без окна и без SFML: результат сразу пишется в PNG или PPM
+
+namespace {
+
+struct HeadlessOptions {
+    RenderSettings settings{.width = 1920, .height = 1080, .max_iterations = 500, .escape_radius = 2.0};
+    mandelbrot::ViewPort viewport;
+    std::uint32_t threads = THREAD_POOL_SIZE;
+    PoolKind pool = PoolKind::STATIC;
+    std::filesystem::path output;
+    // Потоковый режим полосами для изображений, не помещающихся в память
+    bool banded = false;
+    BandedRenderOptions banded_options;
+    // Анимация приближения от --viewport к zoom_target за zoom_frames кадров
+    std::uint32_t zoom_frames = 0;
+    std::optional<zoom::ZoomKeyframe> zoom_target;
+    std::uint32_t fps = 30;
+    zoom::ZoomRenderOptions zoom_options;
+    // Файл Chrome trace; пустой путь — трассировка выключена
+    std::filesystem::path trace;
+    // Записанная в окне сессия, которую нужно воспроизвести без окна
+    std::filesystem::path replay;
+    // Аппаратные счётчики этапов в строке статистики кадра
+    bool perf_counters = false;
+    // Гистограмма итераций кадра в CSV или JSON; пустой путь — не сохранять
+    std::filesystem::path histogram;
+    // Эталонная область бенчмарков вместо --viewport и --iterations; "all" — все области по очереди
+    std::string canonical;
+};
+
+void PrintUsage() {
+    std::println(stderr, "Usage: MandelbrotFractal_headless --output <file.png|file.ppm> [options]\n"
+                 "  --size WxH                      image size (default 1920x1080)\n"
+                 "  --iterations N                  iteration cap (default 500)\n"
+                 "  --viewport x_min,x_max,y_min,y_max  complex plane region (default -2.5,1.5,-2,2)\n"
+                 "  --aa N                          extra samples per edge pixel (default 0)\n"
+                 "  --kernel scalar|simd|simd-streaming  iteration kernel (default scalar)\n"
+                 "  --threads N                     thread pool size and strip count (default {})\n"
+                 "  --pool static|ws                thread pool: static or work-stealing (default static)\n"
+                 "  --bands ROWS                    stream PNG to disk in bands of ROWS rows (bounded memory)\n"
+                 "  --bands-in-flight N             max bands kept in memory in banded mode (default {})\n"
+                 "  --compression L                 deflate level 0..9 for PNG bands (default {})\n"
+                 "  --zoom-frames N                 render an N-frame zoom from --viewport to --zoom-to\n"
+                 "  --zoom-to cx,cy,width           center and width of the last zoom frame\n"
+                 "  --key-ratio R                   zoom factor between rendered key images (default {})\n"
+                 "  --fps F                         frame rate written to Y4M (default 30)\n"
+                 "  --trace FILE                    write a Chrome trace (chrome://tracing, Perfetto) of the run\n"
+                 "  --replay FILE                   replay a session recorded with MandelbrotFractal --record\n"
+                 "  --perf-counters                 add hardware counters (cycles, IPC, misses) to frame stats\n"
+                 "  --histogram FILE                write the iteration histogram of the frame (*.csv or JSON)\n"
+                 "  --canonical NAME|all            render a benchmark viewport (full_set, seahorse_valley, ...);\n"
+                 "                                  'all' renders each one to <output>_<name>\n"
+                 "Zoom output: '-' or *.y4m writes a Y4M stream, otherwise numbered images name_00000.png",
+                 THREAD_POOL_SIZE, BandedRenderOptions{}.bands_in_flight, image::DEFAULT_COMPRESSION_LEVEL,
+                 zoom::ZoomRenderOptions{}.key_ratio);
+}
+
+HeadlessOptions ParseOptions(int argc, char **argv) {
+    HeadlessOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        auto next = [&]() -> std::string_view {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string{arg});
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--output" || arg == "-o") {
+            options.output = next();
+        } else if (arg == "--size") {
+            const auto parts = cli::Split(next(), 'x');
+            if (parts.size() != 2) {
+                throw std::invalid_argument("--size expects WxH");
+            }
+            options.settings.width = cli::ParseNumber<std::uint32_t>(parts[0], arg);
+            options.settings.height = cli::ParseNumber<std::uint32_t>(parts[1], arg);
+        } else if (arg == "--iterations") {
+            options.settings.max_iterations = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--viewport") {
+            const auto parts = cli::Split(next(), ',');
+            if (parts.size() != 4) {
+                throw std::invalid_argument("--viewport expects x_min,x_max,y_min,y_max");
+            }
+            options.viewport =
+                mandelbrot::ViewPort{cli::ParseNumber<double>(parts[0], arg), cli::ParseNumber<double>(parts[1], arg),
+                                     cli::ParseNumber<double>(parts[2], arg), cli::ParseNumber<double>(parts[3], arg)};
+        } else if (arg == "--kernel") {
+            const auto name = next();
+            if (name == "scalar") {
+                options.settings.kernel = mandelbrot::Kernel::SCALAR;
+            } else if (name == "simd") {
+                options.settings.kernel = mandelbrot::Kernel::SIMD;
+            } else if (name == "simd-streaming") {
+                options.settings.kernel = mandelbrot::Kernel::SIMD_STREAMING;
+            } else {
+                throw std::invalid_argument("--kernel expects scalar, simd or simd-streaming");
+            }
+        } else if (arg == "--aa") {
+            options.settings.aa_samples = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--threads") {
+            options.threads = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--pool") {
+            options.pool = ParsePoolKind(next());
+        } else if (arg == "--bands") {
+            options.banded = true;
+            options.banded_options.band_rows = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--bands-in-flight") {
+            options.banded_options.bands_in_flight = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--compression") {
+            options.banded_options.compression_level = cli::ParseNumber<int>(next(), arg);
+        } else if (arg == "--zoom-frames") {
+            options.zoom_frames = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--zoom-to") {
+            const auto parts = cli::Split(next(), ',');
+            if (parts.size() != 3) {
+                throw std::invalid_argument("--zoom-to expects cx,cy,width");
+            }
+            options.zoom_target = zoom::ZoomKeyframe{.center_x = cli::ParseNumber<double>(parts[0], arg),
+                                                     .center_y = cli::ParseNumber<double>(parts[1], arg),
+                                                     .width = cli::ParseNumber<double>(parts[2], arg)};
+        } else if (arg == "--key-ratio") {
+            options.zoom_options.key_ratio = cli::ParseNumber<double>(next(), arg);
+        } else if (arg == "--fps") {
+            options.fps = cli::ParseNumber<std::uint32_t>(next(), arg);
+        } else if (arg == "--trace") {
+            options.trace = next();
+        } else if (arg == "--replay") {
+            options.replay = next();
+        } else if (arg == "--perf-counters") {
+            options.perf_counters = true;
+        } else if (arg == "--histogram") {
+            options.histogram = next();
+        } else if (arg == "--canonical") {
+            options.canonical = next();
+            const auto *canonical = FindCanonicalViewport(options.canonical);
+            if (canonical == nullptr && options.canonical != "all") {
+                throw std::invalid_argument("Unknown canonical viewport " + options.canonical);
+            }
+            if (canonical != nullptr) {
+                options.viewport = canonical->viewport;
+                options.settings.max_iterations = canonical->max_iterations;
+            }
+        } else {
+            throw std::invalid_argument("Unknown option " + std::string{arg});
+        }
+    }
+
+    if (options.output.empty() && options.replay.empty()) {
+        throw std::invalid_argument("--output is required");
+    }
+    if (options.settings.width == 0 || options.settings.height == 0 || options.threads == 0) {
+        throw std::invalid_argument("Size and thread count must be positive");
+    }
+    if (options.viewport.width() <= 0.0 || options.viewport.height() <= 0.0) {
+        throw std::invalid_argument("Viewport must have x_min < x_max and y_min < y_max");
+    }
+    if (options.banded_options.compression_level < 0 || options.banded_options.compression_level > 9) {
+        throw std::invalid_argument("--compression expects a level in 0..9");
+    }
+    if (options.banded && options.output.extension() != ".png") {
+        throw std::invalid_argument("Banded mode writes PNG only");
+    }
+    // Полосы сжимаются и уходят на диск по одной: сглаживанию нужны соседние строки, а гистограмма
+    // и счётчики кадра в этом режиме не собираются
+    if (options.banded &&
+        (options.settings.aa_samples > 0 || !options.histogram.empty() || options.perf_counters)) {
+        throw std::invalid_argument("Banded mode does not support --aa, --histogram or --perf-counters");
+    }
+    if (options.canonical == "all" && (options.banded || options.zoom_frames > 0)) {
+        throw std::invalid_argument("--canonical all renders single frames only");
+    }
+    if ((options.zoom_frames > 0) != options.zoom_target.has_value()) {
+        throw std::invalid_argument("--zoom-frames and --zoom-to must be given together");
+    }
+    if (options.zoom_frames > 0 && (options.banded || options.zoom_frames < 2 || options.fps == 0)) {
+        throw std::invalid_argument("Zoom needs at least 2 frames, a positive fps and no banded mode");
+    }
+    return options;
+}
+
+template <typename Renderer>
+int RunBanded(Renderer &renderer, const HeadlessOptions &options) {
+    const auto stats =
+        RenderBandedToPng(renderer, options.viewport, options.settings, options.output, options.banded_options);
+
+    const auto pixels = static_cast<double>(options.settings.width) * options.settings.height;
+    const auto seconds = std::chrono::duration<double>(stats.total_time).count();
+    const auto band_bytes = static_cast<double>(options.settings.width) * options.banded_options.band_rows *
+                            (RGBA_CHANNELS + 3);
+    std::println(stderr, "Rendered {}x{} in {} bands of {} rows in {:.2f} s: {:.2f} Mpix/s", options.settings.width,
+                 options.settings.height, stats.bands, options.banded_options.band_rows, seconds,
+                 pixels / seconds / 1e6);
+    std::println(stderr,
+                 "Compute {:.2f} s (pool total), write {:.2f} s, peak {} bands in flight (~{:.1f} MiB), wrote {} "
+                 "({:.1f} MiB{})",
+                 std::chrono::duration<double>(stats.compute_time).count(),
+                 std::chrono::duration<double>(stats.write_time).count(), stats.peak_bands_in_flight,
+                 stats.peak_bands_in_flight * band_bytes / (1 << 20), options.output.string(),
+                 static_cast<double>(stats.compressed_bytes) / (1 << 20),
+                 image::HasDeflateCompression() ? "" : ", uncompressed: built without zlib");
+    return 0;
+}
+
+// Кадр номер index анимации: output = frames/zoom.png -> frames/zoom_00042.png
+std::filesystem::path NumberedFramePath(const std::filesystem::path &output, std::uint32_t index) {
+    auto path = output;
+    path.replace_filename(std::format("{}_{:05}{}", output.stem().string(), index, output.extension().string()));
+    return path;
+}
+
+template <typename Renderer>
+int RunZoom(Renderer &renderer, const HeadlessOptions &options) {
+    const auto &settings = options.settings;
+    auto target = *options.zoom_target;
+    target.frame = options.zoom_frames - 1;
+    const zoom::ZoomPath path{{zoom::ZoomKeyframe{.frame = 0,
+                                                  .center_x = (options.viewport.x_min + options.viewport.x_max) / 2,
+                                                  .center_y = (options.viewport.y_min + options.viewport.y_max) / 2,
+                                                  .width = options.viewport.width()},
+                               target}};
+
+    // Видеопоток может уходить в stdout, поэтому вся диагностика программы печатается в stderr
+    const bool to_stdout = options.output == "-";
+    const bool y4m = to_stdout || options.output.extension() == ".y4m";
+    std::ofstream file;
+    if (y4m && !to_stdout) {
+        file.open(options.output, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Cannot open " + options.output.string() + " for writing");
+        }
+    }
+    std::optional<image::Y4mWriter> video;
+    if (y4m) {
+        std::ios::sync_with_stdio(false);
+        video.emplace(to_stdout ? std::cout : file, settings.width, settings.height, options.fps);
+    }
+
+    const auto stats = zoom::RenderZoomSequence(
+        renderer, path, settings,
+        [&](std::uint32_t index, const RgbaBuffer &rgba) {
+            if (video) {
+                video->WriteFrame(rgba);
+            } else {
+                image::WriteImage(NumberedFramePath(options.output, index), settings.width, settings.height, rgba);
+            }
+        },
+        options.zoom_options);
+    if (to_stdout) {
+        std::cout.flush();
+    }
+
+    const auto frame_pixels = static_cast<double>(settings.width) * settings.height;
+    std::println(stderr,
+                 "Rendered {} frames {}x{} in {:.2f} s: {} key images, {} direct frames, {:.1f} frame-equivalents "
+                 "computed ({:.1f}x fewer than rendering every frame)",
+                 stats.frames, settings.width, settings.height,
+                 std::chrono::duration<double>(stats.total_time).count(), stats.key_renders, stats.direct_renders,
+                 stats.rendered_pixels / frame_pixels, stats.frames * frame_pixels / stats.rendered_pixels);
+    std::println(stderr, "Render {:.2f} s, resample {:.2f} s", std::chrono::duration<double>(stats.render_time).count(),
+                 std::chrono::duration<double>(stats.resample_time).count());
+    return 0;
+}
+
+// Воспроизводит записанную сессию без окна и печатает статистику времени кадра
+template <typename Renderer>
+int RunReplay(Renderer &renderer, const HeadlessOptions &options) {
+    std::ifstream file{options.replay};
+    if (!file) {
+        throw std::runtime_error("Failed to open " + options.replay.string());
+    }
+    const auto recorded = session::ReadSession(file);
+
+    FrameStats stats;
+    const auto summary = session::ReplayHeadless(renderer, recorded, stats);
+
+    const auto frame = stats.frame_time.GetSummary();
+    std::println(stderr, "Replayed {} frames ({} renders) of {}x{} in {:.2f} s, {} diverged from the recording",
+                 summary.frames, summary.renders, recorded.settings.width, recorded.settings.height,
+                 std::chrono::duration<double>(summary.total_time).count(), summary.divergences);
+    std::println(stderr, "Frame time p50: {}, p99: {}, max: {}", frame.p50, frame.p99, frame.max);
+    return 0;
+}
+
+// Один кадр целиком в памяти
+template <typename Renderer>
+int RunSingle(Renderer &renderer, const HeadlessOptions &options) {
+    using Clock = std::chrono::steady_clock;
+
+    const auto render_start = Clock::now();
+    // Полос столько же, сколько потоков (с округлением вверх до степени двойки)
+    auto result = DispatchLanes(renderer.Concurrency(), [&]<std::size_t N>() {
+        auto rendered = stdexec::sync_wait(renderer.template RenderAsync<N>(options.viewport, options.settings));
+        return std::get<0>(std::move(rendered).value());
+    });
+    const auto render_time = Clock::now() - render_start;
+
+    const auto write_start = Clock::now();
+    image::WriteImage(options.output, options.settings.width, options.settings.height, result.rgba_data);
+    result.stats.present = Clock::now() - write_start;
+
+    const auto pixels = static_cast<double>(options.settings.width) * options.settings.height;
+    const auto seconds = std::chrono::duration<double>(render_time).count();
+    std::println(stderr,
+                 "Rendered {}x{} (max {} iterations, {} AA pixels, {}) in {:.2f} ms: {:.2f} Mpix/s, {:.3f} Giter/s",
+                 options.settings.width, options.settings.height, options.settings.max_iterations, result.aa_pixels,
+                 mandelbrot::KernelName(options.settings.kernel), seconds * 1e3, pixels / seconds / 1e6,
+                 static_cast<double>(result.stats.total_iterations) / seconds / 1e9);
+    std::println(stderr, "Wrote {} in {:.2f} ms", options.output.string(),
+                 std::chrono::duration<double, std::milli>(result.stats.present).count());
+    std::println(stderr, "{}", FormatRenderStats(result.stats));
+    if (!options.histogram.empty()) {
+        result.stats.iteration_histogram.Write(options.histogram);
+        std::println(stderr, "Wrote iteration histogram to {}", options.histogram.string());
+    }
+    return 0;
+}
+
+// Все эталонные области по очереди — обучающая нагрузка для PGO-сборки
+template <typename Renderer>
+int RunCanonical(Renderer &renderer, const HeadlessOptions &options) {
+    const auto with_name = [](const std::filesystem::path &path, std::string_view name) {
+        auto named = path;
+        named.replace_filename(std::format("{}_{}{}", path.stem().string(), name, path.extension().string()));
+        return named;
+    };
+    for (const auto &canonical : CANONICAL_VIEWPORTS) {
+        auto single = options;
+        single.viewport = canonical.viewport;
+        single.settings.max_iterations = canonical.max_iterations;
+        single.output = with_name(options.output, canonical.name);
+        if (!options.histogram.empty()) {
+            single.histogram = with_name(options.histogram, canonical.name);
+        }
+        std::println(stderr, "{}:", canonical.name);
+        if (const auto code = RunSingle(renderer, single); code != 0) {
+            return code;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    HeadlessOptions options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::println(stderr, "Error: {}", e.what());
+        PrintUsage();
+        return 2;
+    }
+
+    try {
+        auto &tracer = trace::Tracer::Instance();
+        if (!options.trace.empty()) {
+            tracer.Enable();
+        }
+        if (options.perf_counters) {
+            perf::Enable();
+        }
+
+        const int code = WithRenderer(options.pool, options.threads, [&](auto &renderer) {
+            if (!options.replay.empty()) {
+                return RunReplay(renderer, options);
+            }
+            if (options.banded) {
+                return RunBanded(renderer, options);
+            }
+            if (options.zoom_frames > 0) {
+                return RunZoom(renderer, options);
+            }
+            if (options.canonical == "all") {
+                return RunCanonical(renderer, options);
+            }
+            return RunSingle(renderer, options);
+        });
+
+        if (!options.trace.empty()) {
+            tracer.Disable();
+            tracer.WriteJson(options.trace);
+            std::println(stderr, "Wrote trace with {} events to {}", tracer.EventCount(), options.trace.string());
+        }
+        return code;
+    } catch (const std::exception &e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+}
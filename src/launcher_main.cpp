@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <print>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "cpu_features.hpp"
+
+// Запуск варианта программы, собранного под наибольший уровень x86-64, который поддерживает процессор.
+// Варианты лежат рядом с лаунчером под именами <program>-x86-64-v3 и т. п.; если подходящего нет,
+// запускается базовая сборка <program>. Уровень можно ограничить переменной MANDELBROT_ISA.
+
+namespace {
+
+std::filesystem::path LauncherDirectory(const char *argv0) {
+    std::error_code ec;
+    if (auto self = std::filesystem::read_symlink("/proc/self/exe", ec); !ec) {
+        return self.parent_path();
+    }
+    return std::filesystem::absolute(argv0, ec).parent_path();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::println("Usage: MandelbrotFractal_launch <program> [args...]\n"
+                     "  Runs <program>-<isa> for the best x86-64 level supported by this CPU, or <program>.\n"
+                     "  MANDELBROT_ISA=baseline|x86-64-v2|x86-64-v3|x86-64-v4 caps the level.");
+        return 2;
+    }
+
+    auto level = cpu::DetectIsaLevel();
+    if (const char *cap = std::getenv("MANDELBROT_ISA"); cap != nullptr) {
+        const auto requested = cpu::ParseIsaLevel(cap);
+        if (!requested) {
+            std::println(stderr, "Unknown MANDELBROT_ISA '{}'", cap);
+            return 2;
+        }
+        level = std::min(level, *requested);
+    }
+
+    const auto dir = LauncherDirectory(argv[0]);
+    const std::string program{argv[1]};
+    std::filesystem::path target;
+    for (auto l = static_cast<int>(level); l > 0; --l) {
+        const auto candidate = dir / (program + "-" + std::string{cpu::IsaName(static_cast<cpu::IsaLevel>(l))});
+        if (::access(candidate.c_str(), X_OK) == 0) {
+            target = candidate;
+            break;
+        }
+    }
+    if (target.empty()) {
+        target = dir / program;
+    }
+
+    std::string target_name = target.string();
+    std::vector<char *> args{target_name.data()};
+    for (int i = 2; i < argc; ++i) {
+        args.push_back(argv[i]);
+    }
+    args.push_back(nullptr);
+    ::execv(target_name.c_str(), args.data());
+    std::println(stderr, "Failed to start {}: {}", target_name, std::strerror(errno));
+    return 127;
+}
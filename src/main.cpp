@@ -1,6 +1,12 @@
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
 #include <print>
-#include <thread>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <utility>
 
 #include <SFML/Graphics.hpp>
@@ -8,90 +14,181 @@
 #include <exec/static_thread_pool.hpp>
 #include <stdexec/execution.hpp>
 
+#include "frame_pacer.hpp"
+#include "input_session.hpp"
 #include "mandelbrot.hpp"
 #include "mandelbrot_renderer.hpp"
+#include "perf_hud.hpp"
+#include "renderer_pool.hpp"
 #include "sfml_events_handler.hpp"
 #include "sfml_renderer.hpp"
+#include "tile_stream.hpp"
+#include "trace.hpp"
 
-using namespace std::chrono_literals;
-class FrameClock {
-public:
-    FrameClock() { Reset(); }
-
-    void Reset() noexcept { frame_start_ = std::chrono::steady_clock::now(); }
-    auto GetFrameTime() const noexcept { return std::chrono::steady_clock::now() - frame_start_; }
-
-private:
-    std::chrono::time_point<std::chrono::steady_clock> frame_start_;
-};
-
-class WaitForFPS {
-public:
-    WaitForFPS(FrameClock &clock, int fps) : clock_(clock), target_fps_(fps) {}
-
-    void operator()() {
-        auto elapsed = clock_.GetFrameTime();
-        auto target_duration = std::chrono::milliseconds(1000 / target_fps_);
-        if (elapsed < target_duration) {
-            std::this_thread::sleep_for(target_duration - elapsed);
-        }
-        clock_.Reset();
-    }
-
-private:
-    FrameClock &clock_;
-    int target_fps_;
-};
+constexpr RenderSettings DEFAULT_SETTINGS{.width = 800, .height = 600, .max_iterations = 100, .escape_radius = 2.0};
 
+// Окно поверх рендерера на любом пуле; рендерер создаёт и держит вызывающий
+template <typename Renderer>
 class MandelbrotApp {
 private:
-    RenderSettings render_settings_{.width = 800, .height = 600, .max_iterations = 100, .escape_radius = 2.0};
+    static constexpr double TARGET_FPS = 60.0;
+
+    RenderSettings render_settings_;
 
     sf::RenderWindow window_;
-    sf::Image image_;
     sf::Texture texture_;
     sf::Sprite sprite_;
-    MandelbrotRenderer renderer_;
+    BasicTileStream<Renderer> tile_stream_;
     AppState state_;
+    FrameStats frame_stats_;
+    PerfHud hud_;
+    session::SessionRecorder *recorder_;
+    session::SessionPlayer *player_;
+    std::FILE *stats_log_;
 
 public:
-    MandelbrotApp()
-        : window_{sf::VideoMode{render_settings_.width, render_settings_.height}, "Mandelbrot Fractal"},
-          renderer_{THREAD_POOL_SIZE} {
+    // Без записи и воспроизведения — обычный интерактивный режим. При воспроизведении настройки и начальная
+    // область берутся из сессии. stats_log — куда писать строку этапов каждого посчитанного кадра.
+    explicit MandelbrotApp(Renderer &renderer, session::SessionRecorder *recorder = nullptr,
+                           session::SessionPlayer *player = nullptr, std::FILE *stats_log = nullptr)
+        : render_settings_{player != nullptr ? player->GetSession().settings : DEFAULT_SETTINGS},
+          window_{sf::VideoMode{render_settings_.width, render_settings_.height}, "Mandelbrot Fractal"},
+          tile_stream_{renderer},
+          hud_{std::string{mandelbrot::KernelName(render_settings_.kernel)}, render_settings_.max_iterations},
+          recorder_{recorder}, player_{player}, stats_log_{stats_log} {
+        if (player_ != nullptr) {
+            state_.viewport = player_->GetSession().start_viewport;
+        }
 
-        image_.create(render_settings_.width, render_settings_.height);
         texture_.create(render_settings_.width, render_settings_.height);
+        if (!hud_.LoadFont()) {
+            std::println("HUD font not found, set MANDELBROT_HUD_FONT to a .ttf file to enable the F1 overlay");
+        }
 
         window_.setKeyRepeatEnabled(false);
     }
 
     void Run() {
-        FrameClock frame_clock;
+        FramePacer frame_pacer{frame_stats_, TARGET_FPS};
         sf::Clock zoom_clock;
 
-        auto pipeline = SfmlEventHandler{window_, render_settings_, state_, zoom_clock} |  //
-                        stdexec::let_value([this]() {                                      //
-                            return CalculateMandelbrotAsyncSender{state_, render_settings_, renderer_};
+        auto pipeline = SfmlEventHandler{window_, render_settings_, state_, zoom_clock, recorder_, player_} |  //
+                        stdexec::let_value([this]() {                                                          //
+                            return StreamMandelbrotAsyncSender{state_, render_settings_, tile_stream_};
                         }) |
                         stdexec::let_value([this](RenderResult data) {
-                            return SFMLRender{std::move(data), image_, texture_, sprite_, window_, render_settings_};
+                            hud_.SetVisible(state_.show_hud);
+                            return SFMLRender{std::move(data), texture_, sprite_, window_, render_settings_,
+                                              &frame_stats_, &hud_, stats_log_};
                         }) |  //
-                        stdexec::then(WaitForFPS{frame_clock, 60});
+                        stdexec::then([&frame_pacer]() { frame_pacer.WaitForNextFrame(); });
 
         auto repeated_pipeline =
             std::move(pipeline) | stdexec::then([this]() { return state_.should_exit; }) | exec::repeat_effect_until();
 
         stdexec::sync_wait(std::move(repeated_pipeline));
+
+        const auto frame = frame_stats_.frame_time.GetSummary();
+        const auto present = frame_stats_.present_time.GetSummary();
+        std::println("Frames: {}, frame time p50: {}, p99: {}, max: {}", frame.count, frame.p50, frame.p99, frame.max);
+        std::println("Presents: {}, present time p50: {}, p99: {}, max: {}", present.count, present.p50, present.p99,
+                     present.max);
     }
+
+    [[nodiscard]] const FrameStats &GetFrameStats() const noexcept { return frame_stats_; }
 };
 
-int main() {
+namespace {
+
+struct AppOptions {
+    std::string record_path;
+    std::string replay_path;
+    // Печатать в stderr строку этапов (compute, merge, aa, present) каждого посчитанного кадра
+    bool log_stats = false;
+    PoolKind pool = PoolKind::STATIC;
+};
+
+AppOptions ParseOptions(int argc, char **argv) {
+    AppOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "--log-stats") {
+            options.log_stats = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + std::string{arg});
+        }
+        if (arg == "--record") {
+            options.record_path = argv[++i];
+        } else if (arg == "--replay") {
+            options.replay_path = argv[++i];
+        } else if (arg == "--pool") {
+            options.pool = ParsePoolKind(argv[++i]);
+        } else {
+            throw std::invalid_argument("Unknown option " + std::string{arg});
+        }
+    }
+    if (!options.record_path.empty() && !options.replay_path.empty()) {
+        throw std::invalid_argument("--record and --replay are mutually exclusive");
+    }
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
     try {
-        MandelbrotApp app;
-        app.Run();
+        const auto options = ParseOptions(argc, argv);
+
+        // MANDELBROT_TRACE=path.json включает трассировку конвейера в формате Chrome trace
+        const char *trace_path = std::getenv("MANDELBROT_TRACE");
+        auto &tracer = trace::Tracer::Instance();
+        if (trace_path != nullptr) {
+            tracer.Enable();
+        }
+
+        std::ofstream record_file;
+        std::optional<session::SessionRecorder> recorder;
+        if (!options.record_path.empty()) {
+            record_file.open(options.record_path);
+            if (!record_file) {
+                throw std::runtime_error("Failed to open " + options.record_path);
+            }
+            recorder.emplace(record_file, DEFAULT_SETTINGS, mandelbrot::ViewPort{});
+        }
+
+        std::optional<session::SessionPlayer> player;
+        if (!options.replay_path.empty()) {
+            std::ifstream replay_file{options.replay_path};
+            if (!replay_file) {
+                throw std::runtime_error("Failed to open " + options.replay_path);
+            }
+            player.emplace(session::ReadSession(replay_file));
+        }
+
+        WithRenderer(options.pool, THREAD_POOL_SIZE, [&](auto &renderer) {
+            MandelbrotApp app{renderer, recorder ? &*recorder : nullptr, player ? &*player : nullptr,
+                              options.log_stats ? stderr : nullptr};
+            app.Run();
+        });
+
+        if (recorder) {
+            recorder->Finish();
+            std::println("Recorded {} frames to {}", recorder->FrameCount(), options.record_path);
+        }
+        if (player) {
+            std::println("Replayed {} frames, {} diverged from the recording", player->Frame(), player->Divergences());
+        }
+        if (trace_path != nullptr) {
+            tracer.Disable();
+            tracer.WriteJson(trace_path);
+            std::println("Wrote trace with {} events ({} dropped) to {}", tracer.EventCount(), tracer.DroppedCount(),
+                         trace_path);
+        }
     } catch (const std::exception &e) {
         std::println("Error: {}", e.what());
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
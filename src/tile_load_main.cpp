@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <print>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cli_utils.hpp"
+#include "frame_pacer.hpp"
+#include "net_utils.hpp"
+
+// Нагрузочный клиент для сервера тайлов: несколько соединений keep-alive запрашивают тайлы с перекрытием,
+// как при одновременном просмотре одной области карты, и измеряют пропускную способность и задержки
+
+namespace {
+
+struct LoadOptions {
+    std::string host{"127.0.0.1"};
+    std::uint16_t port{8080};
+    std::uint32_t clients{16};
+    std::uint32_t requests{2000};
+    // Тайлы выбираются из уровней 0..max_zoom
+    std::uint32_t max_zoom{6};
+    std::uint32_t seed{1};
+};
+
+void PrintUsage() {
+    std::println("Usage: MandelbrotFractal_tile_load [options]\n"
+                 "  --host ADDR      server address (default 127.0.0.1)\n"
+                 "  --port N         server port (default 8080)\n"
+                 "  --clients N      concurrent connections (default 16)\n"
+                 "  --requests N     total tile requests (default 2000)\n"
+                 "  --zoom N         deepest zoom level requested (default 6)\n"
+                 "  --seed N         random seed (default 1)");
+}
+
+struct Response {
+    std::string status;
+    std::string body;
+};
+
+std::optional<Response> Get(const net::Socket &socket, net::LineReader &reader, std::string_view path) {
+    const auto request = std::format("GET {} HTTP/1.1\r\nHost: localhost\r\n\r\n", path);
+    if (!net::SendAll(socket, request)) {
+        return std::nullopt;
+    }
+    const auto header = reader.ReadUntil("\r\n\r\n", 8192);
+    if (!header) {
+        return std::nullopt;
+    }
+    constexpr std::string_view LENGTH = "Content-Length: ";
+    const auto pos = header->find(LENGTH);
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    const auto length = std::stoull(header->substr(pos + LENGTH.size()));
+    auto body = reader.ReadExact(length);
+    if (!body) {
+        return std::nullopt;
+    }
+    return Response{header->substr(0, header->find("\r\n")), std::move(*body)};
+}
+
+// Уровень зума выбирается с весом 2^z (как при равномерном панорамировании), тайл — из окрестности центра
+// уровня, поэтому разные клиенты часто просят одни и те же тайлы одновременно
+std::string RandomTilePath(std::mt19937 &rng, std::uint32_t max_zoom) {
+    std::uniform_int_distribution<std::uint64_t> level_pick{1, (2ull << max_zoom) - 1};
+    std::uint32_t z = 0;
+    for (auto v = level_pick(rng); v > 1; v >>= 1) {
+        ++z;
+    }
+    const auto tiles = 1u << z;
+    const auto spread = std::max(tiles / 4, 1u);
+    std::uniform_int_distribution<std::uint32_t> offset{0, spread - 1};
+    const auto x = std::min(tiles / 2 - std::min(tiles / 2, spread / 2) + offset(rng), tiles - 1);
+    const auto y = std::min(tiles / 2 - std::min(tiles / 2, spread / 2) + offset(rng), tiles - 1);
+    return std::format("/{}/{}/{}.png", z, x, y);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    LoadOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg{argv[i]};
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string{arg});
+            }
+            const std::string_view value{argv[++i]};
+            if (arg == "--host") {
+                options.host = value;
+            } else if (arg == "--port") {
+                options.port = cli::ParseNumber<std::uint16_t>(value, arg);
+            } else if (arg == "--clients") {
+                options.clients = std::max(cli::ParseNumber<std::uint32_t>(value, arg), 1u);
+            } else if (arg == "--requests") {
+                options.requests = cli::ParseNumber<std::uint32_t>(value, arg);
+            } else if (arg == "--zoom") {
+                options.max_zoom = std::min(cli::ParseNumber<std::uint32_t>(value, arg), 29u);
+            } else if (arg == "--seed") {
+                options.seed = cli::ParseNumber<std::uint32_t>(value, arg);
+            } else {
+                throw std::invalid_argument("Unknown option " + std::string{arg});
+            }
+        }
+    } catch (const std::exception &e) {
+        std::println("Error: {}", e.what());
+        PrintUsage();
+        return 2;
+    }
+
+    LatencyHistogram latency;
+    std::atomic<std::uint32_t> next_request{0};
+    std::atomic<std::uint32_t> errors{0};
+    std::atomic<std::uint64_t> bytes{0};
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (std::uint32_t c = 0; c < options.clients; ++c) {
+        clients.emplace_back([&, c] {
+            std::mt19937 rng{options.seed * 7919 + c};
+            try {
+                auto socket = net::ConnectTcp(options.host, options.port);
+                net::LineReader reader{socket};
+                while (next_request.fetch_add(1, std::memory_order_relaxed) < options.requests) {
+                    const auto request_start = std::chrono::steady_clock::now();
+                    const auto response = Get(socket, reader, RandomTilePath(rng, options.max_zoom));
+                    if (!response || !response->status.ends_with("200 OK")) {
+                        errors.fetch_add(1, std::memory_order_relaxed);
+                        if (!response) {
+                            return;
+                        }
+                        continue;
+                    }
+                    latency.Record(std::chrono::steady_clock::now() - request_start);
+                    bytes.fetch_add(response->body.size(), std::memory_order_relaxed);
+                }
+            } catch (const std::exception &e) {
+                std::println("Client {}: {}", c, e.what());
+                errors.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto summary = latency.GetSummary();
+    std::println("{} tiles in {:.2f} s: {:.1f} tiles/s, {:.1f} MiB/s, {} errors", summary.count, seconds,
+                 summary.count / seconds, bytes.load() / seconds / (1 << 20), errors.load());
+    std::println("Latency p50 {} us, p99 {} us, max {} us", summary.p50.count(), summary.p99.count(),
+                 summary.max.count());
+
+    try {
+        auto socket = net::ConnectTcp(options.host, options.port);
+        net::LineReader reader{socket};
+        if (const auto stats = Get(socket, reader, "/stats")) {
+            std::println("Server: {}", stats->body);
+        }
+    } catch (const std::exception &e) {
+        std::println("Cannot fetch server stats: {}", e.what());
+    }
+    return errors.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "cli_utils.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "renderer_pool.hpp"
+#include "tile_server.hpp"
+
+// Локальный сервер тайлов для веб-карт: GET http://127.0.0.1:8080/z/x/y.png, статистика — GET /stats
+
+namespace {
+
+void PrintUsage() {
+    std::println("Usage: MandelbrotFractal_tile_server [options]\n"
+                 "  --host ADDR          listen address (default 127.0.0.1)\n"
+                 "  --port N             listen port, 0 picks a free one (default 8080)\n"
+                 "  --iterations N       iteration cap per tile (default 500)\n"
+                 "  --cache N            tiles kept in the LRU cache (default 4096)\n"
+                 "  --max-renders N      tiles rendered at the same time (default {})\n"
+                 "  --threads N          render thread pool size (default {})\n"
+                 "  --pool static|ws     render thread pool: static or work-stealing (default static)",
+                 THREAD_POOL_SIZE, THREAD_POOL_SIZE);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    tiles::TileServerOptions options;
+    std::uint32_t threads = THREAD_POOL_SIZE;
+    PoolKind pool = PoolKind::STATIC;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg{argv[i]};
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string{arg});
+            }
+            const std::string_view value{argv[++i]};
+            if (arg == "--host") {
+                options.host = value;
+            } else if (arg == "--port") {
+                options.port = cli::ParseNumber<std::uint16_t>(value, arg);
+            } else if (arg == "--iterations") {
+                options.service.max_iterations = cli::ParseNumber<std::uint32_t>(value, arg);
+            } else if (arg == "--cache") {
+                options.service.cache_tiles = cli::ParseNumber<std::uint32_t>(value, arg);
+            } else if (arg == "--max-renders") {
+                options.service.max_renders_in_flight = cli::ParseNumber<std::uint32_t>(value, arg);
+            } else if (arg == "--threads") {
+                threads = cli::ParseNumber<std::uint32_t>(value, arg);
+            } else if (arg == "--pool") {
+                pool = ParsePoolKind(value);
+            } else {
+                throw std::invalid_argument("Unknown option " + std::string{arg});
+            }
+        }
+    } catch (const std::exception &e) {
+        std::println("Error: {}", e.what());
+        PrintUsage();
+        return 2;
+    }
+
+    // Сигналы остановки принимаются синхронно в главном потоке, рабочие потоки их не видят
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        WithRenderer(pool, threads, [&](auto &renderer) {
+            tiles::BasicTileServer server{renderer, options};
+            server.Start();
+            std::println("Serving tiles on http://{}:{}/{{z}}/{{x}}/{{y}}.png with the {} pool, stats on /stats "
+                         "(Ctrl+C to stop)",
+                         options.host, server.Port(), PoolKindName(pool));
+
+            int signal = 0;
+            sigwait(&signals, &signal);
+            server.Stop();
+            std::println("{}", tiles::TileServer::StatsJson(server.Service().GetStats()));
+        });
+    } catch (const std::exception &e) {
+        std::println("Error: {}", e.what());
+        return 1;
+    }
+    return 0;
+}
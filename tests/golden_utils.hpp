@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+
+#include "canonical_viewports.hpp"
+#include "mandelbrot_fractal_utils.hpp"
+#include "types.hpp"
+
+// Эталон для проверки оптимизированных путей рендера: итерации каждого пикселя считаются прямым вызовом
+// скалярного CalculateIterationsForPoint, без разбиения на области и без пула. Любой другой путь сравнивается
+// с ним попиксельно — точно или с объявленным допуском.
+
+namespace golden {
+
+inline constexpr std::uint32_t GOLDEN_WIDTH = 96;
+inline constexpr std::uint32_t GOLDEN_HEIGHT = 72;
+
+[[nodiscard]] inline RenderSettings MakeSettings(const CanonicalViewport &canonical) {
+    return RenderSettings{.width = GOLDEN_WIDTH, .height = GOLDEN_HEIGHT, .max_iterations = canonical.max_iterations};
+}
+
+[[nodiscard]] inline PixelMatrix ReferenceIterations(const mandelbrot::ViewPort &viewport,
+                                                     const RenderSettings &settings) {
+    PixelMatrix result(settings.height, std::vector<std::uint32_t>(settings.width));
+    for (std::uint32_t y = 0; y < settings.height; ++y) {
+        for (std::uint32_t x = 0; x < settings.width; ++x) {
+            const auto c = mandelbrot::Pixel2DToComplex(x, y, viewport, settings.width, settings.height);
+            result[y][x] = mandelbrot::CalculateIterationsForPoint(c, settings.max_iterations, settings.escape_radius);
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] inline RgbaBuffer ReferenceRgba(const PixelMatrix &iterations, const RenderSettings &settings) {
+    RgbaBuffer rgba(static_cast<std::size_t>(settings.width) * settings.height * RGBA_CHANNELS);
+    auto *dst = rgba.data();
+    for (const auto &row : iterations) {
+        for (const auto it : row) {
+            StoreRgba(dst, mandelbrot::IterationsToColor(it, settings.max_iterations));
+            dst += RGBA_CHANNELS;
+        }
+    }
+    return rgba;
+}
+
+// Допуск пути: насколько может отличаться пиксель и какая доля пикселей вправе отличаться вообще.
+// Точные пути объявляют нулевой допуск.
+struct Tolerance {
+    std::uint32_t pixel{0};
+    double mismatch_percent{0.0};
+};
+
+struct Comparison {
+    std::uint64_t pixels{};
+    // Пиксели, отличающиеся от эталона хоть на сколько-нибудь, и отличающиеся больше допуска
+    std::uint64_t mismatched{};
+    std::uint64_t over_tolerance{};
+    std::uint32_t max_diff{};
+    bool size_mismatch{false};
+
+    [[nodiscard]] double MismatchPercent() const noexcept {
+        return pixels == 0 ? 0.0 : 100.0 * static_cast<double>(mismatched) / static_cast<double>(pixels);
+    }
+
+    [[nodiscard]] bool Within(const Tolerance &tolerance) const noexcept {
+        return !size_mismatch && over_tolerance == 0 && MismatchPercent() <= tolerance.mismatch_percent;
+    }
+};
+
+[[nodiscard]] inline Comparison CompareIterations(const PixelMatrix &reference, const PixelMatrix &candidate,
+                                                  const Tolerance &tolerance) {
+    Comparison comparison;
+    if (candidate.size() != reference.size()) {
+        comparison.size_mismatch = true;
+        return comparison;
+    }
+    for (std::size_t y = 0; y < reference.size(); ++y) {
+        if (candidate[y].size() != reference[y].size()) {
+            comparison.size_mismatch = true;
+            return comparison;
+        }
+        for (std::size_t x = 0; x < reference[y].size(); ++x) {
+            const auto a = reference[y][x];
+            const auto b = candidate[y][x];
+            const auto diff = a > b ? a - b : b - a;
+            ++comparison.pixels;
+            if (diff != 0) {
+                ++comparison.mismatched;
+                comparison.max_diff = std::max(comparison.max_diff, diff);
+                if (diff > tolerance.pixel) {
+                    ++comparison.over_tolerance;
+                }
+            }
+        }
+    }
+    return comparison;
+}
+
+// Сравнение RGBA для путей, которые отдают только готовые цвета; пиксель совпадает, если совпали все каналы
+[[nodiscard]] inline Comparison CompareRgba(const RgbaBuffer &reference, const RgbaBuffer &candidate) {
+    Comparison comparison;
+    if (candidate.size() != reference.size()) {
+        comparison.size_mismatch = true;
+        return comparison;
+    }
+    for (std::size_t i = 0; i < reference.size(); i += RGBA_CHANNELS) {
+        ++comparison.pixels;
+        std::uint32_t diff = 0;
+        for (std::size_t ch = 0; ch < RGBA_CHANNELS; ++ch) {
+            const auto a = reference[i + ch];
+            const auto b = candidate[i + ch];
+            diff = std::max<std::uint32_t>(diff, a > b ? a - b : b - a);
+        }
+        if (diff != 0) {
+            ++comparison.mismatched;
+            ++comparison.over_tolerance;
+            comparison.max_diff = std::max(comparison.max_diff, diff);
+        }
+    }
+    return comparison;
+}
+
+[[nodiscard]] inline std::string FormatComparison(std::string_view path, std::string_view viewport,
+                                                  const Comparison &comparison) {
+    if (comparison.size_mismatch) {
+        return std::format("{} on {}: buffer size differs from reference", path, viewport);
+    }
+    return std::format("{} on {}: {} of {} px differ ({:.3f}%), {} over tolerance, max diff {}", path, viewport,
+                       comparison.mismatched, comparison.pixels, comparison.MismatchPercent(),
+                       comparison.over_tolerance, comparison.max_diff);
+}
+
+}  // namespace golden
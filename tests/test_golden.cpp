@@ -0,0 +1,195 @@
+#include <exec/inline_scheduler.hpp>
+#include <gtest/gtest.h>
+#include <stdexec/execution.hpp>
+
+#include "canonical_viewports.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "mandelbrot_sender.hpp"
+#include "types.hpp"
+#include "work_stealing_pool.hpp"
+
+#include "golden_utils.hpp"
+
+#include <array>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Эквивалентность оптимизированных путей рендера эталонному скалярному ядру на наборе эталонных областей.
+// Новый путь (другое ядро, другое разбиение, другой планировщик) добавляется строкой в ITERATION_PATHS
+// или RGBA_PATHS вместе с допуском; точные пути объявляют нулевой допуск.
+
+namespace {
+
+struct IterationPath {
+    std::string_view name;
+    golden::Tolerance tolerance;
+    std::function<PixelMatrix(const mandelbrot::ViewPort &, const RenderSettings &)> render;
+};
+
+struct RgbaPath {
+    std::string_view name;
+    std::function<RgbaBuffer(const mandelbrot::ViewPort &, const RenderSettings &)> render;
+};
+
+MandelbrotRenderer &Renderer() {
+    static MandelbrotRenderer renderer{THREAD_POOL_SIZE};
+    return renderer;
+}
+
+const std::vector<IterationPath> ITERATION_PATHS{
+    {"ComputePixelMatrixForRegion", {},
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         return ComputePixelMatrixForRegion(viewport, settings, {0, settings.height, 0, settings.width});
+     }},
+    // Построчно, как banded::RenderBand
+    {"ComputePixelMatrixForRegion rows", {},
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         PixelMatrix result;
+         for (std::uint32_t r = 0; r < settings.height; ++r) {
+             result.push_back(ComputePixelMatrixForRegion(viewport, settings, {r, r + 1, 0, settings.width}).front());
+         }
+         return result;
+     }},
+    // Векторные ядра повторяют скалярное операция в операцию и обязаны совпадать с ним точно
+    {"ComputePixelMatrixForRegion simd", {},
+     [](const mandelbrot::ViewPort &viewport, RenderSettings settings) {
+         settings.kernel = mandelbrot::Kernel::SIMD;
+         return ComputePixelMatrixForRegion(viewport, settings, {0, settings.height, 0, settings.width});
+     }},
+    {"ComputePixelMatrixForRegion simd streaming", {},
+     [](const mandelbrot::ViewPort &viewport, RenderSettings settings) {
+         settings.kernel = mandelbrot::Kernel::SIMD_STREAMING;
+         return ComputePixelMatrixForRegion(viewport, settings, {0, settings.height, 0, settings.width});
+     }},
+    // Ядро со всеми каналами ведёт те же итерации, что и ядро одних итераций
+    {"ComputePixelMatrixForRegion all channels", {},
+     [](const mandelbrot::ViewPort &viewport, RenderSettings settings) {
+         settings.channels = mandelbrot::Channels::ALL;
+         ChannelBuffers channels;
+         return ComputePixelMatrixForRegion(viewport, settings, {0, settings.height, 0, settings.width}, &channels);
+     }},
+    {"RenderAsync simd streaming", {},
+     [](const mandelbrot::ViewPort &viewport, RenderSettings settings) {
+         settings.kernel = mandelbrot::Kernel::SIMD_STREAMING;
+         auto [result] = *stdexec::sync_wait(Renderer().RenderAsync<THREAD_POOL_SIZE>(viewport, settings));
+         return std::move(result.pixel_data);
+     }},
+    {"RenderAsync", {},
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         auto [result] = *stdexec::sync_wait(Renderer().RenderAsync<THREAD_POOL_SIZE>(viewport, settings));
+         return std::move(result.pixel_data);
+     }},
+    {"RenderAsync inline scheduler", {},
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         BasicMandelbrotRenderer renderer{exec::inline_scheduler{}};
+         auto [result] = *stdexec::sync_wait(renderer.RenderAsync<THREAD_POOL_SIZE>(viewport, settings));
+         return std::move(result.pixel_data);
+     }},
+    {"RenderAsync work-stealing pool", {},
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         static ws::WorkStealingPool pool{THREAD_POOL_SIZE};
+         BasicMandelbrotRenderer renderer{pool.GetScheduler()};
+         auto [result] = *stdexec::sync_wait(renderer.RenderAsync<THREAD_POOL_SIZE>(viewport, settings));
+         return std::move(result.pixel_data);
+     }},
+    // Кадр из четырёх прямоугольников, каждый со своими границами столбцов
+    {"RenderRegionAsync quadrants", {},
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         auto frame = MakeFrameResult(viewport, settings);
+         const auto half_w = settings.width / 2;
+         const auto half_h = settings.height / 2;
+         const std::array<PixelRegion, 4> quadrants{{{0, half_h, 0, half_w},
+                                                     {0, half_h, half_w, settings.width},
+                                                     {half_h, settings.height, 0, half_w},
+                                                     {half_h, settings.height, half_w, settings.width}}};
+         for (const auto &region : quadrants) {
+             auto [matrix] =
+                 *stdexec::sync_wait(Renderer().RenderRegionAsync<THREAD_POOL_SIZE>(viewport, settings, region));
+             MergeStrip(frame, region, matrix);
+         }
+         return std::move(frame.pixel_data);
+     }},
+};
+
+const std::vector<RgbaPath> RGBA_PATHS{
+    {"RenderAsync rgba",
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         auto [result] = *stdexec::sync_wait(Renderer().RenderAsync<THREAD_POOL_SIZE>(viewport, settings));
+         return std::move(result.rgba_data);
+     }},
+    {"StreamTilesAsync",
+     [](const mandelbrot::ViewPort &viewport, const RenderSettings &settings) {
+         RgbaBuffer rgba(static_cast<std::size_t>(settings.width) * settings.height * RGBA_CHANNELS);
+         std::mutex mutex;
+         auto sink = [&](RenderedTile &&tile) {
+             std::lock_guard lock{mutex};
+             const auto &region = tile.region;
+             const auto row_bytes = static_cast<std::size_t>(region.end_col - region.start_col) * RGBA_CHANNELS;
+             for (std::uint32_t r = region.start_row; r < region.end_row; ++r) {
+                 std::memcpy(rgba.data() + (static_cast<std::size_t>(r) * settings.width + region.start_col) *
+                                               RGBA_CHANNELS,
+                             tile.rgba.data() + (r - region.start_row) * row_bytes, row_bytes);
+             }
+             return true;
+         };
+         (void)stdexec::sync_wait(Renderer().StreamTilesAsync<THREAD_POOL_SIZE>(viewport, settings, 7, sink));
+         return rgba;
+     }},
+};
+
+}  // namespace
+
+// --------------------- Golden iteration tests ---------------------
+TEST(Golden, IterationPathsMatchReference) {
+    for (const auto &canonical : CANONICAL_VIEWPORTS) {
+        const auto settings = golden::MakeSettings(canonical);
+        const auto reference = golden::ReferenceIterations(canonical.viewport, settings);
+        for (const auto &path : ITERATION_PATHS) {
+            const auto comparison =
+                golden::CompareIterations(reference, path.render(canonical.viewport, settings), path.tolerance);
+            const auto report = golden::FormatComparison(path.name, canonical.name, comparison);
+            EXPECT_TRUE(comparison.Within(path.tolerance)) << report;
+            RecordProperty(std::string{path.name} + "/" + std::string{canonical.name}, report);
+        }
+    }
+}
+
+// --------------------- Golden RGBA tests ---------------------
+TEST(Golden, RgbaPathsMatchReference) {
+    for (const auto &canonical : CANONICAL_VIEWPORTS) {
+        const auto settings = golden::MakeSettings(canonical);
+        const auto reference =
+            golden::ReferenceRgba(golden::ReferenceIterations(canonical.viewport, settings), settings);
+        for (const auto &path : RGBA_PATHS) {
+            const auto comparison = golden::CompareRgba(reference, path.render(canonical.viewport, settings));
+            EXPECT_TRUE(comparison.Within({})) << golden::FormatComparison(path.name, canonical.name, comparison);
+        }
+    }
+}
+
+// --------------------- Golden harness tests ---------------------
+TEST(Golden, ComparisonReportsMismatchAndTolerance) {
+    const PixelMatrix reference{{1, 2, 3, 4}, {5, 6, 7, 8}};
+    PixelMatrix candidate = reference;
+    candidate[0][1] = 3;
+    candidate[1][3] = 11;
+
+    const auto exact = golden::CompareIterations(reference, candidate, {});
+    EXPECT_EQ(exact.pixels, 8u);
+    EXPECT_EQ(exact.mismatched, 2u);
+    EXPECT_EQ(exact.over_tolerance, 2u);
+    EXPECT_EQ(exact.max_diff, 3u);
+    EXPECT_DOUBLE_EQ(exact.MismatchPercent(), 25.0);
+    EXPECT_FALSE(exact.Within({}));
+
+    const golden::Tolerance loose{.pixel = 3, .mismatch_percent = 30.0};
+    EXPECT_TRUE(golden::CompareIterations(reference, candidate, loose).Within(loose));
+    const golden::Tolerance few{.pixel = 3, .mismatch_percent = 10.0};
+    EXPECT_FALSE(golden::CompareIterations(reference, candidate, few).Within(few));
+
+    candidate.pop_back();
+    EXPECT_TRUE(golden::CompareIterations(reference, candidate, loose).size_mismatch);
+}
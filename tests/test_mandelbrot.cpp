@@ -1,94 +1,57 @@
-#include <exec/repeat_effect_until.hpp>
+#include <exec/async_scope.hpp>
+#include <exec/inline_scheduler.hpp>
 #include <exec/static_thread_pool.hpp>
 #include <gtest/gtest.h>
 #include <stdexec/execution.hpp>
 
+#include "adaptive_aa.hpp"
+#include "banded_renderer.hpp"
+#include "canonical_viewports.hpp"
+#include "cli_utils.hpp"
+#include "dirty_regions.hpp"
+#include "distributed.hpp"
+#include "frame_pacer.hpp"
+#include "hud_stats.hpp"
+#include "image_writer.hpp"
+#include "input_session.hpp"
+#include "iteration_histogram.hpp"
 #include "mandelbrot.hpp"
 #include "mandelbrot_fractal_utils.hpp"
 #include "mandelbrot_renderer.hpp"
 #include "mandelbrot_sender.hpp"
-#include "sfml_events_handler.hpp"
-#include "sfml_renderer.hpp"
+#include "perf_counters.hpp"
+#include "render_stats.hpp"
+#include "renderer_pool.hpp"
+#include "simd_kernel.hpp"
+#include "tile_queue.hpp"
+#include "tile_server.hpp"
+#include "tile_stream.hpp"
+#include "trace.hpp"
 #include "types.hpp"
+#include "work_stealing_pool.hpp"
+#include "zoom_animation.hpp"
 
-#include <SFML/Graphics.hpp>
+#include "test_utils.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <numeric>
 #include <optional>
+#include <sstream>
 #include <thread>
 
-using namespace std::chrono_literals;
+#ifdef MANDELBROT_HAS_ZLIB
+#include <zlib.h>
+#endif
 
-namespace testutil {
-
-template <class... Ts>
-struct ValueHolder {
-    std::tuple<std::optional<Ts>...> values;
-    std::optional<std::exception_ptr> err;
-    bool stopped = false;
-};
-
-template <class Holder>
-struct Receiver {
-    using receiver_concept = stdexec::receiver_t;
-    Holder *holder;
-
-    template <class... Vs>
-    friend void tag_invoke(stdexec::set_value_t, Receiver &&self, Vs &&...vs) noexcept {
-        self.store(std::forward<Vs>(vs)...);
-    }
-    friend void tag_invoke(stdexec::set_error_t, Receiver &&self, std::exception_ptr e) noexcept {
-        self.holder->err = e;
-    }
-    friend void tag_invoke(stdexec::set_stopped_t, Receiver &&self) noexcept { self.holder->stopped = true; }
-
-private:
-    template <class... Vs, std::size_t... Is>
-    void store_impl(std::index_sequence<Is...>, Vs &&...vs) noexcept {
-        (void)std::initializer_list<int>{((std::get<Is>(holder->values) = std::forward<Vs>(vs)), 0)...};
-    }
-    template <class... Vs>
-    void store(Vs &&...vs) noexcept {
-        store_impl(std::make_index_sequence<sizeof...(Vs)>{}, std::forward<Vs>(vs)...);
-    }
-};
-
-}  // namespace testutil
-
-static RenderSettings SmallSettings(unsigned w = 64, unsigned h = 48, unsigned it = 64, double R = 2.0) {
-    RenderSettings rs;
-    rs.width = w;
-    rs.height = h;
-    rs.max_iterations = it;
-    rs.escape_radius = R;
-    return rs;
-}
-
-class FrameClock {
-public:
-    FrameClock() { Reset(); }
-    void Reset() noexcept { frame_start_ = std::chrono::steady_clock::now(); }
-    auto GetFrameTime() const noexcept { return std::chrono::steady_clock::now() - frame_start_; }
-
-private:
-    std::chrono::time_point<std::chrono::steady_clock> frame_start_;
-};
-
-class WaitForFPS {
-public:
-    WaitForFPS(FrameClock &clock, int fps) : clock_(clock), target_fps_(fps) {}
-    void operator()() {
-        auto elapsed = clock_.GetFrameTime();
-        auto target_duration = std::chrono::milliseconds(1000 / target_fps_);
-        if (elapsed < target_duration) {
-            std::this_thread::sleep_for(target_duration - elapsed);
-        }
-        clock_.Reset();
-    }
-
-private:
-    FrameClock &clock_;
-    int target_fps_;
-};
+using namespace std::chrono_literals;
 
 // --------------------- Utils tests ---------------------
 TEST(Utils, CalculateIterationsKnownPoints) {
@@ -111,6 +74,95 @@ TEST(Utils, PixelToComplexMappingCenterAroundZero) {
     EXPECT_NEAR(c.imag(), 0.0, vp.height() / static_cast<double>(rs.height));
 }
 
+TEST(Utils, ParsesCommandLineNumbersAndLists) {
+    EXPECT_EQ(cli::ParseNumber<std::uint32_t>("1920", "--size"), 1920u);
+    EXPECT_DOUBLE_EQ(cli::ParseNumber<double>("-0.75", "--viewport"), -0.75);
+    EXPECT_THROW((void)cli::ParseNumber<std::uint32_t>("12px", "--size"), std::invalid_argument);
+    EXPECT_THROW((void)cli::ParseNumber<std::uint16_t>("70000", "--port"), std::invalid_argument);
+
+    const auto parts = cli::Split("1,,2", ',');
+    ASSERT_EQ(parts.size(), 3u);
+    EXPECT_EQ(parts[0], "1");
+    EXPECT_TRUE(parts[1].empty());
+    EXPECT_EQ(parts[2], "2");
+}
+
+// --------------------- Kernel channels tests ---------------------
+TEST(KernelChannels, KnownEscapingPoint) {
+    using mandelbrot::Channels;
+    // Орбита c = 1: 0, 1, 2, 5 — выход на третьей итерации, dz/dc: 0, 1, 3, 13
+    const auto point = mandelbrot::CalculateChannelsForPoint<Channels::ALL>(mandelbrot::Complex{1.0, 0.0}, 100, 2.0);
+    EXPECT_EQ(point.iterations, 3u);
+    EXPECT_DOUBLE_EQ(point.final_z.real(), 5.0);
+    EXPECT_DOUBLE_EQ(point.orbit_trap, 1.0);
+    EXPECT_DOUBLE_EQ(point.smooth, 4.0 - std::log2(std::log(5.0)));
+    EXPECT_DOUBLE_EQ(point.distance, 0.5 * 5.0 * std::log(5.0) / 13.0);
+}
+
+TEST(KernelChannels, InsidePointAndUnselectedChannels) {
+    using mandelbrot::Channels;
+    const auto inside = mandelbrot::CalculateChannelsForPoint<Channels::ALL>(mandelbrot::Complex{-1.0, 0.0}, 50, 2.0);
+    EXPECT_EQ(inside.iterations, 50u);
+    EXPECT_DOUBLE_EQ(inside.smooth, 50.0);
+    EXPECT_DOUBLE_EQ(inside.distance, 0.0);
+    EXPECT_DOUBLE_EQ(inside.orbit_trap, 0.0);
+
+    const auto plain = mandelbrot::CalculateChannelsForPoint<Channels::ITERATIONS | Channels::SMOOTH>(
+        mandelbrot::Complex{1.0, 0.0}, 100, 2.0);
+    EXPECT_GT(plain.smooth, 0.0);
+    EXPECT_EQ(plain.distance, 0.0);
+    EXPECT_EQ(plain.final_z, mandelbrot::Complex{});
+    EXPECT_EQ(plain.orbit_trap, 0.0);
+}
+
+TEST(KernelChannels, IterationsDoNotDependOnChannels) {
+    auto rs = SmallSettings(31, 17, 120);
+    const auto &seahorse = *FindCanonicalViewport("seahorse_valley");
+    const auto plain = ComputePixelMatrixForRegion(seahorse.viewport, rs, {0, rs.height, 0, rs.width});
+    for (mandelbrot::ChannelMask mask = 0; mask <= mandelbrot::Channels::ALL; ++mask) {
+        rs.channels = mask;
+        ChannelBuffers channels;
+        EXPECT_EQ(ComputePixelMatrixForRegion(seahorse.viewport, rs, {0, rs.height, 0, rs.width}, &channels), plain)
+            << "mask " << mask;
+    }
+}
+
+TEST(KernelChannels, RenderAsyncAllocatesOnlySelectedBuffers) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(29, 19, 80);
+    rs.channels = mandelbrot::Channels::SMOOTH | mandelbrot::Channels::ORBIT_TRAP;
+    const mandelbrot::ViewPort vp;
+
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+
+    const auto pixels = static_cast<std::size_t>(rs.width) * rs.height;
+    ASSERT_EQ(result.channels.smooth.size(), pixels);
+    ASSERT_EQ(result.channels.orbit_trap.size(), pixels);
+    EXPECT_TRUE(result.channels.distance.empty());
+    EXPECT_TRUE(result.channels.final_z.empty());
+    // Без ITERATIONS кадр не хранит итерации и их раскраску
+    EXPECT_TRUE(result.pixel_data.empty());
+    EXPECT_TRUE(result.rgba_data.empty());
+    for (std::uint32_t y = 0; y < rs.height; y += 5) {
+        for (std::uint32_t x = 0; x < rs.width; x += 3) {
+            const auto point = mandelbrot::CalculateChannelsForPoint<mandelbrot::Channels::ALL>(
+                mandelbrot::Pixel2DToComplex(x, y, vp, rs.width, rs.height), rs.max_iterations, rs.escape_radius);
+            const auto index = static_cast<std::size_t>(y) * rs.width + x;
+            EXPECT_EQ(result.channels.smooth[index], point.smooth);
+            EXPECT_EQ(result.channels.orbit_trap[index], point.orbit_trap);
+        }
+    }
+
+    rs.channels = mandelbrot::Channels::ITERATIONS;
+    const auto plain = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+    EXPECT_TRUE(plain.channels.smooth.empty());
+    ASSERT_EQ(plain.pixel_data.size(), rs.height);
+    EXPECT_EQ(plain.rgba_data.size(), pixels * RGBA_CHANNELS);
+    EXPECT_EQ(plain.pixel_data[7][11],
+              mandelbrot::CalculateIterationsForPoint(mandelbrot::Pixel2DToComplex(11, 7, vp, rs.width, rs.height),
+                                                      rs.max_iterations, rs.escape_radius));
+}
+
 // --------------------- MandelbrotSender tests ---------------------
 TEST(MandelbrotSender, ComputesRegionMatrix) {
     auto rs = SmallSettings(32, 24, 50);
@@ -125,6 +177,118 @@ TEST(MandelbrotSender, ComputesRegionMatrix) {
     EXPECT_EQ(mat[0][0], it);
 }
 
+TEST(MandelbrotSender, HonorsColumnBounds) {
+    auto rs = SmallSettings(32, 24, 50);
+    mandelbrot::ViewPort vp;
+    const auto full = ComputePixelMatrixForRegion(vp, rs, {0, rs.height, 0, rs.width});
+    const PixelRegion region{.start_row = 3, .end_row = 9, .start_col = 7, .end_col = 20};
+
+    const auto mat = ComputePixelMatrixForRegion(vp, rs, region);
+    ASSERT_EQ(mat.size(), 6u);
+    for (std::uint32_t r = 0; r < mat.size(); ++r) {
+        ASSERT_EQ(mat[r].size(), 13u);
+        for (std::uint32_t c = 0; c < mat[r].size(); ++c) {
+            EXPECT_EQ(mat[r][c], full[region.start_row + r][region.start_col + c]);
+        }
+    }
+}
+
+TEST(MandelbrotSender, ClampsRegionToFrame) {
+    auto rs = SmallSettings(16, 8, 20);
+    const auto clipped = ComputePixelMatrixForRegion(mandelbrot::ViewPort{}, rs, {6, 40, 12, 99});
+    ASSERT_EQ(clipped.size(), 2u);
+    EXPECT_EQ(clipped[0].size(), 4u);
+    EXPECT_TRUE(ComputePixelMatrixForRegion(mandelbrot::ViewPort{}, rs, {5, 3, 0, rs.width}).empty());
+    EXPECT_TRUE(ComputePixelMatrixForRegion(mandelbrot::ViewPort{}, rs, {0, 2, 20, 30}).front().empty());
+}
+
+TEST(MandelbrotRenderer, RenderRegionAsyncComputesSubRectangle) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(40, 30, 64);
+    mandelbrot::ViewPort vp;
+    const PixelRegion region{.start_row = 4, .end_row = 7, .start_col = 10, .end_col = 31};
+
+    auto result = stdexec::sync_wait(renderer.RenderRegionAsync<4>(vp, rs, region));
+    ASSERT_TRUE(result.has_value());
+    const auto &mat = std::get<0>(*result);
+    // Строк меньше, чем частей: лишние части пустые, порядок строк сохраняется
+    EXPECT_EQ(mat, ComputePixelMatrixForRegion(vp, rs, region));
+
+    auto frame = MakeFrameResult(vp, rs);
+    MergeStrip(frame, region, mat);
+    EXPECT_EQ(frame.pixel_data[5][10], mat[1][0]);
+    EXPECT_EQ(frame.pixel_data[5][9], 0u);
+}
+
+TEST(MandelbrotRenderer, RenderTileKeepsColumnOffset) {
+    auto rs = SmallSettings(24, 12, 32);
+    const auto tile = RenderTile(mandelbrot::ViewPort{}, rs, {2, 5, 8, 16});
+    EXPECT_EQ(tile.region.start_col, 8u);
+    EXPECT_EQ(tile.region.end_col, 16u);
+    EXPECT_EQ(tile.rgba.size(), 3u * 8u * RGBA_CHANNELS);
+}
+
+// --------------------- SIMD kernel tests ---------------------
+TEST(SimdKernel, RowsMatchScalarKernel) {
+    const auto &seahorse = *FindCanonicalViewport("seahorse_valley");
+    // Ширина не кратна числу дорожек, столбцы начинаются не с нуля
+    const std::uint32_t width = 67;
+    const std::uint32_t height = 9;
+    for (std::uint32_t y = 0; y < height; ++y) {
+        std::vector<std::uint32_t> fixed(width - 3);
+        std::vector<std::uint32_t> streaming(width - 3);
+        mandelbrot::simd::ComputeRowFixed(seahorse.viewport, width, height, y, 3, width, seahorse.max_iterations, 2.0,
+                                          fixed.data());
+        mandelbrot::simd::ComputeRowStreaming(seahorse.viewport, width, height, y, 3, width, seahorse.max_iterations,
+                                              2.0, streaming.data());
+        for (std::uint32_t x = 3; x < width; ++x) {
+            const auto c = mandelbrot::Pixel2DToComplex(x, y, seahorse.viewport, width, height);
+            const auto expected = mandelbrot::CalculateIterationsForPoint(c, seahorse.max_iterations, 2.0);
+            EXPECT_EQ(fixed[x - 3], expected) << "fixed x=" << x << " y=" << y;
+            EXPECT_EQ(streaming[x - 3], expected) << "streaming x=" << x << " y=" << y;
+        }
+    }
+}
+
+TEST(SimdKernel, HandlesRowsShorterThanLanes) {
+    std::uint32_t out[2]{};
+    mandelbrot::simd::ComputeRowStreaming(mandelbrot::ViewPort{}, 16, 8, 4, 7, 9, 50, 2.0, out);
+    EXPECT_EQ(out[0], mandelbrot::CalculateIterationsForPoint(
+                          mandelbrot::Pixel2DToComplex(7, 4, mandelbrot::ViewPort{}, 16, 8), 50, 2.0));
+    EXPECT_EQ(out[1], mandelbrot::CalculateIterationsForPoint(
+                          mandelbrot::Pixel2DToComplex(8, 4, mandelbrot::ViewPort{}, 16, 8), 50, 2.0));
+    // Пустая строка ничего не пишет
+    mandelbrot::simd::ComputeRowFixed(mandelbrot::ViewPort{}, 16, 8, 4, 5, 5, 50, 2.0, nullptr);
+}
+
+TEST(SimdKernel, StreamingKeepsLanesBusierOnBoundary) {
+    const auto &seahorse = *FindCanonicalViewport("seahorse_valley");
+    const std::uint32_t size = 64;
+    std::vector<std::uint32_t> row(size);
+    mandelbrot::simd::LaneStats fixed;
+    mandelbrot::simd::LaneStats streaming;
+    for (std::uint32_t y = 0; y < size; ++y) {
+        mandelbrot::simd::ComputeRowFixed(seahorse.viewport, size, size, y, 0, size, seahorse.max_iterations, 2.0,
+                                          row.data(), &fixed);
+        mandelbrot::simd::ComputeRowStreaming(seahorse.viewport, size, size, y, 0, size, seahorse.max_iterations, 2.0,
+                                              row.data(), &streaming);
+    }
+    EXPECT_GT(streaming.Utilization(), fixed.Utilization());
+    EXPECT_LE(streaming.Utilization(), 1.0);
+    EXPECT_LT(streaming.lane_steps, fixed.lane_steps);
+}
+
+TEST(SimdKernel, SelectedThroughRenderSettings) {
+    auto rs = SmallSettings(45, 20, 80);
+    const PixelRegion region{2, 18, 5, 41};
+    const auto scalar = ComputePixelMatrixForRegion(mandelbrot::ViewPort{}, rs, region);
+    for (const auto kernel : {mandelbrot::Kernel::SIMD, mandelbrot::Kernel::SIMD_STREAMING}) {
+        rs.kernel = kernel;
+        EXPECT_EQ(ComputePixelMatrixForRegion(mandelbrot::ViewPort{}, rs, region), scalar)
+            << mandelbrot::KernelName(kernel);
+    }
+}
+
 // --------------------- MandelbrotRenderer::RenderAsync tests ---------------------
 TEST(MandelbrotRenderer, RenderAsyncCombinesStripsAndColors) {
     MandelbrotRenderer renderer(4);
@@ -138,15 +302,14 @@ TEST(MandelbrotRenderer, RenderAsyncCombinesStripsAndColors) {
 
     ASSERT_EQ(result.pixel_data.size(), rs.height);
     ASSERT_EQ(result.pixel_data[0].size(), rs.width);
-    ASSERT_EQ(result.color_data.size(), rs.height);
-    ASSERT_EQ(result.color_data[0].size(), rs.width);
+    const auto colors = UnpackRgbaToColors(result.rgba_data, rs.width, rs.height);
 
     std::uint32_t cx = static_cast<std::uint32_t>(static_cast<double>(rs.width) * (0.0 - vp.x_min) / vp.width());
     std::uint32_t cy = static_cast<std::uint32_t>(static_cast<double>(rs.height) * (0.0 - vp.y_min) / vp.height());
     ASSERT_LT(cx, rs.width);
     ASSERT_LT(cy, rs.height);
     auto it = result.pixel_data[cy][cx];
-    auto col = result.color_data[cy][cx];
+    auto col = colors[cy][cx];
     if (it == rs.max_iterations) {
         EXPECT_EQ(col.r, 0u);
         EXPECT_EQ(col.g, 0u);
@@ -154,6 +317,1105 @@ TEST(MandelbrotRenderer, RenderAsyncCombinesStripsAndColors) {
     }
 }
 
+TEST(MandelbrotRenderer, RenderAsyncFillsContiguousRgba) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(37, 23, 64);
+    mandelbrot::ViewPort vp;
+
+    auto tup = stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs));
+    ASSERT_TRUE(tup.has_value());
+    auto result = std::get<0>(*tup);
+
+    ASSERT_EQ(result.rgba_data.size(), static_cast<std::size_t>(rs.width) * rs.height * RGBA_CHANNELS);
+    RgbaBuffer packed;
+    PackColorsToRgba(UnpackRgbaToColors(result.rgba_data, rs.width, rs.height), rs.width, rs.height, packed);
+    EXPECT_EQ(packed, result.rgba_data);
+}
+
+TEST(MandelbrotRenderer, RenderAsyncFillsStats) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(40, 30, 64);
+
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, rs)));
+
+    std::uint64_t iterations = 0;
+    for (const auto &row : result.pixel_data) {
+        iterations = std::accumulate(row.begin(), row.end(), iterations);
+    }
+    const auto &stats = result.stats;
+    EXPECT_EQ(stats.total_iterations, iterations);
+    EXPECT_EQ(stats.pixels_computed, static_cast<std::uint64_t>(rs.width) * rs.height);
+    EXPECT_EQ(stats.pixels_filled, 0u);
+    ASSERT_EQ(stats.worker_busy.size(), 4u);
+    EXPECT_GT(stats.compute.count(), 0);
+    EXPECT_GE(stats.compute, stats.MaxWorkerBusy());
+    EXPECT_GE(stats.LoadImbalance(), 1.0);
+    EXPECT_EQ(result.render_time,
+              std::chrono::duration_cast<std::chrono::milliseconds>(stats.partition + stats.compute + stats.merge) +
+                  std::chrono::duration_cast<std::chrono::milliseconds>(stats.antialias));
+}
+
+TEST(RenderStats, LoadImbalanceAndLogLine) {
+    RenderStats stats;
+    EXPECT_DOUBLE_EQ(stats.LoadImbalance(), 1.0);
+
+    stats.worker_busy = {10ms, 20ms, 30ms, 40ms};
+    stats.compute = 40ms;
+    stats.total_iterations = 1234;
+    EXPECT_EQ(stats.MaxWorkerBusy(), 40ms);
+    EXPECT_EQ(stats.MeanWorkerBusy(), 25ms);
+    EXPECT_DOUBLE_EQ(stats.LoadImbalance(), 1.6);
+
+    const auto line = FormatRenderStats(stats);
+    EXPECT_EQ(line.find('\n'), std::string::npos);
+    EXPECT_NE(line.find("imbalance 1.60"), std::string::npos);
+    EXPECT_NE(line.find("1234 iterations"), std::string::npos);
+}
+
+// --------------------- Scheduler tests ---------------------
+TEST(MandelbrotRenderer, InlineSchedulerRendersOnCallingThread) {
+    BasicMandelbrotRenderer renderer{exec::inline_scheduler{}};
+    auto rs = SmallSettings(33, 21, 64);
+    rs.aa_samples = 2;
+    const mandelbrot::ViewPort vp;
+
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+    MandelbrotRenderer pooled(4);
+    auto expected = std::get<0>(*stdexec::sync_wait(pooled.RenderAsync<4>(vp, rs)));
+    EXPECT_EQ(result.pixel_data, expected.pixel_data);
+    EXPECT_EQ(result.rgba_data, expected.rgba_data);
+    EXPECT_EQ(result.aa_pixels, expected.aa_pixels);
+
+    std::vector<std::thread::id> threads;
+    auto sink = [&threads](RenderedTile &&) {
+        threads.push_back(std::this_thread::get_id());
+        return true;
+    };
+    (void)stdexec::sync_wait(renderer.StreamTilesAsync<2>(vp, rs, 4, sink));
+    ASSERT_EQ(threads.size(), 6u);
+    for (const auto id : threads) {
+        EXPECT_EQ(id, std::this_thread::get_id());
+    }
+}
+
+TEST(MandelbrotRenderer, DispatchLanesRoundsUpToPowerOfTwo) {
+    auto lanes = [](std::size_t n) { return DispatchLanes(n, []<std::size_t N>() { return N; }); };
+    EXPECT_EQ(lanes(0), 1u);
+    EXPECT_EQ(lanes(1), 1u);
+    EXPECT_EQ(lanes(3), 4u);
+    EXPECT_EQ(lanes(8), 8u);
+    EXPECT_EQ(lanes(1000), MAX_LANES);
+}
+
+TEST(MandelbrotRenderer, RenderersShareOnePool) {
+    exec::static_thread_pool pool{2};
+    MandelbrotRenderer view{pool.get_scheduler()};
+    MandelbrotRenderer minimap{pool.get_scheduler()};
+    EXPECT_TRUE(view.GetScheduler() == minimap.GetScheduler());
+    EXPECT_TRUE(MandelbrotRenderer{SharedThreadPool().get_scheduler()}.GetScheduler() ==
+                SharedThreadPool().get_scheduler());
+
+    const auto rs = SmallSettings(40, 30, 64);
+    const mandelbrot::ViewPort vp;
+    auto [big, small] = *stdexec::sync_wait(
+        stdexec::when_all(view.RenderAsync<4>(vp, rs), minimap.RenderAsync<2>(vp, SmallSettings(20, 15, 64))));
+    MandelbrotRenderer own(2);
+    EXPECT_EQ(big.pixel_data, std::get<0>(*stdexec::sync_wait(own.RenderAsync<4>(vp, rs))).pixel_data);
+    EXPECT_EQ(small.pixel_data.size(), 15u);
+}
+
+// --------------------- Work-stealing pool tests ---------------------
+TEST(WorkStealingPool, DequeIsLifoForOwnerAndFifoForThieves) {
+    ws::ChaseLevDeque<int> deque;
+    // Больше начальной ёмкости, чтобы буфер вырос
+    const int count = static_cast<int>(ws::ChaseLevDeque<int>::INITIAL_CAPACITY) * 3;
+    for (int i = 0; i < count; ++i) {
+        deque.Push(i);
+    }
+    int value = -1;
+    ASSERT_TRUE(deque.Steal(value));
+    EXPECT_EQ(value, 0);
+    ASSERT_TRUE(deque.Pop(value));
+    EXPECT_EQ(value, count - 1);
+    EXPECT_EQ(deque.SizeApprox(), count - 2);
+    while (deque.Pop(value)) {
+    }
+    EXPECT_FALSE(deque.Steal(value));
+    EXPECT_EQ(deque.SizeApprox(), 0);
+}
+
+TEST(WorkStealingPool, DequeHandsOutEveryItemOnce) {
+    ws::ChaseLevDeque<int> deque;
+    constexpr int COUNT = 50000;
+    std::vector<std::atomic<int>> taken(COUNT);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < 3; ++t) {
+        thieves.emplace_back([&] {
+            int value = 0;
+            while (!done.load()) {
+                if (deque.Steal(value)) {
+                    ++taken[value];
+                }
+            }
+        });
+    }
+    int value = 0;
+    for (int i = 0; i < COUNT; ++i) {
+        deque.Push(i);
+        if (i % 3 == 0 && deque.Pop(value)) {
+            ++taken[value];
+        }
+    }
+    while (deque.Pop(value)) {
+        ++taken[value];
+    }
+    done = true;
+    for (auto &thief : thieves) {
+        thief.join();
+    }
+    EXPECT_TRUE(std::all_of(taken.begin(), taken.end(), [](const auto &n) { return n.load() == 1; }));
+}
+
+TEST(WorkStealingPool, RunsScheduledAndNestedWork) {
+    ws::WorkStealingPool pool{4};
+    auto sched = pool.GetScheduler();
+    std::atomic<int> counter{0};
+    exec::async_scope scope;
+    for (int i = 0; i < 200; ++i) {
+        // Каждая задача ставит ещё пять с потока пула — они попадают в его деку и разворовываются
+        scope.spawn(stdexec::schedule(sched) | stdexec::then([&] {
+                        ++counter;
+                        for (int j = 0; j < 5; ++j) {
+                            scope.spawn(stdexec::schedule(sched) | stdexec::then([&] { ++counter; }));
+                        }
+                    }));
+    }
+    stdexec::sync_wait(scope.on_empty());
+    EXPECT_EQ(counter.load(), 1200);
+    EXPECT_TRUE(stdexec::get_completion_scheduler<stdexec::set_value_t>(
+                    stdexec::get_env(stdexec::schedule(sched))) == sched);
+}
+
+TEST(WorkStealingPool, BatchCostsOneWakeup) {
+    struct CountingTask : ws::Task {
+        std::atomic<int> *executed;
+
+        explicit CountingTask(std::atomic<int> *counter) : ws::Task{&Execute}, executed{counter} {}
+        static void Execute(ws::Task *task) noexcept { ++*static_cast<CountingTask *>(task)->executed; }
+    };
+    std::atomic<int> executed{0};
+    ws::WorkStealingPool pool{4};
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.SleepingThreads() < pool.ThreadCount() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(pool.SleepingThreads(), pool.ThreadCount());
+
+    std::vector<CountingTask> tasks(256, CountingTask{&executed});
+    const auto before = pool.Stats();
+    {
+        const ws::WorkStealingPool::BatchScope batch{pool};
+        for (auto &task : tasks) {
+            pool.Submit(&task);
+        }
+    }
+    while (executed.load() < 256 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(executed.load(), 256);
+    EXPECT_EQ(pool.Stats().submit_wakeups - before.submit_wakeups, 1u);
+}
+
+TEST(WorkStealingPool, DrivesMandelbrotRenderer) {
+    ws::WorkStealingPool pool{3};
+    BasicMandelbrotRenderer renderer{pool.GetScheduler()};
+    auto rs = SmallSettings(41, 29, 64);
+    rs.aa_samples = 2;
+    const mandelbrot::ViewPort vp;
+
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+    MandelbrotRenderer reference(2);
+    auto expected = std::get<0>(*stdexec::sync_wait(reference.RenderAsync<4>(vp, rs)));
+    EXPECT_EQ(result.pixel_data, expected.pixel_data);
+    EXPECT_EQ(result.rgba_data, expected.rgba_data);
+
+    std::atomic<std::uint32_t> tiles{0};
+    (void)stdexec::sync_wait(renderer.StreamTilesAsync<3>(vp, rs, 2, [&tiles](RenderedTile &&) {
+        ++tiles;
+        return true;
+    }));
+    EXPECT_EQ(tiles.load(), 15u);
+}
+
+namespace {
+
+// Ждёт, пока все потоки пула уснут, чтобы счётчики пробуждений не зависели от предыдущей работы
+bool WaitUntilPoolSleeps(const ws::WorkStealingPool &pool) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.SleepingThreads() < pool.ThreadCount() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return pool.SleepingThreads() == pool.ThreadCount();
+}
+
+}  // namespace
+
+TEST(WorkStealingPool, MovesInjectedTasksIntoWorkerDeques) {
+    struct CountingTask : ws::Task {
+        std::atomic<int> *executed;
+
+        explicit CountingTask(std::atomic<int> *counter) : ws::Task{&Execute}, executed{counter} {}
+        static void Execute(ws::Task *task) noexcept { ++*static_cast<CountingTask *>(task)->executed; }
+    };
+    std::atomic<int> executed{0};
+    ws::WorkStealingPool pool{2};
+    ASSERT_TRUE(WaitUntilPoolSleeps(pool));
+
+    // Пачка ложится в общую очередь целиком до первого пробуждения: проснувшийся поток переносит часть в деку
+    std::vector<CountingTask> tasks(64, CountingTask{&executed});
+    {
+        const ws::WorkStealingPool::BatchScope batch{pool};
+        for (auto &task : tasks) {
+            pool.Submit(&task);
+        }
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (executed.load() < 64 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(executed.load(), 64);
+    EXPECT_GT(pool.Stats().transferred, 0u);
+}
+
+TEST(WorkStealingPool, RendererSubmitsFrameAsOneBatch) {
+    ws::WorkStealingPool pool{4};
+    BasicMandelbrotRenderer renderer{pool.GetScheduler(), 4};
+    const auto rs = SmallSettings(64, 48, 64);
+    ASSERT_TRUE(WaitUntilPoolSleeps(pool));
+
+    const auto before = pool.Stats();
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<16>(mandelbrot::ViewPort{}, rs)));
+    EXPECT_EQ(result.pixel_data.size(), rs.height);
+    EXPECT_EQ(pool.Stats().submit_wakeups - before.submit_wakeups, 1u);
+
+    ASSERT_TRUE(WaitUntilPoolSleeps(pool));
+    const auto stream_before = pool.Stats();
+    std::atomic<std::uint32_t> tiles{0};
+    (void)stdexec::sync_wait(renderer.StreamTilesAsync<8>(mandelbrot::ViewPort{}, rs, 4, [&tiles](RenderedTile &&) {
+        ++tiles;
+        return true;
+    }));
+    EXPECT_EQ(tiles.load(), 12u);
+    EXPECT_EQ(pool.Stats().submit_wakeups - stream_before.submit_wakeups, 1u);
+}
+
+TEST(WorkStealingPool, SelectedByName) {
+    EXPECT_EQ(ParsePoolKind("static"), PoolKind::STATIC);
+    EXPECT_EQ(ParsePoolKind("ws"), PoolKind::WORK_STEALING);
+    EXPECT_THROW((void)ParsePoolKind("fifo"), std::invalid_argument);
+
+    const auto rs = SmallSettings(33, 21, 48);
+    auto render = [&](PoolKind kind) {
+        return WithRenderer(kind, 3, [&](auto &renderer) {
+            EXPECT_EQ(renderer.Concurrency(), 3u);
+            AppState state;
+            return std::get<0>(*stdexec::sync_wait(CalculateMandelbrotAsyncSender{state, rs, renderer})).pixel_data;
+        });
+    };
+    EXPECT_EQ(render(PoolKind::WORK_STEALING), render(PoolKind::STATIC));
+}
+
+// --------------------- Iteration histogram tests ---------------------
+TEST(IterationHistogram, LogBinsAndInsideCount) {
+    IterationHistogram histogram{100};
+    const std::vector<std::uint32_t> row{0, 1, 2, 3, 4, 7, 8, 99, 100, 100};
+    histogram.AddRow(row);
+
+    EXPECT_EQ(histogram.Total(), row.size());
+    EXPECT_EQ(histogram.Inside(), 2u);
+    EXPECT_EQ(histogram.Count(0), 1u);  // 0
+    EXPECT_EQ(histogram.Count(1), 1u);  // [1, 2)
+    EXPECT_EQ(histogram.Count(2), 2u);  // [2, 4)
+    EXPECT_EQ(histogram.Count(3), 2u);  // [4, 8)
+    EXPECT_EQ(histogram.Count(4), 1u);  // [8, 16)
+    EXPECT_EQ(histogram.Count(7), 1u);  // [64, 128)
+    EXPECT_EQ(IterationHistogram::BinLower(7), 64u);
+    EXPECT_EQ(IterationHistogram::BinUpper(7), 128u);
+    EXPECT_DOUBLE_EQ(histogram.InsideFraction(), 0.2);
+    EXPECT_DOUBLE_EQ(histogram.Quantile(1.0), 100.0);
+    EXPECT_LE(histogram.Quantile(0.5), 8.0);
+}
+
+TEST(IterationHistogram, MergedPartialsMatchWholeFrame) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(48, 36, 64);
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, rs)));
+
+    IterationHistogram expected{rs.max_iterations};
+    for (const auto &row : result.pixel_data) {
+        expected.AddRow(row);
+    }
+    const auto &merged = result.stats.iteration_histogram;
+    EXPECT_EQ(merged.Total(), static_cast<std::uint64_t>(rs.width) * rs.height);
+    EXPECT_EQ(merged.Inside(), expected.Inside());
+    for (std::size_t i = 0; i < IterationHistogram::BIN_COUNT; ++i) {
+        EXPECT_EQ(merged.Count(i), expected.Count(i)) << "bin " << i;
+    }
+    EXPECT_NE(FormatRenderStats(result.stats).find("inside"), std::string::npos);
+}
+
+TEST(IterationHistogram, CsvAndJsonExport) {
+    IterationHistogram histogram{16};
+    histogram.AddRow(std::vector<std::uint32_t>{1, 5, 6, 16});
+
+    std::ostringstream csv;
+    histogram.WriteCsv(csv);
+    EXPECT_EQ(csv.str(), "lower,upper,count\n1,2,1\n4,8,2\n16,16,1\n");
+
+    std::ostringstream json;
+    histogram.WriteJson(json);
+    EXPECT_EQ(json.str(), R"({"max_iterations":16,"total":4,"inside":1,"bins":[{"lower":1,"upper":2,"count":1},)"
+                          R"({"lower":4,"upper":8,"count":2}]})"
+                          "\n");
+}
+
+// --------------------- Adaptive AA tests ---------------------
+TEST(AdaptiveAA, FindsPixelsWithDifferentNeighbours) {
+    PixelMatrix it(5, std::vector<std::uint32_t>(6, 10));
+    it[2][3] = 40;
+    auto edges = aa::FindEdgePixels(it, 1);
+    std::vector<std::uint32_t> expected{1 * 6 + 3, 2 * 6 + 2, 2 * 6 + 3, 2 * 6 + 4, 3 * 6 + 3};
+    EXPECT_EQ(edges, expected);
+    EXPECT_TRUE(aa::FindEdgePixels(it, 30).empty());
+}
+
+TEST(AdaptiveAA, DisabledByDefault) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(48, 32, 64);
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, rs)));
+    EXPECT_EQ(result.aa_pixels, 0u);
+}
+
+TEST(AdaptiveAA, SupersamplesOnlyEdgePixels) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(48, 32, 64);
+    mandelbrot::ViewPort vp;
+    auto plain = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+
+    rs.aa_samples = 8;
+    rs.aa_threshold = 2;
+    auto smooth = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+
+    auto edges = aa::FindEdgePixels(plain.pixel_data, rs.aa_threshold);
+    ASSERT_FALSE(edges.empty());
+    EXPECT_EQ(smooth.aa_pixels, edges.size());
+    EXPECT_LT(smooth.aa_pixels, rs.width * rs.height);
+    EXPECT_EQ(smooth.pixel_data, plain.pixel_data);
+
+    const auto smooth_colors = UnpackRgbaToColors(smooth.rgba_data, rs.width, rs.height);
+    const auto plain_colors = UnpackRgbaToColors(plain.rgba_data, rs.width, rs.height);
+    std::vector<bool> is_edge(rs.width * rs.height, false);
+    for (auto e : edges)
+        is_edge[e] = true;
+    for (std::uint32_t i = 0; i < rs.width * rs.height; ++i) {
+        if (is_edge[i])
+            continue;
+        const auto y = i / rs.width;
+        const auto x = i % rs.width;
+        EXPECT_EQ(smooth_colors[y][x].r, plain_colors[y][x].r);
+        EXPECT_EQ(smooth_colors[y][x].g, plain_colors[y][x].g);
+        EXPECT_EQ(smooth_colors[y][x].b, plain_colors[y][x].b);
+    }
+}
+
+TEST(AdaptiveAA, NonSquareBudgetCoversWholePixel) {
+    for (const std::uint32_t samples : {2u, 3u, 5u, 6u, 7u, 10u}) {
+        const aa::SampleGrid grid{samples};
+        EXPECT_GE(grid.cols * grid.rows, samples);
+        EXPECT_LT(grid.cols * (grid.rows - 1), samples);
+
+        // Каждый пиксель получает сэмпл в каждой строке сетки, а вместе пиксели покрывают все четверти по высоте
+        std::vector<bool> quarters(4, false);
+        for (std::uint32_t pixel = 0; pixel < 64; ++pixel) {
+            std::vector<bool> bands(grid.rows, false);
+            for (std::uint32_t s = 0; s < samples; ++s) {
+                const auto [dx, dy] = grid.Offset(pixel, 2 * pixel, s);
+                ASSERT_GE(dx, 0.0);
+                ASSERT_LT(dx, 1.0);
+                ASSERT_GE(dy, 0.0);
+                ASSERT_LT(dy, 1.0);
+                bands[static_cast<std::size_t>(dy * grid.rows)] = true;
+                quarters[static_cast<std::size_t>(dy * 4)] = true;
+            }
+            EXPECT_TRUE(std::ranges::all_of(bands, std::identity{})) << samples << " samples";
+        }
+        EXPECT_TRUE(std::ranges::all_of(quarters, std::identity{})) << samples << " samples";
+    }
+}
+
+TEST(AdaptiveAA, SkipsStageWithoutEdges) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(32, 24, 64);
+    rs.aa_samples = 8;
+    // Область целиком внутри множества — граничных пикселей нет
+    const mandelbrot::ViewPort inside{.x_min = -0.1, .x_max = 0.1, .y_min = -0.1, .y_max = 0.1};
+
+    auto result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(inside, rs)));
+    EXPECT_EQ(result.aa_pixels, 0u);
+    EXPECT_EQ(result.stats.antialias.count(), 0);
+
+    rs.aa_samples = 0;
+    result = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, rs)));
+    EXPECT_EQ(result.aa_pixels, 0u);
+    EXPECT_EQ(result.stats.antialias.count(), 0);
+}
+
+// --------------------- Image writer tests ---------------------
+namespace {
+
+std::vector<std::uint8_t> ReadFileBytes(const std::filesystem::path &path) {
+    std::ifstream in{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+std::uint32_t ReadBigEndian(const std::uint8_t *p) {
+    return (std::uint32_t{p[0]} << 24) | (std::uint32_t{p[1]} << 16) | (std::uint32_t{p[2]} << 8) | p[3];
+}
+
+RgbaBuffer GradientRgba(std::uint32_t w, std::uint32_t h) {
+    RgbaBuffer rgba(static_cast<std::size_t>(w) * h * RGBA_CHANNELS);
+    for (std::size_t i = 0; i < rgba.size(); ++i)
+        rgba[i] = static_cast<std::uint8_t>(i * 7 + i / 13);
+    return rgba;
+}
+
+}  // namespace
+
+TEST(ImageWriter, PpmContainsHeaderAndRgb) {
+    const auto path = std::filesystem::temp_directory_path() / "mandelbrot_test.ppm";
+    auto rgba = GradientRgba(5, 3);
+    image::WriteImage(path, 5, 3, rgba);
+
+    auto bytes = ReadFileBytes(path);
+    const std::string header = "P6\n5 3\n255\n";
+    ASSERT_EQ(bytes.size(), header.size() + 5 * 3 * 3);
+    EXPECT_TRUE(std::equal(header.begin(), header.end(), bytes.begin()));
+    EXPECT_EQ(bytes[header.size() + 3], rgba[4]);
+    EXPECT_EQ(bytes.back(), rgba[rgba.size() - 2]);
+    std::filesystem::remove(path);
+}
+
+namespace {
+
+// Склеивает IDAT чанки PNG в поток zlib, проверяя CRC каждого чанка и размеры из IHDR
+std::vector<std::uint8_t> ReadPngZlibStream(const std::filesystem::path &path, std::uint32_t w, std::uint32_t h) {
+    auto bytes = ReadFileBytes(path);
+    if (bytes.size() <= 8 || bytes[1] != 'P') {
+        ADD_FAILURE() << "not a PNG file";
+        return {};
+    }
+
+    // Собираем поток zlib из всех IDAT, проверяя CRC каждого чанка
+    std::vector<std::uint8_t> zlib_stream;
+    std::size_t pos = 8;
+    bool has_iend = false;
+    while (pos + 12 <= bytes.size()) {
+        const auto len = ReadBigEndian(&bytes[pos]);
+        const std::string type(bytes.begin() + pos + 4, bytes.begin() + pos + 8);
+        const std::span<const std::uint8_t> type_and_data{&bytes[pos + 4], len + 4};
+        EXPECT_EQ(image::Crc32Update(0, type_and_data), ReadBigEndian(&bytes[pos + 8 + len])) << type;
+        if (type == "IHDR") {
+            EXPECT_EQ(ReadBigEndian(&bytes[pos + 8]), w);
+            EXPECT_EQ(ReadBigEndian(&bytes[pos + 12]), h);
+        } else if (type == "IDAT") {
+            zlib_stream.insert(zlib_stream.end(), bytes.begin() + pos + 8, bytes.begin() + pos + 8 + len);
+        } else if (type == "IEND") {
+            has_iend = true;
+        }
+        pos += 12 + len;
+    }
+    EXPECT_TRUE(has_iend);
+    return zlib_stream;
+}
+
+// Строки RGB из распакованных строк PNG без фильтра
+std::vector<std::uint8_t> UnfilteredRowsToRgb(const std::vector<std::uint8_t> &raw, std::uint32_t w, std::uint32_t h) {
+    std::vector<std::uint8_t> rgb;
+    for (std::uint32_t row = 0; row < h && raw.size() >= (row + 1) * (1 + w * 3); ++row) {
+        EXPECT_EQ(raw[row * (1 + w * 3)], 0u);
+        rgb.insert(rgb.end(), raw.begin() + row * (1 + w * 3) + 1, raw.begin() + (row + 1) * (1 + w * 3));
+    }
+    return rgb;
+}
+
+// Разбирает PNG, записанный без сжатия (stored-блоки), и возвращает строки RGB без байтов фильтра
+std::vector<std::uint8_t> ReadStoredPngRgb(const std::filesystem::path &path, std::uint32_t w, std::uint32_t h) {
+    const auto zlib_stream = ReadPngZlibStream(path, w, h);
+    if (zlib_stream.empty()) {
+        return {};
+    }
+
+    // Разбираем stored-блоки deflate
+    std::vector<std::uint8_t> raw;
+    std::size_t p = 2;
+    bool final = false;
+    while (!final) {
+        if (p + 5 >= zlib_stream.size()) {
+            ADD_FAILURE() << "truncated deflate stream";
+            return {};
+        }
+        final = zlib_stream[p] & 1;
+        const std::size_t n = zlib_stream[p + 1] | (zlib_stream[p + 2] << 8);
+        raw.insert(raw.end(), zlib_stream.begin() + p + 5, zlib_stream.begin() + p + 5 + n);
+        p += 5 + n;
+    }
+    image::Adler32 adler;
+    adler.Update(raw);
+    EXPECT_EQ(adler.Value(), ReadBigEndian(&zlib_stream[p]));
+    return UnfilteredRowsToRgb(raw, w, h);
+}
+
+#ifdef MANDELBROT_HAS_ZLIB
+// Распаковывает PNG, сжатый deflate, средствами zlib — независимо от writer'а
+std::vector<std::uint8_t> ReadDeflatedPngRgb(const std::filesystem::path &path, std::uint32_t w, std::uint32_t h) {
+    const auto zlib_stream = ReadPngZlibStream(path, w, h);
+    std::vector<std::uint8_t> raw(static_cast<std::size_t>(h) * (1 + w * 3));
+    uLongf size = raw.size();
+    const auto status = uncompress(raw.data(), &size, zlib_stream.data(), zlib_stream.size());
+    EXPECT_EQ(status, Z_OK);
+    EXPECT_EQ(size, raw.size());
+    return UnfilteredRowsToRgb(raw, w, h);
+}
+#endif
+
+std::vector<std::uint8_t> RgbaToRgb(const RgbaBuffer &rgba) {
+    std::vector<std::uint8_t> rgb;
+    for (std::size_t i = 0; i < rgba.size(); i += RGBA_CHANNELS)
+        rgb.insert(rgb.end(), rgba.begin() + i, rgba.begin() + i + 3);
+    return rgb;
+}
+
+}  // namespace
+
+TEST(ImageWriter, PngBandsAreValidAndHoldAllRows) {
+    const std::uint32_t w = 300, h = 130;
+    const auto path = std::filesystem::temp_directory_path() / "mandelbrot_test.png";
+    auto rgba = GradientRgba(w, h);
+    {
+        image::PngWriter writer{path, w, h};
+        writer.WriteRows(rgba.data(), 60, 0);
+        writer.WriteRows(rgba.data() + 60 * w * RGBA_CHANNELS, 70, 0);
+        writer.Finish();
+    }
+    EXPECT_EQ(ReadStoredPngRgb(path, w, h), RgbaToRgb(rgba));
+    std::filesystem::remove(path);
+}
+
+TEST(ImageWriter, AdlerCombineMatchesSequentialUpdate) {
+    std::vector<std::uint8_t> data(100000);
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<std::uint8_t>(i * 31 + 7);
+    image::Adler32 whole, first, second;
+    whole.Update(data);
+    first.Update(std::span{data}.first(33333));
+    second.Update(std::span{data}.subspan(33333));
+    EXPECT_EQ(image::Adler32::Combine(first.Value(), second.Value(), data.size() - 33333), whole.Value());
+}
+
+TEST(BandedRenderer, WritesSameImageAsRenderAsync) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(61, 45, 64);
+    mandelbrot::ViewPort vp;
+    const auto path = std::filesystem::temp_directory_path() / "mandelbrot_banded.png";
+
+    auto stats = RenderBandedToPng(renderer, vp, rs, path,
+                                   BandedRenderOptions{.band_rows = 4, .bands_in_flight = 3, .compression_level = 0});
+    EXPECT_EQ(stats.bands, 12u);
+    EXPECT_LE(stats.peak_bands_in_flight, 3u);
+
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+    EXPECT_EQ(ReadStoredPngRgb(path, rs.width, rs.height), RgbaToRgb(full.rgba_data));
+    std::filesystem::remove(path);
+}
+
+#ifdef MANDELBROT_HAS_ZLIB
+TEST(BandedRenderer, CompressedPngRoundTripsThroughZlib) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(97, 53, 64);
+    mandelbrot::ViewPort vp;
+    const auto path = std::filesystem::temp_directory_path() / "mandelbrot_banded_deflate.png";
+
+    auto stats = RenderBandedToPng(renderer, vp, rs, path,
+                                   BandedRenderOptions{.band_rows = 5, .bands_in_flight = 3, .compression_level = 6});
+    EXPECT_LT(stats.compressed_bytes, static_cast<std::uint64_t>(rs.height) * (1 + rs.width * 3));
+
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+    EXPECT_EQ(ReadDeflatedPngRgb(path, rs.width, rs.height), RgbaToRgb(full.rgba_data));
+    std::filesystem::remove(path);
+}
+#endif
+
+TEST(ImageWriter, RejectsUnknownExtension) {
+    EXPECT_THROW(image::WriteImage("frame.bmp", 1, 1, RgbaBuffer(4)), std::invalid_argument);
+}
+
+// --------------------- Zoom animation tests ---------------------
+TEST(ZoomPathTest, InterpolatesWidthExponentially) {
+    auto rs = SmallSettings(64, 48);
+    zoom::ZoomPath path{{{.frame = 0, .center_x = -0.5, .center_y = 0.0, .width = 4.0},
+                         {.frame = 10, .center_x = -0.75, .center_y = 0.1, .width = 0.04}}};
+
+    EXPECT_EQ(path.FrameCount(), 11u);
+    EXPECT_DOUBLE_EQ(path.ViewportAt(0, rs).width(), 4.0);
+    EXPECT_DOUBLE_EQ(path.ViewportAt(5, rs).width(), 0.4);
+    EXPECT_DOUBLE_EQ(path.ViewportAt(5, rs).height(), 0.3);
+
+    const auto last = path.ViewportAt(10, rs);
+    EXPECT_NEAR((last.x_min + last.x_max) / 2, -0.75, 1e-12);
+    EXPECT_NEAR((last.y_min + last.y_max) / 2, 0.1, 1e-12);
+}
+
+TEST(ZoomPathTest, PlanCoversEveryFrameWithFewKeyImages) {
+    auto rs = SmallSettings(64, 48);
+    zoom::ZoomPath path{{{.frame = 0, .center_x = -0.5, .center_y = 0.0, .width = 4.0},
+                         {.frame = 299, .center_x = -0.7436, .center_y = 0.1318, .width = 4.0 / 1024}}};
+
+    const auto plans = zoom::PlanZoomKeys(path, rs);
+    std::uint32_t next = 0;
+    double key_pixels = 0;
+    for (const auto &plan : plans) {
+        EXPECT_EQ(plan.first_frame, next);
+        next = plan.end_frame;
+        if (!plan.direct) {
+            key_pixels += static_cast<double>(plan.key_width) * plan.key_height;
+        }
+    }
+    EXPECT_EQ(next, 300u);
+    // Десять удвоений зума — не больше одиннадцати групп
+    EXPECT_LE(plans.size(), 11u);
+    EXPECT_GT(300.0 * rs.width * rs.height / key_pixels, 5.0);
+}
+
+TEST(ZoomResampleTest, SameViewportReproducesKeyImage) {
+    MandelbrotRenderer renderer(2);
+    auto rs = SmallSettings(40, 30);
+    mandelbrot::ViewPort vp{-2.0, 1.0, -1.0, 1.0};
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<2>(vp, rs)));
+
+    const zoom::KeyImage key{full.rgba_data, vp, rs.width, rs.height};
+    RgbaBuffer out;
+    zoom::ResampleFrame<3>(renderer.GetScheduler(), key, vp, rs, out);
+    EXPECT_EQ(out, full.rgba_data);
+}
+
+TEST(ZoomSequenceTest, EmitsFramesInOrderFromKeyImages) {
+    MandelbrotRenderer renderer(2);
+    auto rs = SmallSettings(32, 24);
+    zoom::ZoomPath path{{{.frame = 0, .center_x = -0.5, .center_y = 0.0, .width = 3.0},
+                         {.frame = 39, .center_x = -0.7436, .center_y = 0.1318, .width = 3.0 / 16}}};
+
+    std::vector<std::uint32_t> frames;
+    auto stats = zoom::RenderZoomSequence(renderer, path, rs, [&](std::uint32_t index, const RgbaBuffer &rgba) {
+        EXPECT_EQ(rgba.size(), static_cast<std::size_t>(rs.width) * rs.height * RGBA_CHANNELS);
+        frames.push_back(index);
+    });
+
+    ASSERT_EQ(frames.size(), 40u);
+    for (std::uint32_t i = 0; i < frames.size(); ++i) {
+        EXPECT_EQ(frames[i], i);
+    }
+    EXPECT_EQ(stats.frames, 40u);
+    EXPECT_LT(stats.key_renders + stats.direct_renders, 10u);
+}
+
+TEST(ImageWriter, Y4mStreamHasHeaderAndFrames) {
+    std::ostringstream out;
+    image::Y4mWriter writer{out, 2, 1, 25};
+    writer.WriteFrame(RgbaBuffer{255, 255, 255, 255, 0, 0, 0, 255});
+    writer.WriteFrame(RgbaBuffer(8, 0));
+
+    const auto data = out.str();
+    const std::string header = "YUV4MPEG2 W2 H1 F25:1 Ip A1:1 C444\nFRAME\n";
+    ASSERT_EQ(data.size(), header.size() + 6 + 6 + 6);
+    EXPECT_EQ(data.substr(0, header.size()), header);
+    // Белый и чёрный в ограниченном диапазоне BT.601
+    EXPECT_EQ(static_cast<std::uint8_t>(data[header.size()]), 235);
+    EXPECT_EQ(static_cast<std::uint8_t>(data[header.size() + 1]), 16);
+}
+
+// --------------------- Tile server tests ---------------------
+TEST(TileServerTest, ParsesXyzPaths) {
+    const auto key = tiles::ParseTilePath("/3/5/7.png");
+    ASSERT_TRUE(key);
+    EXPECT_EQ(*key, (tiles::TileKey{3, 5, 7}));
+
+    EXPECT_FALSE(tiles::ParseTilePath("/3/8/7.png"));
+    EXPECT_FALSE(tiles::ParseTilePath("/3/5.png"));
+    EXPECT_FALSE(tiles::ParseTilePath("/3/5/7/1.png"));
+    EXPECT_FALSE(tiles::ParseTilePath("/3//7.png"));
+    EXPECT_FALSE(tiles::ParseTilePath("/3/5/7.jpg"));
+
+    const auto vp = tiles::TileViewport({1, 1, 0});
+    EXPECT_DOUBLE_EQ(vp.x_min, -0.5);
+    EXPECT_DOUBLE_EQ(vp.x_max, 1.5);
+    EXPECT_DOUBLE_EQ(vp.y_min, -2.0);
+}
+
+TEST(TileServerTest, DetectsConnectionCloseInAnyCase) {
+    EXPECT_TRUE(tiles::RequestsClose("GET / HTTP/1.1\r\nConnection: close\r\n"));
+    EXPECT_TRUE(tiles::RequestsClose("GET / HTTP/1.1\r\nHost: x\r\nconnection:CLOSE\r\n"));
+    EXPECT_TRUE(tiles::RequestsClose("GET / HTTP/1.1\r\nCONNECTION:  TE, Close \r\nAccept: */*"));
+    EXPECT_FALSE(tiles::RequestsClose("GET / HTTP/1.1\r\nConnection: keep-alive\r\n"));
+    EXPECT_FALSE(tiles::RequestsClose("GET /close HTTP/1.1\r\nX-Connection: close\r\nVia: close\r\n"));
+}
+
+TEST(TileServerTest, CacheEvictsLeastRecentlyUsed) {
+    tiles::TileCache cache(2);
+    cache.Put({0, 0, 0}, std::make_shared<const std::string>("a"));
+    cache.Put({1, 0, 0}, std::make_shared<const std::string>("b"));
+    EXPECT_TRUE(cache.Get({0, 0, 0}));
+
+    cache.Put({1, 1, 0}, std::make_shared<const std::string>("c"));
+    EXPECT_FALSE(cache.Get({1, 0, 0}));
+    EXPECT_TRUE(cache.Get({0, 0, 0}));
+    EXPECT_TRUE(cache.Get({1, 1, 0}));
+    EXPECT_EQ(cache.Size(), 2u);
+}
+
+TEST(TileServerTest, CoalescesConcurrentRequestsForOneTile) {
+    MandelbrotRenderer renderer(4);
+    tiles::TileService service{renderer, tiles::TileServiceOptions{.max_iterations = 200}};
+
+    constexpr int CLIENTS = 8;
+    std::vector<tiles::TileData> results(CLIENTS);
+    std::vector<std::thread> clients;
+    for (int i = 0; i < CLIENTS; ++i) {
+        clients.emplace_back([&, i] { results[i] = service.GetTile({2, 1, 1}); });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+
+    const auto stats = service.GetStats();
+    EXPECT_EQ(stats.renders, 1u);
+    EXPECT_EQ(stats.requests, static_cast<std::uint64_t>(CLIENTS));
+    EXPECT_EQ(stats.cache_hits + stats.coalesced, static_cast<std::uint64_t>(CLIENTS - 1));
+    for (const auto &tile : results) {
+        ASSERT_TRUE(tile);
+        EXPECT_EQ(*tile, *results.front());
+    }
+    EXPECT_EQ(results.front()->substr(1, 3), "PNG");
+}
+
+TEST(TileServerTest, ReportsRecentRequestRate) {
+    MandelbrotRenderer renderer(2);
+    tiles::TileService service{renderer, tiles::TileServiceOptions{.max_iterations = 50,
+                                                                   .rate_window = std::chrono::milliseconds{50}}};
+    for (int i = 0; i < 4; ++i) {
+        (void)service.GetTile({0, 0, 0});
+    }
+    EXPECT_GT(service.GetStats().tiles_per_second, 0.0);
+
+    // После простоя длиннее окна текущая частота падает до нуля, а средняя за всё время остаётся
+    std::this_thread::sleep_for(std::chrono::milliseconds{60});
+    (void)service.GetStats();
+    std::this_thread::sleep_for(std::chrono::milliseconds{60});
+    const auto idle = service.GetStats();
+    EXPECT_EQ(idle.tiles_per_second, 0.0);
+    EXPECT_GT(idle.average_tiles_per_second, 0.0);
+    EXPECT_EQ(idle.requests, 4u);
+}
+
+TEST(TileServerTest, ServesTilesOverHttp) {
+    MandelbrotRenderer renderer(2);
+    tiles::TileServer server{renderer, tiles::TileServerOptions{.port = 0, .connection_threads = 2}};
+    server.Start();
+
+    auto socket = net::ConnectTcp("127.0.0.1", server.Port());
+    net::LineReader reader{socket};
+    auto get = [&](std::string_view path) {
+        EXPECT_TRUE(net::SendAll(socket, std::string{"GET "} + std::string{path} + " HTTP/1.1\r\n\r\n"));
+        auto header = reader.ReadUntil("\r\n\r\n", 8192).value_or("");
+        const auto pos = header.find("Content-Length: ");
+        const auto length = pos == std::string::npos ? 0 : std::stoull(header.substr(pos + 16));
+        return std::pair{header.substr(0, header.find("\r\n")), reader.ReadExact(length).value_or("")};
+    };
+
+    const auto [status, body] = get("/0/0/0.png");
+    EXPECT_EQ(status, "HTTP/1.1 200 OK");
+    EXPECT_EQ(body.substr(1, 3), "PNG");
+
+    // То же соединение keep-alive: повторный запрос отдаётся из кэша
+    EXPECT_EQ(get("/0/0/0.png").second, body);
+    EXPECT_EQ(get("/9/0/0.jpg").first, "HTTP/1.1 404 Not Found");
+    EXPECT_EQ(server.Service().GetStats().cache_hits, 1u);
+
+    // Заголовок Connection в нижнем регистре тоже закрывает соединение после ответа
+    EXPECT_TRUE(net::SendAll(socket, "GET /stats HTTP/1.1\r\nconnection: close\r\n\r\n"));
+    const auto header = reader.ReadUntil("\r\n\r\n", 8192).value_or("");
+    EXPECT_NE(header.find("Connection: close"), std::string::npos);
+    const auto pos = header.find("Content-Length: ");
+    ASSERT_NE(pos, std::string::npos);
+    EXPECT_TRUE(reader.ReadExact(std::stoull(header.substr(pos + 16))));
+    EXPECT_FALSE(reader.ReadUntil("\r\n\r\n", 8192));
+    server.Stop();
+}
+
+// --------------------- Distributed rendering tests ---------------------
+TEST(DistributedTest, JobRoundTripsThroughWireFormat) {
+    dist::Job job{7, {16, 32, 0, 640}, {-0.75, -0.73, 0.1, 0.12}, SmallSettings(640, 480, 900, 2.0)};
+    job.settings.kernel = mandelbrot::Kernel::SIMD_STREAMING;
+    const auto decoded = dist::DecodeJob(dist::EncodeJob(job));
+    EXPECT_EQ(decoded.id, 7u);
+    EXPECT_EQ(decoded.region.end_row, 32u);
+    EXPECT_DOUBLE_EQ(decoded.viewport.x_min, -0.75);
+    EXPECT_DOUBLE_EQ(decoded.viewport.y_max, 0.12);
+    EXPECT_EQ(decoded.settings.max_iterations, 900u);
+    EXPECT_EQ(decoded.settings.kernel, mandelbrot::Kernel::SIMD_STREAMING);
+    EXPECT_THROW(dist::DecodeJob("short"), std::runtime_error);
+}
+
+TEST(DistributedTest, AssemblesSameImageAsRenderAsync) {
+    auto rs = SmallSettings(48, 37, 80);
+    mandelbrot::ViewPort vp;
+    dist::Coordinator coordinator{"127.0.0.1", 0};
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 2; ++i) {
+        workers.emplace_back([port = coordinator.Port()] {
+            MandelbrotRenderer worker_renderer(2);
+            dist::RunWorker(worker_renderer, "127.0.0.1", port);
+        });
+    }
+    auto result = coordinator.Render(vp, rs, dist::DistributedOptions{.tile_rows = 5, .jobs_per_worker = 3});
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    MandelbrotRenderer renderer(2);
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<2>(vp, rs)));
+    EXPECT_EQ(result.rgba, full.rgba_data);
+    EXPECT_EQ(result.stats.tiles, 8u);
+    EXPECT_EQ(result.stats.worker_failures, 0u);
+}
+
+TEST(DistributedTest, RequeuesTilesOfFailedWorker) {
+    auto rs = SmallSettings(40, 30, 64);
+    mandelbrot::ViewPort vp;
+    dist::Coordinator coordinator{"127.0.0.1", 0};
+    const auto port = coordinator.Port();
+
+    auto render = std::async(std::launch::async, [&] {
+        return coordinator.Render(vp, rs, dist::DistributedOptions{.tile_rows = 4, .jobs_per_worker = 2});
+    });
+
+    // Рабочий берёт полосы и пропадает, не ответив
+    {
+        auto faulty = net::ConnectTcp("127.0.0.1", port);
+        const auto job = dist::ReceiveMessage(faulty);
+        ASSERT_TRUE(job);
+        EXPECT_EQ(job->type, dist::MessageType::JOB);
+    }
+
+    std::thread worker{[port] {
+        MandelbrotRenderer worker_renderer(2);
+        dist::RunWorker(worker_renderer, "127.0.0.1", port);
+    }};
+    auto result = render.get();
+    worker.join();
+
+    MandelbrotRenderer renderer(2);
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<2>(vp, rs)));
+    EXPECT_EQ(result.rgba, full.rgba_data);
+    EXPECT_EQ(result.stats.worker_failures, 1u);
+    EXPECT_GE(result.stats.requeued_tiles, 1u);
+}
+
+TEST(DistributedTest, FailsWhenOnlyWorkerDies) {
+    auto rs = SmallSettings(40, 30, 64);
+    mandelbrot::ViewPort vp;
+    dist::Coordinator coordinator{"127.0.0.1", 0};
+    const auto port = coordinator.Port();
+
+    const dist::DistributedOptions options{.tile_rows = 4, .idle_timeout = std::chrono::milliseconds{200}};
+    auto render = std::async(std::launch::async, [&] { return coordinator.Render(vp, rs, options); });
+
+    // Единственный рабочий берёт полосы и пропадает; других не будет
+    {
+        auto faulty = net::ConnectTcp("127.0.0.1", port);
+        const auto job = dist::ReceiveMessage(faulty);
+        ASSERT_TRUE(job);
+    }
+    EXPECT_THROW(render.get(), std::runtime_error);
+
+    // Проверка workers_gone прерывает кадр, не дожидаясь idle_timeout
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW((void)coordinator.Render(vp, rs, dist::DistributedOptions{.workers_gone = [] { return true; }}),
+                 std::runtime_error);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(DistributedTest, RendersRepeatedlyOnOneListener) {
+    auto rs = SmallSettings(32, 24, 64);
+    dist::Coordinator coordinator{"0.0.0.0", 0};
+    for (int round = 0; round < 2; ++round) {
+        std::thread worker{[port = coordinator.Port()] {
+            MandelbrotRenderer worker_renderer(2);
+            dist::RunWorker(worker_renderer, "127.0.0.1", port);
+        }};
+        auto result = coordinator.Render(mandelbrot::ViewPort{}, rs, dist::DistributedOptions{.tile_rows = 6});
+        worker.join();
+        EXPECT_EQ(result.stats.tiles, 4u);
+        EXPECT_EQ(result.stats.workers, 1u);
+    }
+}
+
+TEST(DistributedTest, WorkerFinishesStartedJobsBeforeReportingMalformedJob) {
+    auto listener = net::ListenTcp("127.0.0.1", 0);
+    auto worker = std::async(std::launch::async, [port = net::LocalPort(listener)] {
+        MandelbrotRenderer worker_renderer(2);
+        return dist::RunWorker(worker_renderer, "127.0.0.1", port);
+    });
+
+    const auto socket = net::Accept(listener);
+    const dist::Job job{0, {0, 4, 0, 16}, mandelbrot::ViewPort{}, SmallSettings(16, 12, 32)};
+    ASSERT_TRUE(dist::SendMessage(socket, dist::MessageType::JOB, dist::EncodeJob(job)));
+    ASSERT_TRUE(dist::SendMessage(socket, dist::MessageType::JOB, "short"));
+    EXPECT_THROW(worker.get(), std::runtime_error);
+
+    // Полоса, принятая до испорченного задания, досчитана и отправлена
+    const auto result = dist::ReceiveMessage(socket);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->type, dist::MessageType::RESULT);
+}
+
+// --------------------- Streaming tiles tests ---------------------
+TEST(BoundedQueueTest, DeliversEveryItemFromManyProducers) {
+    BoundedQueue<int> queue(64);
+    constexpr int PRODUCERS = 4;
+    constexpr int ITEMS = 10000;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < ITEMS; ++i) {
+                int value = p * ITEMS + i;
+                while (!queue.TryPush(std::move(value)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<bool> seen(PRODUCERS * ITEMS, false);
+    int received = 0;
+    while (received < PRODUCERS * ITEMS) {
+        if (auto value = queue.TryPop()) {
+            ASSERT_FALSE(seen[*value]);
+            seen[*value] = true;
+            ++received;
+        }
+    }
+    for (auto &t : producers)
+        t.join();
+    EXPECT_FALSE(queue.TryPop().has_value());
+}
+
+TEST(BoundedQueueTest, RejectsPushWhenFull) {
+    BoundedQueue<int> queue(4);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(queue.TryPush(std::move(i)));
+    int extra = 42;
+    EXPECT_FALSE(queue.TryPush(std::move(extra)));
+    EXPECT_EQ(queue.TryPop(), 0);
+    EXPECT_TRUE(queue.TryPush(std::move(extra)));
+}
+
+TEST(MandelbrotRenderer, StreamTilesCoverFrameAndMatchRenderAsync) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(40, 37, 48);
+    mandelbrot::ViewPort vp;
+
+    std::mutex mutex;
+    std::vector<RenderedTile> tiles;
+    auto sink = [&](RenderedTile &&tile) {
+        std::lock_guard lock{mutex};
+        tiles.push_back(std::move(tile));
+        return true;
+    };
+    stdexec::sync_wait(renderer.StreamTilesAsync<4>(vp, rs, 8, sink));
+
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+
+    std::uint32_t rows = 0;
+    for (const auto &tile : tiles) {
+        ASSERT_EQ(tile.region.end_col - tile.region.start_col, rs.width);
+        const auto tile_rows = tile.region.end_row - tile.region.start_row;
+        rows += tile_rows;
+        const auto offset = static_cast<std::size_t>(tile.region.start_row) * rs.width * RGBA_CHANNELS;
+        ASSERT_TRUE(std::equal(tile.rgba.begin(), tile.rgba.end(), full.rgba_data.begin() + offset));
+    }
+    EXPECT_EQ(rows, rs.height);
+}
+
+TEST(MandelbrotRenderer, StreamTilesStopWhenSinkRefuses) {
+    MandelbrotRenderer renderer(2);
+    auto rs = SmallSettings(16, 64, 16);
+    std::atomic<int> delivered{0};
+    auto sink = [&](RenderedTile &&) {
+        ++delivered;
+        return false;
+    };
+    stdexec::sync_wait(renderer.StreamTilesAsync<2>(mandelbrot::ViewPort{}, rs, 1, sink));
+    EXPECT_LE(delivered.load(), 2);
+}
+
+TEST(TileStreamTest, DrainsCurrentGenerationOnly) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(32, 40, 32);
+    TileStream stream(renderer);
+
+    stream.Restart(mandelbrot::ViewPort{.x_min = -3.0, .x_max = 3.0, .y_min = -3.0, .y_max = 3.0}, rs);
+    stream.Restart(mandelbrot::ViewPort{}, rs);
+    stream.WaitIdle();
+
+    std::uint32_t rows = 0;
+    for (const auto &tile : stream.Drain())
+        rows += tile.region.end_row - tile.region.start_row;
+    EXPECT_EQ(rows, rs.height);
+    EXPECT_TRUE(stream.Drain().empty());
+}
+
+TEST(TileStreamTest, ReportsFrameStatsOnceAllTilesAreDrained) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(32, 40, 32);
+    TileStream stream(renderer);
+
+    stream.Restart(mandelbrot::ViewPort{}, rs);
+    EXPECT_FALSE(stream.TakeFrameStats().has_value());
+    stream.WaitIdle();
+
+    std::uint64_t iterations = 0;
+    for (const auto &tile : stream.Drain())
+        iterations += tile.iterations;
+    auto stats = stream.TakeFrameStats();
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->pixels_computed, std::uint64_t{rs.width} * rs.height);
+    EXPECT_EQ(stats->total_iterations, iterations);
+    EXPECT_GT(stats->compute.count(), 0);
+    EXPECT_FALSE(stats->worker_busy.empty());
+    EXPECT_FALSE(stream.TakeFrameStats().has_value());
+}
+
+TEST(TileStreamTest, TakesLaneCountFromRenderer) {
+    MandelbrotRenderer renderer(3);
+    TileStream stream(renderer);
+    EXPECT_EQ(stream.Lanes(), 3u);
+
+    BasicMandelbrotRenderer shared{SharedThreadPool().get_scheduler(), 5};
+    EXPECT_EQ(shared.Concurrency(), 5u);
+}
+
 // --------------------- CalculateMandelbrotAsyncSender tests ---------------------
 TEST(CalculateAsync, RespectsNeedRerenderFlag) {
     MandelbrotRenderer renderer(4);
@@ -168,7 +1430,7 @@ TEST(CalculateAsync, RespectsNeedRerenderFlag) {
         stdexec::start(op);
         ASSERT_TRUE(std::get<0>(holder.values).has_value());
         auto rr = *std::get<0>(holder.values);
-        EXPECT_TRUE(rr.color_data.empty());
+        EXPECT_TRUE(rr.rgba_data.empty());
     }
 
     state.need_rerender = true;
@@ -179,161 +1441,419 @@ TEST(CalculateAsync, RespectsNeedRerenderFlag) {
         stdexec::start(op);
         ASSERT_TRUE(std::get<0>(holder.values).has_value());
         auto rr = *std::get<0>(holder.values);
-        EXPECT_FALSE(rr.color_data.empty());
+        EXPECT_FALSE(rr.rgba_data.empty());
         EXPECT_FALSE(state.need_rerender);
     }
 }
 
-// --------------------- SFMLRender tests ---------------------
-TEST(SFMLRenderTest, DrawsPixelsToTexture) {
-    auto rs = SmallSettings(16, 12, 32);
-    sf::RenderWindow *wnd = nullptr;
-    try {
-        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
-    } catch (...) {
-        GTEST_SKIP() << "SFML window creation failed";
-    }
-    std::unique_ptr<sf::RenderWindow> window(wnd);
-    if (!window->isOpen()) {
-        GTEST_SKIP() << "SFML window not open";
-    }
+TEST(CalculateAsync, RendersOnAnyScheduler) {
+    auto rs = SmallSettings(40, 30, 40);
+    MandelbrotRenderer pooled(4);
+    BasicMandelbrotRenderer inline_renderer{exec::inline_scheduler{}, 3};
 
-    sf::Image image;
-    image.create(rs.width, rs.height);
-    sf::Texture texture;
-    texture.create(rs.width, rs.height);
-    sf::Sprite sprite;
+    AppState pooled_state;
+    AppState inline_state;
+    auto expected = std::get<0>(*stdexec::sync_wait(CalculateMandelbrotAsyncSender{pooled_state, rs, pooled}));
+    auto actual = std::get<0>(*stdexec::sync_wait(CalculateMandelbrotAsyncSender{inline_state, rs, inline_renderer}));
+    EXPECT_EQ(actual.pixel_data, expected.pixel_data);
 
-    RenderResult rr;
-    rr.settings = rs;
-    rr.color_data.resize(rs.height, std::vector<mandelbrot::RgbColor>(rs.width));
+    // Потоковый путь окна и воспроизведения тоже принимает любой рендерер
+    BasicTileStream stream{inline_renderer};
+    stream.Restart(mandelbrot::ViewPort{}, rs);
+    stream.WaitIdle();
+    std::uint32_t rows = 0;
+    for (const auto &tile : stream.Drain())
+        rows += tile.region.end_row - tile.region.start_row;
+    EXPECT_EQ(rows, rs.height);
+}
 
-    for (unsigned y = 0; y < rs.height; ++y)
-        for (unsigned x = 0; x < rs.width; ++x)
-            rr.color_data[y][x] = mandelbrot::RgbColor{static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), 0};
+// --------------------- Dirty regions tests ---------------------
+TEST(DirtyRegions, MergesAdjacentTilesAndStrips) {
+    std::vector<PixelRegion> tiles;
+    for (std::uint32_t row = 0; row < 32; row += 16)
+        for (std::uint32_t col = 0; col < 64; col += 16)
+            tiles.push_back({.start_row = row, .end_row = row + 16, .start_col = col, .end_col = col + 16});
+    tiles.push_back({.start_row = 48, .end_row = 64, .start_col = 0, .end_col = 16});
 
-    testutil::ValueHolder<> holder{};
-    auto sender = SFMLRender(rr, image, texture, sprite, *window, rs);
-    auto op = stdexec::connect(sender, testutil::Receiver<decltype(holder)>{&holder});
-    stdexec::start(op);
+    auto merged = MergeDirtyRegions(tiles);
+    ASSERT_EQ(merged.size(), 2u);
+    EXPECT_EQ(merged[0].start_row, 0u);
+    EXPECT_EQ(merged[0].end_row, 32u);
+    EXPECT_EQ(merged[0].end_col, 64u);
+    EXPECT_EQ(merged[1].start_row, 48u);
+    EXPECT_EQ(merged[1].end_col, 16u);
+}
 
-    auto back = texture.copyToImage();
-    auto pix = back.getPixel(3, 5);
-    EXPECT_EQ(pix.r, 3u);
-    EXPECT_EQ(pix.g, 5u);
+TEST(DirtyRegions, DropsEmptyRegions) {
+    auto merged = MergeDirtyRegions({{.start_row = 5, .end_row = 5, .start_col = 0, .end_col = 10},
+                                     {.start_row = 0, .end_row = 2, .start_col = 4, .end_col = 4}});
+    EXPECT_TRUE(merged.empty());
 }
 
-// --------------------- SfmlEventHandler tests ---------------------
-TEST(SfmlEventHandlerTest, ContinuousZoomChangesViewport) {
-    auto rs = SmallSettings(100, 80);
-    sf::RenderWindow *wnd = nullptr;
-    try {
-        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
-    } catch (...) {
-        GTEST_SKIP() << "SFML window creation failed";
-    }
-    std::unique_ptr<sf::RenderWindow> window(wnd);
-    if (!window->isOpen()) {
-        GTEST_SKIP() << "SFML window not open";
+TEST(MandelbrotRenderer, RenderAsyncMarksWholeFrameDirty) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(30, 21, 32);
+    auto tup = stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, rs));
+    ASSERT_TRUE(tup.has_value());
+    const auto &dirty = std::get<0>(*tup).dirty_regions;
+    ASSERT_EQ(dirty.size(), 1u);
+    EXPECT_EQ(dirty[0].end_row, rs.height);
+    EXPECT_EQ(dirty[0].end_col, rs.width);
+}
+
+TEST(MandelbrotRenderer, RenderRegionIntoMarksOnlyThatRegionDirty) {
+    MandelbrotRenderer renderer(4);
+    auto rs = SmallSettings(30, 21, 32);
+    mandelbrot::ViewPort vp;
+    auto full = std::get<0>(*stdexec::sync_wait(renderer.RenderAsync<4>(vp, rs)));
+
+    // Испортим область кадра и пересчитаем только её: кадр снова совпадает с полным рендером
+    auto frame = full;
+    const PixelRegion region{.start_row = 3, .end_row = 9, .start_col = 5, .end_col = 40};
+    for (std::uint32_t y = region.start_row; y < region.end_row; ++y) {
+        std::fill(frame.pixel_data[y].begin() + region.start_col, frame.pixel_data[y].end(), 0u);
+        std::fill_n(frame.rgba_data.begin() + (y * rs.width + region.start_col) * RGBA_CHANNELS,
+                    (rs.width - region.start_col) * RGBA_CHANNELS, std::uint8_t{0});
     }
+    auto refreshed = std::get<0>(*stdexec::sync_wait(renderer.RenderRegionIntoAsync<4>(std::move(frame), region)));
+    ASSERT_EQ(refreshed.dirty_regions.size(), 1u);
+    EXPECT_EQ(refreshed.dirty_regions[0].start_row, 3u);
+    EXPECT_EQ(refreshed.dirty_regions[0].start_col, 5u);
+    EXPECT_EQ(refreshed.dirty_regions[0].end_col, rs.width);
+    EXPECT_EQ(refreshed.stats.pixels_computed, 6u * (rs.width - 5));
+    EXPECT_EQ(refreshed.pixel_data, full.pixel_data);
+    EXPECT_EQ(refreshed.rgba_data, full.rgba_data);
+}
 
-    AppState state;
-    sf::Clock clk;
-    SfmlEventHandler handler(*window, rs, state, clk);
+// --------------------- FramePacer tests ---------------------
+TEST(FrameTimeHistogramTest, ReportsPercentilesAndMax) {
+    FrameTimeHistogram histogram;
+    for (int i = 0; i < 98; ++i)
+        histogram.Record(16ms);
+    histogram.Record(40ms);
+    histogram.Record(300ms);
 
-    sf::Mouse::setPosition(sf::Vector2i{static_cast<int>(rs.width / 2), static_cast<int>(rs.height / 2)}, *window);
-    state.left_mouse_pressed = true;
-    std::this_thread::sleep_for(120ms);
+    auto summary = histogram.GetSummary();
+    EXPECT_EQ(summary.count, 100u);
+    EXPECT_GE(summary.p50, 16ms);
+    EXPECT_LE(summary.p50, 16ms + FrameTimeHistogram::BIN_WIDTH);
+    EXPECT_GE(summary.p99, 40ms);
+    EXPECT_LE(summary.p99, 40ms + FrameTimeHistogram::BIN_WIDTH);
+    EXPECT_EQ(summary.max, 300ms);
 
-    testutil::ValueHolder<> holder{};
-    auto op = stdexec::connect(handler, testutil::Receiver<decltype(holder)>{&holder});
-    auto vp_before = state.viewport;
-    stdexec::start(op);
-    auto vp_after = state.viewport;
+    histogram.Reset();
+    EXPECT_EQ(histogram.GetSummary().count, 0u);
+}
+
+TEST(FrameTimeHistogramTest, LatencyHistogramResolvesSlowRequests) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 50; ++i)
+        histogram.Record(1ms);
+    for (int i = 0; i < 50; ++i)
+        histogram.Record(2s);
 
-    EXPECT_LT(vp_after.width(), vp_before.width());
-    EXPECT_LT(vp_after.height(), vp_before.height());
+    auto summary = histogram.GetSummary();
+    EXPECT_LE(summary.p50, 1ms + LatencyHistogram::BIN_WIDTH);
+    EXPECT_GE(summary.p99, 2s);
+    EXPECT_LE(summary.p99, 2s + LatencyHistogram::BIN_WIDTH);
 }
 
-// --------------------- WaitForFPS test ---------------------
-TEST(WaitForFPSTest, SleepsToMaintainTarget) {
-    FrameClock clock;
-    WaitForFPS limiter(clock, 50);
+TEST(FramePacerTest, SleepsToMaintainTarget) {
+    FrameStats stats;
+    FramePacer pacer(stats, 50);
     auto t0 = std::chrono::steady_clock::now();
-    limiter();
+    pacer();
     auto dt = std::chrono::steady_clock::now() - t0;
     EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(dt).count(), 10);
+    EXPECT_EQ(stats.frame_time.Count(), 1u);
 }
 
-// --------------------- Integration-like test ---------------------
-TEST(Integration, ComputeAndRenderOneFrame) {
-    auto rs = SmallSettings(40, 30, 40);
+TEST(FramePacerTest, DeadlinesDoNotDrift) {
+    FrameStats stats;
+    FramePacer pacer(stats, 50);
+    const auto first_deadline = pacer.NextDeadline();
+    for (int i = 0; i < 10; ++i) {
+        pacer();
+        // имитация работы кадра, которая меньше периода
+        std::this_thread::sleep_for(3ms);
+    }
+    // Дедлайны идут строго с шагом периода, пересыпание не сдвигает расписание
+    EXPECT_EQ(pacer.NextDeadline() - first_deadline, pacer.Period() * 10);
+    EXPECT_EQ(stats.frame_time.Count(), 10u);
+}
+
+TEST(FramePacerTest, ResynchronizesAfterLongFrame) {
+    FrameStats stats;
+    FramePacer pacer(stats, 100);
+    std::this_thread::sleep_for(50ms);
+    pacer();
+    auto now = std::chrono::steady_clock::now();
+    EXPECT_GT(pacer.NextDeadline(), now);
+    EXPECT_LE(pacer.NextDeadline(), now + pacer.Period());
+}
+
+// --------------------- Trace tests ---------------------
+TEST(Trace, DisabledSpansRecordNothing) {
+    auto &tracer = trace::Tracer::Instance();
+    tracer.Disable();
+    tracer.Clear();
+    {
+        trace::Span span{"idle", "test"};
+    }
+    trace::Record("idle", "test", trace::Clock::now(), trace::Clock::now());
+    EXPECT_EQ(tracer.EventCount(), 0u);
+}
+
+TEST(Trace, RecordsStripsFromPoolThreads) {
+    auto &tracer = trace::Tracer::Instance();
+    tracer.Clear();
+    tracer.Enable();
+    {
+        MandelbrotRenderer renderer(4);
+        auto result = stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, SmallSettings(32, 24, 32)));
+        ASSERT_TRUE(result.has_value());
+        trace::Span span{"outer", "test", "frame", 7};
+        span.End();
+    }
+    tracer.Disable();
+
+    // 4 полосы, слияние, 4 части сглаживания и внешний интервал
+    EXPECT_EQ(tracer.EventCount(), 10u);
+    EXPECT_EQ(tracer.DroppedCount(), 0u);
+
+    std::ostringstream out;
+    tracer.WriteJson(out);
+    const auto json = out.str();
+    EXPECT_EQ(json.rfind(R"({"displayTimeUnit":"ms","traceEvents":[)", 0), 0u);
+    EXPECT_NE(json.find(R"("name":"strip","cat":"compute","ph":"X")"), std::string::npos);
+    EXPECT_NE(json.find(R"("name":"merge")"), std::string::npos);
+    EXPECT_NE(json.find(R"("args":{"frame":7})"), std::string::npos);
+    EXPECT_NE(json.find(R"("ph":"M")"), std::string::npos);
+    tracer.Clear();
+}
+
+// --------------------- Perf counters tests ---------------------
+TEST(PerfCounters, CounterSetArithmetic) {
+    perf::CounterSet start;
+    start.values = {100, 150, 5, 1};
+    start.valid = {true, true, true, false};
+    perf::CounterSet end;
+    end.values = {300, 550, 9, 4};
+    end.valid = {true, true, true, true};
+
+    const auto delta = end - start;
+    EXPECT_EQ(delta.Get(perf::Event::CYCLES), 200u);
+    EXPECT_EQ(delta.Get(perf::Event::INSTRUCTIONS), 400u);
+    EXPECT_DOUBLE_EQ(delta.Ipc(), 2.0);
+    // Событие, не измеренное в одном из чтений, в разнице не участвует
+    EXPECT_FALSE(delta.Has(perf::Event::LLC_MISSES));
+
+    perf::CounterSet total;
+    EXPECT_FALSE(total.Any());
+    EXPECT_DOUBLE_EQ(total.Ipc(), 0.0);
+    total += delta;
+    total += delta;
+    EXPECT_TRUE(total.Any());
+    EXPECT_EQ(total.Get(perf::Event::BRANCH_MISSES), 8u);
+}
+
+TEST(PerfCounters, DisabledCountersAreEmpty) {
+    perf::Disable();
+    const perf::Scope scope;
+    EXPECT_FALSE(scope.Stop().Any());
+
     MandelbrotRenderer renderer(4);
-    AppState state;
-    state.need_rerender = true;
+    auto result = stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, SmallSettings(32, 24, 32)));
+    ASSERT_TRUE(result.has_value());
+    const auto &stats = std::get<0>(*result).stats;
+    EXPECT_FALSE(stats.hw_compute.Any());
+    EXPECT_FALSE(stats.hw_merge.Any());
+    EXPECT_EQ(FormatRenderStats(stats).find("IPC"), std::string::npos);
+}
+
+TEST(PerfCounters, EnabledCountersDegradeWhenUnavailable) {
+    perf::Enable();
+    MandelbrotRenderer renderer(4);
+    auto result = stdexec::sync_wait(renderer.RenderAsync<4>(mandelbrot::ViewPort{}, SmallSettings(64, 48, 64)));
+    perf::Disable();
+    ASSERT_TRUE(result.has_value());
+    // Без доступа к PMU (контейнер, perf_event_paranoid) наборы пустые, и рендер от этого не ломается
+    const auto &hw = std::get<0>(*result).stats.hw_compute;
+    if (!hw.Has(perf::Event::INSTRUCTIONS)) {
+        GTEST_SKIP() << "hardware counters unavailable";
+    }
+    EXPECT_GT(hw.Get(perf::Event::INSTRUCTIONS), 0u);
+}
 
-    sf::RenderWindow *wnd = nullptr;
-    try {
-        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
-    } catch (...) {
-        GTEST_SKIP() << "SFML unavailable";
+// --------------------- HUD tests ---------------------
+TEST(HudCounters, SnapshotsOncePerPeriod) {
+    const auto start = HudCounters::Clock::time_point{};
+    HudCounters counters{250ms, start};
+    for (int i = 0; i < 15; ++i) {
+        counters.OnFrame();
     }
-    std::unique_ptr<sf::RenderWindow> window(wnd);
-    if (!window->isOpen()) {
-        GTEST_SKIP() << "SFML window not open";
+    counters.AddWork(2'000'000, 3'000'000'000);
+    counters.SetLastPresent(2ms);
+
+    EXPECT_FALSE(counters.Poll(start + 100ms).has_value());
+    const auto snapshot = counters.Poll(start + 500ms);
+    ASSERT_TRUE(snapshot.has_value());
+    EXPECT_DOUBLE_EQ(snapshot->fps, 30.0);
+    EXPECT_NEAR(snapshot->frame_ms, 33.333, 1e-3);
+    EXPECT_DOUBLE_EQ(snapshot->mpix_per_s, 4.0);
+    EXPECT_DOUBLE_EQ(snapshot->giter_per_s, 6.0);
+    EXPECT_EQ(snapshot->last_present, 2ms);
+
+    // Новый период начинается с нуля
+    const auto next = counters.Poll(start + 1000ms);
+    ASSERT_TRUE(next.has_value());
+    EXPECT_DOUBLE_EQ(next->fps, 0.0);
+    EXPECT_DOUBLE_EQ(next->mpix_per_s, 0.0);
+}
+
+TEST(HudCounters, FormatsAllFields) {
+    HudCounters::Snapshot snapshot{.fps = 59.9, .frame_ms = 16.7, .mpix_per_s = 120.0, .giter_per_s = 1.5};
+    snapshot.last_render.compute = 8ms;
+
+    const auto text = FormatHud(snapshot, mandelbrot::KERNEL_NAME, 500, std::nullopt);
+    EXPECT_NE(text.find("59.9 fps"), std::string::npos);
+    EXPECT_NE(text.find("compute 8.00"), std::string::npos);
+    EXPECT_NE(text.find("120.0 Mpix/s"), std::string::npos);
+    EXPECT_NE(text.find("1.500 Giter/s"), std::string::npos);
+    EXPECT_NE(text.find("kernel double scalar"), std::string::npos);
+    EXPECT_NE(text.find("iterations 500"), std::string::npos);
+    EXPECT_NE(text.find("cache n/a"), std::string::npos);
+    EXPECT_NE(FormatHud(snapshot, "x", 1, 0.875).find("cache 87.5%"), std::string::npos);
+}
+
+TEST(HudCounters, RenderedTileCarriesIterations) {
+    auto rs = SmallSettings(16, 8, 32);
+    const PixelRegion region{2, 6, 0, rs.width};
+    const auto tile = RenderTile(mandelbrot::ViewPort{}, rs, region);
+    const auto matrix = ComputePixelMatrixForRegion(mandelbrot::ViewPort{}, rs, region);
+
+    std::uint64_t iterations = 0;
+    for (const auto &row : matrix) {
+        iterations = std::accumulate(row.begin(), row.end(), iterations);
     }
+    EXPECT_EQ(tile.iterations, iterations);
+}
+
+// --------------------- Input session tests ---------------------
+namespace {
+
+// Записывает сессию: нажатие, три шага приближения, отпускание и несколько пустых кадров
+std::string RecordSampleSession(const RenderSettings &settings, mandelbrot::ViewPort &final_viewport) {
+    using session::InputType;
+    std::ostringstream out;
+    session::SessionRecorder recorder{out, settings, mandelbrot::ViewPort{}};
 
-    sf::Image image;
-    image.create(rs.width, rs.height);
-    sf::Texture texture;
-    texture.create(rs.width, rs.height);
-    sf::Sprite sprite;
+    AppState state;
+    auto record = [&](std::vector<InputType> events, std::optional<session::ZoomInput> zoom) {
+        session::FrameInput input;
+        for (const auto event : events) {
+            session::ApplyInput(state, event);
+        }
+        if (zoom) {
+            session::ZoomToPoint(state, settings, zoom->x, zoom->y, state.left_mouse_pressed);
+        }
+        input.events = std::move(events);
+        input.zoom = zoom;
+        input.viewport = state.viewport;
+        recorder.Record(std::move(input));
+    };
 
-    auto pipeline = stdexec::just() |
-                    stdexec::let_value([&]() { return CalculateMandelbrotAsyncSender(state, rs, renderer); }) |
-                    stdexec::let_value([&](RenderResult data) {
-                        return SFMLRender(std::move(data), image, texture, sprite, *window, rs);
-                    });
+    record({}, std::nullopt);
+    record({InputType::LEFT_PRESS}, std::nullopt);
+    record({}, session::ZoomInput{10, 7});
+    record({}, std::nullopt);
+    record({}, session::ZoomInput{20, 12});
+    record({InputType::TOGGLE_HUD}, session::ZoomInput{3, 30});
+    record({InputType::LEFT_RELEASE}, std::nullopt);
+    record({}, std::nullopt);
+    recorder.Finish();
 
-    auto res = stdexec::sync_wait(std::move(pipeline));
-    ASSERT_TRUE(res.has_value());
-    auto back = texture.copyToImage();
-    auto pix = back.getPixel(0, 0);
-    EXPECT_TRUE(back.getSize().x == rs.width && back.getSize().y == rs.height);
+    final_viewport = state.viewport;
+    return out.str();
 }
 
-TEST(Integration, PipelineWithRerender) {
+}  // namespace
+
+TEST(InputSession, RoundTripsThroughText) {
+    auto rs = SmallSettings(40, 32, 48);
+    rs.kernel = mandelbrot::Kernel::SIMD_STREAMING;
+    rs.aa_samples = 4;
+    rs.aa_threshold = 3;
+    mandelbrot::ViewPort final_viewport;
+    std::istringstream in{RecordSampleSession(rs, final_viewport)};
+
+    const auto recorded = session::ReadSession(in);
+    EXPECT_EQ(recorded.settings.width, rs.width);
+    EXPECT_EQ(recorded.settings.height, rs.height);
+    EXPECT_EQ(recorded.settings.max_iterations, rs.max_iterations);
+    EXPECT_EQ(recorded.settings.kernel, rs.kernel);
+    EXPECT_EQ(recorded.settings.aa_samples, rs.aa_samples);
+    EXPECT_EQ(recorded.settings.aa_threshold, rs.aa_threshold);
+    EXPECT_EQ(recorded.frame_count, 8u);
+    // Пустые кадры в файл не попадают
+    ASSERT_EQ(recorded.frames.size(), 5u);
+    EXPECT_EQ(recorded.frames[0].frame, 1u);
+    EXPECT_EQ(recorded.frames[2].frame, 4u);
+    ASSERT_TRUE(recorded.frames[3].zoom.has_value());
+    EXPECT_EQ(recorded.frames[3].zoom->x, 3);
+    EXPECT_EQ(recorded.frames[3].events, std::vector{session::InputType::TOGGLE_HUD});
+    // Области читаются без потери точности
+    EXPECT_EQ(recorded.frames[3].viewport.x_min, final_viewport.x_min);
+    EXPECT_EQ(recorded.frames[3].viewport.y_max, final_viewport.y_max);
+}
+
+TEST(InputSession, PlayerReproducesViewportsFrameByFrame) {
+    auto rs = SmallSettings(40, 32, 48);
+    mandelbrot::ViewPort final_viewport;
+    std::istringstream in{RecordSampleSession(rs, final_viewport)};
+    session::SessionPlayer player{session::ReadSession(in)};
+
     AppState state;
-    state.need_rerender = true;
-    state.should_exit = true;
-    MandelbrotRenderer renderer;
-    RenderSettings settings{20, 20, 10, 2.0};
-
-    sf::RenderWindow mock_window(sf::VideoMode(20, 20), "Test");
-    sf::Clock mock_zoom;
-    sf::Image mock_image;
-    mock_image.create(20, 20);
-    sf::Texture mock_texture;
-    mock_texture.create(20, 20);
-    sf::Sprite mock_sprite;
-
-    FrameClock frame_clock;
-
-    auto pipeline =
-        SfmlEventHandler{mock_window, settings, state, mock_zoom} |
-        stdexec::let_value([&]() { return CalculateMandelbrotAsyncSender{state, settings, renderer}; }) |
-        stdexec::let_value([&](RenderResult data) {
-            return SFMLRender{std::move(data), mock_image, mock_texture, mock_sprite, mock_window, settings};
-        }) |
-        stdexec::then(WaitForFPS{frame_clock, 60});
-
-    auto repeated =
-        std::move(pipeline) | stdexec::then([&]() { return state.should_exit; }) | exec::repeat_effect_until();
-
-    stdexec::sync_wait(std::move(repeated));
-
-    sf::Color pixel = mock_image.getPixel(10, 10);
-    EXPECT_EQ(pixel.r, 0);
-    EXPECT_EQ(pixel.g, 0);
-    EXPECT_EQ(pixel.b, 0);
-}
\ No newline at end of file
+    while (!player.Finished()) {
+        player.ApplyNextFrame(state);
+    }
+    EXPECT_EQ(player.Frame(), 8u);
+    EXPECT_EQ(player.Divergences(), 0u);
+    EXPECT_EQ(state.viewport.x_min, final_viewport.x_min);
+    EXPECT_EQ(state.viewport.x_max, final_viewport.x_max);
+    EXPECT_TRUE(state.show_hud);
+    EXPECT_FALSE(state.left_mouse_pressed);
+}
+
+TEST(InputSession, HeadlessReplayRecordsEveryFrame) {
+    auto rs = SmallSettings(40, 32, 48);
+    mandelbrot::ViewPort final_viewport;
+    std::istringstream in{RecordSampleSession(rs, final_viewport)};
+    const auto recorded = session::ReadSession(in);
+
+    MandelbrotRenderer renderer(4);
+    FrameStats stats;
+    const auto summary = session::ReplayHeadless(renderer, recorded, stats);
+    EXPECT_EQ(summary.frames, 8u);
+    // Первый кадр и нажатие кнопки запрашивают перерисовку, как и в окне
+    EXPECT_EQ(summary.renders, 2u);
+    EXPECT_EQ(summary.divergences, 0u);
+    EXPECT_EQ(stats.frame_time.Count(), 8u);
+}
+
+TEST(InputSession, RejectsMalformedFiles) {
+    std::istringstream no_header{"end 3\n"};
+    EXPECT_THROW((void)session::ReadSession(no_header), std::runtime_error);
+
+    std::istringstream bad_event{"mandelbrot-session 2\nF 0 0 -2 1 -1 1 0 0 0 1 42\n"};
+    EXPECT_THROW((void)session::ReadSession(bad_event), std::runtime_error);
+
+    std::istringstream bad_number{"mandelbrot-session 2\nsettings 10 x 5 2 0 0 1\n"};
+    EXPECT_THROW((void)session::ReadSession(bad_number), std::runtime_error);
+
+    std::istringstream old_version{"mandelbrot-session 1\nsettings 10 10 5 2\n"};
+    EXPECT_THROW((void)session::ReadSession(old_version), std::runtime_error);
+
+    std::istringstream bad_kernel{"mandelbrot-session 2\nsettings 10 10 5 2 9 0 1\n"};
+    EXPECT_THROW((void)session::ReadSession(bad_kernel), std::runtime_error);
+}
@@ -0,0 +1,241 @@
+#include <exec/repeat_effect_until.hpp>
+#include <gtest/gtest.h>
+#include <stdexec/execution.hpp>
+
+#include "frame_pacer.hpp"
+#include "mandelbrot.hpp"
+#include "mandelbrot_renderer.hpp"
+#include "sfml_events_handler.hpp"
+#include "sfml_renderer.hpp"
+#include "types.hpp"
+
+#include "test_utils.hpp"
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// Тесты оконного фронтенда: нужны SFML и дисплей, без дисплея тесты пропускаются
+
+// --------------------- SFMLRender tests ---------------------
+TEST(SFMLRenderTest, DrawsPixelsToTexture) {
+    auto rs = SmallSettings(16, 12, 32);
+    sf::RenderWindow *wnd = nullptr;
+    try {
+        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
+    } catch (...) {
+        GTEST_SKIP() << "SFML window creation failed";
+    }
+    std::unique_ptr<sf::RenderWindow> window(wnd);
+    if (!window->isOpen()) {
+        GTEST_SKIP() << "SFML window not open";
+    }
+
+    sf::Texture texture;
+    texture.create(rs.width, rs.height);
+    sf::Sprite sprite;
+
+    RenderResult rr;
+    rr.settings = rs;
+    ColorMatrix colors(rs.height, std::vector<mandelbrot::RgbColor>(rs.width));
+
+    for (unsigned y = 0; y < rs.height; ++y)
+        for (unsigned x = 0; x < rs.width; ++x)
+            colors[y][x] = mandelbrot::RgbColor{static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), 0};
+    PackColorsToRgba(colors, rs.width, rs.height, rr.rgba_data);
+
+    FrameStats stats;
+    testutil::ValueHolder<> holder{};
+    auto sender = SFMLRender(rr, texture, sprite, *window, rs, &stats);
+    auto op = stdexec::connect(sender, testutil::Receiver<decltype(holder)>{&holder});
+    stdexec::start(op);
+
+    auto back = texture.copyToImage();
+    auto pix = back.getPixel(3, 5);
+    EXPECT_EQ(pix.r, 3u);
+    EXPECT_EQ(pix.g, 5u);
+    EXPECT_EQ(stats.present_time.Count(), 1u);
+}
+
+TEST(SFMLRenderTest, LogsStageLineWithPresentTime) {
+    auto rs = SmallSettings(16, 12, 32);
+    sf::RenderWindow *wnd = nullptr;
+    try {
+        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
+    } catch (...) {
+        GTEST_SKIP() << "SFML window creation failed";
+    }
+    std::unique_ptr<sf::RenderWindow> window(wnd);
+    if (!window->isOpen()) {
+        GTEST_SKIP() << "SFML window not open";
+    }
+
+    sf::Texture texture;
+    texture.create(rs.width, rs.height);
+    sf::Sprite sprite;
+
+    RenderResult rr;
+    rr.settings = rs;
+    rr.rgba_data.resize(static_cast<std::size_t>(rs.width) * rs.height * RGBA_CHANNELS);
+    rr.stats.pixels_computed = static_cast<std::uint64_t>(rs.width) * rs.height;
+
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> log{std::tmpfile(), &std::fclose};
+    ASSERT_NE(log, nullptr);
+    testutil::ValueHolder<> holder{};
+    auto op = stdexec::connect(SFMLRender(std::move(rr), texture, sprite, *window, rs, nullptr, nullptr, log.get()),
+                               testutil::Receiver<decltype(holder)>{&holder});
+    stdexec::start(op);
+
+    std::rewind(log.get());
+    char line[1024] = {};
+    ASSERT_NE(std::fgets(line, sizeof(line), log.get()), nullptr);
+    EXPECT_NE(std::string_view{line}.find("present"), std::string_view::npos);
+}
+
+TEST(SFMLRenderTest, UploadsOnlyDirtyRegions) {
+    auto rs = SmallSettings(16, 12, 32);
+    sf::RenderWindow *wnd = nullptr;
+    try {
+        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
+    } catch (...) {
+        GTEST_SKIP() << "SFML window creation failed";
+    }
+    std::unique_ptr<sf::RenderWindow> window(wnd);
+    if (!window->isOpen()) {
+        GTEST_SKIP() << "SFML window not open";
+    }
+
+    sf::Texture texture;
+    texture.create(rs.width, rs.height);
+    sf::Sprite sprite;
+
+    auto present = [&](std::uint8_t value, std::vector<PixelRegion> dirty) {
+        RenderResult rr;
+        rr.settings = rs;
+        rr.rgba_data.assign(static_cast<std::size_t>(rs.width) * rs.height * RGBA_CHANNELS, value);
+        rr.dirty_regions = std::move(dirty);
+        testutil::ValueHolder<> holder{};
+        auto op = stdexec::connect(SFMLRender(std::move(rr), texture, sprite, *window, rs),
+                                   testutil::Receiver<decltype(holder)>{&holder});
+        stdexec::start(op);
+    };
+
+    present(10, {});
+    present(200, {{.start_row = 2, .end_row = 4, .start_col = 3, .end_col = 6},
+                  {.start_row = 2, .end_row = 4, .start_col = 6, .end_col = 8},
+                  {.start_row = 8, .end_row = 10, .start_col = 0, .end_col = rs.width}});
+
+    auto back = texture.copyToImage();
+    EXPECT_EQ(back.getPixel(0, 0).r, 10u);
+    EXPECT_EQ(back.getPixel(3, 2).r, 200u);
+    EXPECT_EQ(back.getPixel(7, 3).r, 200u);
+    EXPECT_EQ(back.getPixel(8, 3).r, 10u);
+    EXPECT_EQ(back.getPixel(5, 9).r, 200u);
+    EXPECT_EQ(back.getPixel(5, 10).r, 10u);
+}
+
+// --------------------- SfmlEventHandler tests ---------------------
+TEST(SfmlEventHandlerTest, ContinuousZoomChangesViewport) {
+    auto rs = SmallSettings(100, 80);
+    sf::RenderWindow *wnd = nullptr;
+    try {
+        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
+    } catch (...) {
+        GTEST_SKIP() << "SFML window creation failed";
+    }
+    std::unique_ptr<sf::RenderWindow> window(wnd);
+    if (!window->isOpen()) {
+        GTEST_SKIP() << "SFML window not open";
+    }
+
+    AppState state;
+    sf::Clock clk;
+    SfmlEventHandler handler(*window, rs, state, clk);
+
+    sf::Mouse::setPosition(sf::Vector2i{static_cast<int>(rs.width / 2), static_cast<int>(rs.height / 2)}, *window);
+    state.left_mouse_pressed = true;
+    std::this_thread::sleep_for(120ms);
+
+    testutil::ValueHolder<> holder{};
+    auto op = stdexec::connect(handler, testutil::Receiver<decltype(holder)>{&holder});
+    auto vp_before = state.viewport;
+    stdexec::start(op);
+    auto vp_after = state.viewport;
+
+    EXPECT_LT(vp_after.width(), vp_before.width());
+    EXPECT_LT(vp_after.height(), vp_before.height());
+}
+
+// --------------------- Integration-like test ---------------------
+TEST(Integration, ComputeAndRenderOneFrame) {
+    auto rs = SmallSettings(40, 30, 40);
+    MandelbrotRenderer renderer(4);
+    AppState state;
+    state.need_rerender = true;
+
+    sf::RenderWindow *wnd = nullptr;
+    try {
+        wnd = new sf::RenderWindow(sf::VideoMode{rs.width, rs.height}, "test", sf::Style::Titlebar | sf::Style::Close);
+    } catch (...) {
+        GTEST_SKIP() << "SFML unavailable";
+    }
+    std::unique_ptr<sf::RenderWindow> window(wnd);
+    if (!window->isOpen()) {
+        GTEST_SKIP() << "SFML window not open";
+    }
+
+    sf::Texture texture;
+    texture.create(rs.width, rs.height);
+    sf::Sprite sprite;
+
+    auto pipeline = stdexec::just() |
+                    stdexec::let_value([&]() { return CalculateMandelbrotAsyncSender(state, rs, renderer); }) |
+                    stdexec::let_value([&](RenderResult data) {
+                        return SFMLRender(std::move(data), texture, sprite, *window, rs);
+                    });
+
+    auto res = stdexec::sync_wait(std::move(pipeline));
+    ASSERT_TRUE(res.has_value());
+    auto back = texture.copyToImage();
+    auto pix = back.getPixel(0, 0);
+    EXPECT_TRUE(back.getSize().x == rs.width && back.getSize().y == rs.height);
+}
+
+TEST(Integration, PipelineWithRerender) {
+    AppState state;
+    state.need_rerender = true;
+    state.should_exit = true;
+    MandelbrotRenderer renderer;
+    RenderSettings settings{20, 20, 10, 2.0};
+
+    sf::RenderWindow mock_window(sf::VideoMode(20, 20), "Test");
+    sf::Clock mock_zoom;
+    sf::Texture mock_texture;
+    mock_texture.create(20, 20);
+    sf::Sprite mock_sprite;
+
+    FrameStats frame_stats;
+    FramePacer frame_pacer{frame_stats, 60};
+
+    auto pipeline =
+        SfmlEventHandler{mock_window, settings, state, mock_zoom} |
+        stdexec::let_value([&]() { return CalculateMandelbrotAsyncSender{state, settings, renderer}; }) |
+        stdexec::let_value([&](RenderResult data) {
+            return SFMLRender{std::move(data), mock_texture, mock_sprite, mock_window, settings, &frame_stats};
+        }) |
+        stdexec::then([&]() { frame_pacer.WaitForNextFrame(); });
+
+    auto repeated =
+        std::move(pipeline) | stdexec::then([&]() { return state.should_exit; }) | exec::repeat_effect_until();
+
+    stdexec::sync_wait(std::move(repeated));
+
+    // Выход запрошен до первого кадра — конвейер остановлен обработчиком событий и ничего не показал
+    EXPECT_EQ(frame_stats.present_time.Count(), 0u);
+    EXPECT_EQ(frame_stats.frame_time.Count(), 0u);
+}
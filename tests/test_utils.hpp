@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdexec/execution.hpp>
+
+#include <exception>
+#include <initializer_list>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "types.hpp"
+
+// Общие помощники тестов: приёмник, сохраняющий результат сендера, и маленькие настройки рендера
+
+namespace testutil {
+
+template <class... Ts>
+struct ValueHolder {
+    std::tuple<std::optional<Ts>...> values;
+    std::optional<std::exception_ptr> err;
+    bool stopped = false;
+};
+
+template <class Holder>
+struct Receiver {
+    using receiver_concept = stdexec::receiver_t;
+    Holder *holder;
+
+    template <class... Vs>
+    friend void tag_invoke(stdexec::set_value_t, Receiver &&self, Vs &&...vs) noexcept {
+        self.store(std::forward<Vs>(vs)...);
+    }
+    friend void tag_invoke(stdexec::set_error_t, Receiver &&self, std::exception_ptr e) noexcept {
+        self.holder->err = e;
+    }
+    friend void tag_invoke(stdexec::set_stopped_t, Receiver &&self) noexcept { self.holder->stopped = true; }
+
+private:
+    template <class... Vs, std::size_t... Is>
+    void store_impl(std::index_sequence<Is...>, Vs &&...vs) noexcept {
+        (void)std::initializer_list<int>{((std::get<Is>(holder->values) = std::forward<Vs>(vs)), 0)...};
+    }
+    template <class... Vs>
+    void store(Vs &&...vs) noexcept {
+        store_impl(std::make_index_sequence<sizeof...(Vs)>{}, std::forward<Vs>(vs)...);
+    }
+};
+
+}  // namespace testutil
+
+inline RenderSettings SmallSettings(unsigned w = 64, unsigned h = 48, unsigned it = 64, double R = 2.0) {
+    RenderSettings rs;
+    rs.width = w;
+    rs.height = h;
+    rs.max_iterations = it;
+    rs.escape_radius = R;
+    return rs;
+}